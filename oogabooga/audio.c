@@ -1262,6 +1262,9 @@ audio_player_get_one() {
 			if (!block->players[i].allocated) {
 			
 				memset(&block->players[i], 0, sizeof(block->players[i]));
+#if ENABLE_PROFILING
+				spinlock_init_named(&block->players[i].sample_lock, "audio player sample_lock");
+#endif
 				block->players[i].allocated = true;
 				block->players[i].config.volume = 1.0;
 				block->players[i].config.playback_speed = 1.0;
@@ -1284,9 +1287,12 @@ audio_player_get_one() {
 
 	last->next = new_block;
 
+#if ENABLE_PROFILING
+	spinlock_init_named(&new_block->players[0].sample_lock, "audio player sample_lock");
+#endif
 	new_block->players[0].allocated = true;
 	new_block->players[0].config.volume = 1.0;
-	block->players[0].config.playback_speed = 1.0;
+	new_block->players[0].config.playback_speed = 1.0;
 	return &new_block->players[0];
 }
 
@@ -1781,6 +1787,8 @@ do_program_audio_sample(u64 number_of_output_frames, Audio_Format out_format,
 		growing_array_resize((void**)&audio_source_start_time_records, next_audio_source_uid);
 	}
 	
+	u64 active_player_count = 0;
+	
 	while (block) {
 		
 		for (u64 i = 0; i < AUDIO_PLAYERS_PER_BLOCK; i++) {
@@ -1808,6 +1816,8 @@ do_program_audio_sample(u64 number_of_output_frames, Audio_Format out_format,
 			
 			if (p->frame_index >= p->source.number_of_frames && !p->looping) continue;
 			
+			active_player_count += 1;
+			
 			spinlock_acquire_or_wait(&p->sample_lock);
 			
 			audio_prepare_intermediate_buffers();
@@ -2054,4 +2064,6 @@ do_program_audio_sample(u64 number_of_output_frames, Audio_Format out_format,
 		
 		block = block->next;
 	}
+	
+	tm_gauge("active audio players", active_player_count);
 }
@@ -84,6 +84,10 @@ typedef struct Allocator {
 Allocator
 get_heap_allocator();
 
+// Biggest size the heap allocator can hand out in one allocation
+u64
+get_heap_max_allocation_size();
+
 ogb_instance Allocator
 get_temporary_allocator();
 
@@ -114,6 +118,9 @@ alloc_uninitialized(Allocator allocator, u64 size);
 ogb_instance void 
 dealloc(Allocator allocator, void *p);
 
+ogb_instance void* 
+reallocate(Allocator allocator, void *p, u64 old_size, u64 new_size);
+
 ogb_instance void 
 push_context(Context c);
 
@@ -151,6 +158,24 @@ dealloc(Allocator allocator, void *p) {
 	allocator.proc(0, p, ALLOCATOR_DEALLOCATE, allocator.data);
 }
 
+// Grows or shrinks p from old_size to new_size, keeping its contents, and returns the new pointer.
+// The heap allocator grows in place when it can, so this is usually cheaper than alloc+copy.
+// Allocators that can't reallocate return 0 for ALLOCATOR_REALLOCATE, and then we alloc+copy here.
+// If p is 0 this is the same as alloc_uninitialized. Memory past old_size is not zeroed.
+void* 
+reallocate(Allocator allocator, void *p, u64 old_size, u64 new_size) {
+	assert(new_size > 0, "You requested a reallocation to zero bytes. Use dealloc for that.");
+	if (!p) return alloc_uninitialized(allocator, new_size);
+	
+	void *result = allocator.proc(new_size, p, ALLOCATOR_REALLOCATE, allocator.data);
+	if (result) return result;
+	
+	result = alloc_uninitialized(allocator, new_size);
+	memcpy(result, p, old_size < new_size ? old_size : new_size);
+	dealloc(allocator, p);
+	return result;
+}
+
 void 
 push_context(Context c) {
 	assert(num_contexts < CONTEXT_STACK_MAX, "Context stack overflow");
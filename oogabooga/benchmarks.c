@@ -0,0 +1,1706 @@
+
+/*
+	Micro benchmarks, run with RUN_BENCHMARKS 1 (after the tests, before the entry procedure).
+
+	Each benchmark runs BENCHMARK_WARMUP_REPETITIONS untimed repetitions and then
+	BENCHMARK_REPETITIONS timed ones, timed with rdtsc. We report the median time per operation
+	and the median absolute deviation (MAD), which unlike mean and standard deviation don't care
+	about the odd repetition where the OS decided to do something else.
+
+	Results are printed and written to BENCHMARK_RESULTS_PATH as json:
+
+		{"benchmarks":[
+		{"name":"heap alloc+dealloc 64b","ops":4096,"median_ns":21.502,"mad_ns":0.310,"min_ns":20.977},
+		...
+		]}
+
+	Comparing against a baseline:
+
+		Run once with BENCHMARK_SAVE_BASELINE 1 to write the results to BENCHMARK_BASELINE_PATH.
+		Following runs compare against it and flag every benchmark whose median got more than
+		BENCHMARK_REGRESSION_THRESHOLD slower, and by more than 3 MADs so noise isn't flagged.
+		oogabooga_run_benchmarks() returns the number of regressions.
+
+	Adding a benchmark:
+
+		void benchmark_my_thing(u64 op_count, void *data) {
+			for (u64 i = 0; i < op_count; i += 1) my_thing();
+		}
+		...
+		benchmark_run(&suite, "my thing", 1024, 0, benchmark_my_thing, 0);
+
+		The optional setup procedure runs before every repetition and isn't timed.
+		Write results you don't otherwise use to benchmark_sink so the compiler can't
+		throw the work away.
+*/
+
+#ifndef BENCHMARK_REPETITIONS
+	#define BENCHMARK_REPETITIONS 31
+#endif
+#ifndef BENCHMARK_WARMUP_REPETITIONS
+	#define BENCHMARK_WARMUP_REPETITIONS 3
+#endif
+#ifndef BENCHMARK_REGRESSION_THRESHOLD
+	#define BENCHMARK_REGRESSION_THRESHOLD 0.10
+#endif
+#ifndef BENCHMARK_SAVE_BASELINE
+	#define BENCHMARK_SAVE_BASELINE 0
+#endif
+#ifndef BENCHMARK_RESULTS_PATH
+	#define BENCHMARK_RESULTS_PATH "benchmark_results.json"
+#endif
+#ifndef BENCHMARK_BASELINE_PATH
+	#define BENCHMARK_BASELINE_PATH "benchmark_baseline.json"
+#endif
+
+#define MAX_BENCHMARKS 256
+
+typedef void(*Benchmark_Proc)(u64 op_count, void *data);
+
+typedef struct Benchmark_Result {
+	const char *name;
+	u64 op_count; // Per repetition
+	f64 median_ns; // Per op
+	f64 mad_ns;
+	f64 min_ns;
+} Benchmark_Result;
+
+typedef struct Benchmark_Suite {
+	Benchmark_Result results[MAX_BENCHMARKS];
+	u64 count;
+} Benchmark_Suite;
+
+volatile u64 benchmark_sink = 0;
+
+// Aligns the numbers after names in the printed table
+const char *_benchmark_padding(const char *name) {
+	const char *spaces = "                                             ";
+	return spaces + min(length_of_null_terminated_string(name), length_of_null_terminated_string(spaces));
+}
+
+void _benchmark_sort_f64(f64 *values, u64 count) {
+	for (u64 i = 1; i < count; i += 1) {
+		f64 v = values[i];
+		s64 j = (s64)i-1;
+		while (j >= 0 && values[j] > v) {
+			values[j+1] = values[j];
+			j -= 1;
+		}
+		values[j+1] = v;
+	}
+}
+
+Benchmark_Result *
+benchmark_run(Benchmark_Suite *suite, const char *name, u64 op_count, Benchmark_Proc setup, Benchmark_Proc proc, void *data) {
+	assert(suite->count < MAX_BENCHMARKS, "Too many benchmarks, max is %d", MAX_BENCHMARKS);
+
+	profiler_init(); // For cycles to seconds
+
+	for (u64 i = 0; i < BENCHMARK_WARMUP_REPETITIONS; i += 1) {
+		if (setup) setup(op_count, data);
+		proc(op_count, data);
+	}
+
+	f64 ns_per_op[BENCHMARK_REPETITIONS];
+	for (u64 i = 0; i < BENCHMARK_REPETITIONS; i += 1) {
+		if (setup) setup(op_count, data);
+
+		u64 start_cycles = rdtsc();
+		proc(op_count, data);
+		u64 end_cycles = rdtsc();
+
+		ns_per_op[i] = profiler_cycles_to_seconds(end_cycles-start_cycles) * 1000000000.0 / (f64)op_count;
+	}
+
+	_benchmark_sort_f64(ns_per_op, BENCHMARK_REPETITIONS);
+	f64 median = ns_per_op[BENCHMARK_REPETITIONS/2];
+
+	f64 deviations[BENCHMARK_REPETITIONS];
+	for (u64 i = 0; i < BENCHMARK_REPETITIONS; i += 1) deviations[i] = fabs(ns_per_op[i]-median);
+	_benchmark_sort_f64(deviations, BENCHMARK_REPETITIONS);
+
+	Benchmark_Result *r = &suite->results[suite->count];
+	suite->count += 1;
+
+	r->name      = name;
+	r->op_count  = op_count;
+	r->median_ns = median;
+	r->mad_ns    = deviations[BENCHMARK_REPETITIONS/2];
+	r->min_ns    = ns_per_op[0];
+
+	print("%cs%cs %12.3f ns/op  (mad %.3f, min %.3f)\n", name, _benchmark_padding(name), r->median_ns, r->mad_ns, r->min_ns);
+
+	return r;
+}
+
+string benchmark_suite_to_json(Benchmark_Suite *suite, Allocator allocator) {
+	String_Builder sb;
+	string_builder_init_reserve(&sb, suite->count*128 + 64, allocator);
+	string_builder_print(&sb, "{\"benchmarks\":[\n");
+	for (u64 i = 0; i < suite->count; i += 1) {
+		Benchmark_Result *r = &suite->results[i];
+		string_builder_print(&sb, "{\"name\":\"%cs\",\"ops\":%llu,\"median_ns\":%.3f,\"mad_ns\":%.3f,\"min_ns\":%.3f}%cs\n",
+			r->name, r->op_count, r->median_ns, r->mad_ns, r->min_ns, i+1 < suite->count ? "," : "");
+	}
+	string_builder_print(&sb, "]}\n");
+	return string_builder_get_string(sb);
+}
+
+// Only parses what benchmark_suite_to_json writes
+f64 _benchmark_parse_f64(string s) {
+	f64 result = 0;
+	u64 i = 0;
+	while (i < s.count && s.data[i] >= '0' && s.data[i] <= '9') {
+		result = result*10.0 + (f64)(s.data[i]-'0');
+		i += 1;
+	}
+	if (i < s.count && s.data[i] == '.') {
+		i += 1;
+		f64 scale = 0.1;
+		while (i < s.count && s.data[i] >= '0' && s.data[i] <= '9') {
+			result += (f64)(s.data[i]-'0')*scale;
+			scale *= 0.1;
+			i += 1;
+		}
+	}
+	return result;
+}
+bool _benchmark_find_in_json(string json, const char *name, Benchmark_Result *out) {
+	string key = tprint("{\"name\":\"%cs\",", name);
+	s64 index = string_find_from_left(json, key);
+	if (index < 0) return false;
+
+	string rest = string_view(json, index, json.count-index);
+
+	s64 median_index = string_find_from_left(rest, STR("\"median_ns\":"));
+	s64 mad_index    = string_find_from_left(rest, STR("\"mad_ns\":"));
+	if (median_index < 0 || mad_index < 0) return false;
+
+	*out = ZERO(Benchmark_Result);
+	out->name      = name;
+	out->median_ns = _benchmark_parse_f64(string_view(rest, median_index+12, rest.count-median_index-12));
+	out->mad_ns    = _benchmark_parse_f64(string_view(rest, mad_index+9, rest.count-mad_index-9));
+	return true;
+}
+
+// Returns the number of regressions
+u64 benchmark_suite_compare_to_baseline(Benchmark_Suite *suite, string baseline_json) {
+	u64 regression_count = 0;
+
+	print("\nCompared to %cs:\n", BENCHMARK_BASELINE_PATH);
+	for (u64 i = 0; i < suite->count; i += 1) {
+		Benchmark_Result *r = &suite->results[i];
+		Benchmark_Result base;
+		if (!_benchmark_find_in_json(baseline_json, r->name, &base)) {
+			print("%cs: not in baseline\n", r->name);
+			continue;
+		}
+
+		f64 delta = r->median_ns - base.median_ns;
+		f64 noise = 3.0*max(r->mad_ns, base.mad_ns);
+		bool regressed = delta > base.median_ns*BENCHMARK_REGRESSION_THRESHOLD && delta > noise;
+		bool improved = -delta > base.median_ns*BENCHMARK_REGRESSION_THRESHOLD && -delta > noise;
+
+		f64 percent = base.median_ns > 0 ? delta/base.median_ns*100.0 : 0;
+		print("%cs%cs %+8.1f%%  (%.3f -> %.3f ns/op)%cs\n",
+			r->name, _benchmark_padding(r->name),
+			percent, base.median_ns, r->median_ns,
+			regressed ? "  REGRESSION" : (improved ? "  improved" : ""));
+
+		if (regressed) regression_count += 1;
+	}
+
+	return regression_count;
+}
+
+///
+// Core module benchmarks
+///
+
+void benchmark_heap_alloc_dealloc(u64 op_count, void *data) {
+	u64 size = (u64)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		void *p = alloc(get_heap_allocator(), size);
+		dealloc(get_heap_allocator(), p);
+	}
+}
+
+// Allocates op_count blocks of varying sizes, then frees them in a scrambled order
+void benchmark_heap_mixed(u64 op_count, void *data) {
+	void **pointers = (void**)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		pointers[i] = alloc(get_heap_allocator(), 16 + (i*7919) % 2048);
+	}
+	for (u64 i = 0; i < op_count; i += 1) {
+		dealloc(get_heap_allocator(), pointers[(i*4099) % op_count]);
+	}
+}
+
+void benchmark_talloc(u64 op_count, void *data) {
+	void *temporary_storage_pointer_before = temporary_storage_pointer;
+	for (u64 i = 0; i < op_count; i += 1) {
+		u8 *p = talloc(64);
+		p[0] = (u8)i;
+	}
+	temporary_storage_pointer = temporary_storage_pointer_before;
+}
+
+// op is hashing size bytes. We hash at 8 different offsets so it's not always aligned.
+typedef struct Benchmark_Hash_Data {
+	u8 *data; // size+8 bytes
+	u64 size;
+} Benchmark_Hash_Data;
+
+void benchmark_hash_bytes(u64 op_count, void *data) {
+	Benchmark_Hash_Data *d = (Benchmark_Hash_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) sum += hash_bytes(d->data + (i & 7), d->size);
+	benchmark_sink += sum;
+}
+// What string_get_hash used for strings longer than 32 bytes, to compare against
+void benchmark_djb2_hash(u64 op_count, void *data) {
+	Benchmark_Hash_Data *d = (Benchmark_Hash_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) sum += djb2_hash((string){ d->size, d->data + (i & 7) });
+	benchmark_sink += sum;
+}
+
+void _benchmark_run_hash(Benchmark_Suite *suite, const char *name, Benchmark_Proc proc, Benchmark_Hash_Data *d, u64 op_count) {
+	Benchmark_Result *r = benchmark_run(suite, name, op_count, 0, proc, d);
+	print("    %.2f GB/s\n", (f64)d->size / r->median_ns);
+}
+
+typedef struct Benchmark_Hash_Table_Data {
+	Hash_Table table;
+	u64 *keys;
+	u64 entry_count;
+	u64 churn_position;
+} Benchmark_Hash_Table_Data;
+
+void benchmark_hash_table_setup(u64 op_count, void *data) {
+	Benchmark_Hash_Table_Data *d = (Benchmark_Hash_Table_Data*)data;
+	hash_table_reset(&d->table);
+}
+// op is adding one entry, op_count must be entry_count
+void benchmark_hash_table_add(u64 op_count, void *data) {
+	Benchmark_Hash_Table_Data *d = (Benchmark_Hash_Table_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		u64 value = i;
+		hash_table_add(&d->table, d->keys[i], value);
+	}
+}
+void benchmark_hash_table_fill(u64 op_count, void *data) {
+	Benchmark_Hash_Table_Data *d = (Benchmark_Hash_Table_Data*)data;
+	if (d->table.count == d->entry_count) return;
+	hash_table_reset(&d->table);
+	benchmark_hash_table_add(d->entry_count, data);
+}
+// op is one lookup of an existing key
+void benchmark_hash_table_find(u64 op_count, void *data) {
+	Benchmark_Hash_Table_Data *d = (Benchmark_Hash_Table_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		u64 *value = hash_table_find(&d->table, d->keys[(i*2654435761ull) % d->entry_count]);
+		sum += *value;
+	}
+	benchmark_sink += sum;
+}
+// Steady state: the table holds keys[churn_position] to keys[churn_position+entry_count-1]
+// (wrapping around at 2*entry_count). op is removing the oldest key and adding a new one.
+void benchmark_hash_table_churn_setup(u64 op_count, void *data) {
+	Benchmark_Hash_Table_Data *d = (Benchmark_Hash_Table_Data*)data;
+	if (d->table.count == d->entry_count) return;
+	hash_table_clear(&d->table);
+	d->churn_position = 0;
+	benchmark_hash_table_add(d->entry_count, data);
+}
+void benchmark_hash_table_churn(u64 op_count, void *data) {
+	Benchmark_Hash_Table_Data *d = (Benchmark_Hash_Table_Data*)data;
+	u64 key_count = d->entry_count*2;
+	for (u64 i = 0; i < op_count; i += 1) {
+		u64 oldest = d->churn_position % key_count;
+		u64 newest = (d->churn_position + d->entry_count) % key_count;
+		hash_table_remove(&d->table, d->keys[oldest]);
+		hash_table_add(&d->table, d->keys[newest], i);
+		d->churn_position += 1;
+	}
+}
+// The linear scan Hash_Table did before it had an index, to compare against
+void benchmark_hash_table_find_linear(u64 op_count, void *data) {
+	Benchmark_Hash_Table_Data *d = (Benchmark_Hash_Table_Data*)data;
+	Hash_Table *t = &d->table;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		u64 hash = get_hash(d->keys[(i*2654435761ull) % d->entry_count]);
+		for (u64 j = 0; j < t->count; j += 1) {
+			u8 *entry = (u8*)t->entries+j*t->_entry_size;
+			if (*(u64*)entry == hash) {
+				sum += *(u64*)(entry+t->_value_offset);
+				break;
+			}
+		}
+	}
+	benchmark_sink += sum;
+}
+
+// Typed maps against Hash_Table for the same keys and values
+
+typedef struct Benchmark_Map_Value {
+	Vector4 color;
+	u64 id;
+} Benchmark_Map_Value;
+
+DEFINE_HASH_MAP(Benchmark_Pointer_Map, u64, void*, get_hash, hash_map_equals);
+DEFINE_HASH_MAP(Benchmark_String_Map, string, Benchmark_Map_Value, string_get_hash, strings_match);
+
+typedef struct Benchmark_Hash_Map_Data {
+	u64 *keys;
+	string *string_keys;
+	Hash_Table pointer_table;
+	Hash_Table string_table;
+	Benchmark_Pointer_Map pointer_map;
+	Benchmark_String_Map string_map;
+} Benchmark_Hash_Map_Data;
+
+void benchmark_hash_map_setup(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	hash_table_clear(&d->pointer_table);
+	hash_table_clear(&d->string_table);
+	Benchmark_Pointer_Map_clear(&d->pointer_map);
+	Benchmark_String_Map_clear(&d->string_map);
+}
+void benchmark_hash_table_add_pointer(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		void *value = d->keys+i;
+		hash_table_add(&d->pointer_table, d->keys[i], value);
+	}
+}
+void benchmark_hash_map_add_pointer(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		Benchmark_Pointer_Map_add(&d->pointer_map, d->keys[i], d->keys+i);
+	}
+}
+void benchmark_hash_table_find_pointer(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		void **value = hash_table_find(&d->pointer_table, d->keys[(i*2654435761ull) % op_count]);
+		sum += (u64)*value;
+	}
+	benchmark_sink += sum;
+}
+void benchmark_hash_map_find_pointer(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		void **value = Benchmark_Pointer_Map_find(&d->pointer_map, d->keys[(i*2654435761ull) % op_count]);
+		sum += (u64)*value;
+	}
+	benchmark_sink += sum;
+}
+void benchmark_hash_table_add_string(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		Benchmark_Map_Value value = { v4(1, 1, 1, 1), i };
+		hash_table_add(&d->string_table, d->string_keys[i], value);
+	}
+}
+void benchmark_hash_map_add_string(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		Benchmark_String_Map_add(&d->string_map, d->string_keys[i], (Benchmark_Map_Value){ v4(1, 1, 1, 1), i });
+	}
+}
+void benchmark_hash_table_find_string(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		Benchmark_Map_Value *value = hash_table_find(&d->string_table, d->string_keys[(i*2654435761ull) % op_count]);
+		sum += value->id;
+	}
+	benchmark_sink += sum;
+}
+void benchmark_hash_map_find_string(u64 op_count, void *data) {
+	Benchmark_Hash_Map_Data *d = (Benchmark_Hash_Map_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		Benchmark_Map_Value *value = Benchmark_String_Map_find(&d->string_map, d->string_keys[(i*2654435761ull) % op_count]);
+		sum += value->id;
+	}
+	benchmark_sink += sum;
+}
+
+// String interning. Lookups are of strings which are already interned, and the compares are
+// of equal strings in different memory, which is the worst case for strings_match.
+typedef struct Benchmark_Intern_Data {
+	String_Interner interner;
+	string *keys;
+	string *copies;
+	Interned_String *ids;
+	Interned_String *copy_ids;
+} Benchmark_Intern_Data;
+
+void benchmark_string_intern_setup(u64 op_count, void *data) {
+	Benchmark_Intern_Data *d = (Benchmark_Intern_Data*)data;
+	bool thread_safe = d->interner.thread_safe;
+	string_interner_destroy(&d->interner);
+	d->interner = thread_safe ? make_string_interner_thread_safe(get_heap_allocator()) : make_string_interner(get_heap_allocator());
+}
+void benchmark_string_intern_new(u64 op_count, void *data) {
+	Benchmark_Intern_Data *d = (Benchmark_Intern_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		d->ids[i] = string_intern(&d->interner, d->keys[i]);
+	}
+}
+void benchmark_string_intern_existing(u64 op_count, void *data) {
+	Benchmark_Intern_Data *d = (Benchmark_Intern_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		sum += string_intern(&d->interner, d->copies[(i*2654435761ull) % op_count]);
+	}
+	benchmark_sink += sum;
+}
+void benchmark_strings_match_equal(u64 op_count, void *data) {
+	Benchmark_Intern_Data *d = (Benchmark_Intern_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		sum += strings_match(d->keys[i], d->copies[i]);
+	}
+	benchmark_sink += sum;
+}
+void benchmark_interned_strings_match_equal(u64 op_count, void *data) {
+	Benchmark_Intern_Data *d = (Benchmark_Intern_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		sum += d->ids[i] == d->copy_ids[i];
+	}
+	benchmark_sink += sum;
+}
+void benchmark_string_get_hash(u64 op_count, void *data) {
+	Benchmark_Intern_Data *d = (Benchmark_Intern_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		sum += string_get_hash(d->keys[i]);
+	}
+	benchmark_sink += sum;
+}
+void benchmark_string_interner_get_hash(u64 op_count, void *data) {
+	Benchmark_Intern_Data *d = (Benchmark_Intern_Data*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		sum += string_interner_get_hash(&d->interner, d->ids[i]);
+	}
+	benchmark_sink += sum;
+}
+
+// Concurrent hash table scaling. Every thread does the same mix of finds and sets of random
+// existing keys, against the sharded table and against a Hash_Table behind one Mutex. op is
+// one find or set, timed over all threads, so ns/op going down with more threads is scaling.
+#define BENCHMARK_CONCURRENT_MAX_THREADS 16
+#define BENCHMARK_CONCURRENT_SETS_PER_100 5
+typedef struct Benchmark_Concurrent_Data {
+	Concurrent_Hash_Table table;
+	Hash_Table locked_table;
+	Mutex mutex;
+	bool use_mutex;
+
+	u64 *keys;
+	u64 key_count;
+
+	u64 thread_count;
+	u64 ops_per_thread;
+} Benchmark_Concurrent_Data;
+
+typedef struct Benchmark_Concurrent_Worker {
+	Benchmark_Concurrent_Data *d;
+	u64 thread_index;
+	u64 sum;
+} Benchmark_Concurrent_Worker;
+
+void _benchmark_concurrent_work(Benchmark_Concurrent_Worker *w) {
+	Benchmark_Concurrent_Data *d = w->d;
+
+	// get_random() isn't thread safe, so each thread has its own generator
+	u64 state = w->thread_index*0x9E3779B97F4A7C15ull + 1;
+	u64 sum = 0;
+	for (u64 i = 0; i < d->ops_per_thread; i += 1) {
+		state = state*6364136223846793005ull + 1442695040888963407ull;
+		u64 key = d->keys[(state >> 33) % d->key_count];
+		bool is_set = (state >> 20) % 100 < BENCHMARK_CONCURRENT_SETS_PER_100;
+
+		if (d->use_mutex) {
+			mutex_acquire_or_wait(&d->mutex);
+			if (is_set) {
+				hash_table_set(&d->locked_table, key, i);
+			} else {
+				sum += *(u64*)hash_table_find(&d->locked_table, key);
+			}
+			mutex_release(&d->mutex);
+		} else {
+			if (is_set) {
+				concurrent_hash_table_set(&d->table, key, i);
+			} else {
+				u64 value;
+				concurrent_hash_table_find(&d->table, key, &value);
+				sum += value;
+			}
+		}
+	}
+	w->sum = sum;
+}
+void _benchmark_concurrent_thread_proc(Thread *t) {
+	_benchmark_concurrent_work((Benchmark_Concurrent_Worker*)t->data);
+}
+
+void benchmark_concurrent_hash_table(u64 op_count, void *data) {
+	Benchmark_Concurrent_Data *d = (Benchmark_Concurrent_Data*)data;
+	d->ops_per_thread = op_count/d->thread_count;
+
+	Thread threads[BENCHMARK_CONCURRENT_MAX_THREADS];
+	Benchmark_Concurrent_Worker workers[BENCHMARK_CONCURRENT_MAX_THREADS];
+
+	// This thread is worker 0
+	for (u64 i = 0; i < d->thread_count; i += 1) {
+		workers[i] = (Benchmark_Concurrent_Worker){ d, i, 0 };
+	}
+	for (u64 i = 1; i < d->thread_count; i += 1) {
+		os_thread_init(&threads[i], _benchmark_concurrent_thread_proc);
+		threads[i].data = &workers[i];
+		os_thread_start(&threads[i]);
+	}
+	_benchmark_concurrent_work(&workers[0]);
+	for (u64 i = 1; i < d->thread_count; i += 1) {
+		os_thread_join(&threads[i]);
+		os_thread_destroy(&threads[i]);
+	}
+
+	for (u64 i = 0; i < d->thread_count; i += 1) benchmark_sink += workers[i].sum;
+}
+
+void benchmark_growing_array_add(u64 op_count, void *data) {
+	u64 *array;
+	growing_array_init((void**)&array, sizeof(u64), get_heap_allocator());
+	for (u64 i = 0; i < op_count; i += 1) {
+		growing_array_add((void**)&array, &i);
+	}
+	benchmark_sink += array[op_count-1];
+	growing_array_deinit((void**)&array);
+}
+typedef struct Benchmark_Growing_Array_Data {
+	float32 growth_factor;
+	u64 growth_chunk_count; // Uses growth_factor if 0
+	bool reserve_up_front;
+} Benchmark_Growing_Array_Data;
+void benchmark_growing_array_append(u64 op_count, void *data) {
+	Benchmark_Growing_Array_Data *d = (Benchmark_Growing_Array_Data*)data;
+	u32 *array;
+	growing_array_init_reserve((void**)&array, sizeof(u32), d->reserve_up_front ? op_count : 8, get_heap_allocator());
+	if (d->growth_chunk_count) growing_array_set_growth_chunk((void**)&array, d->growth_chunk_count);
+	else growing_array_set_growth_factor((void**)&array, d->growth_factor);
+	for (u32 i = 0; i < op_count; i += 1) {
+		growing_array_add((void**)&array, &i);
+	}
+	benchmark_sink += array[op_count-1];
+	growing_array_deinit((void**)&array);
+}
+void benchmark_growing_array_unordered_remove(u64 op_count, void *data) {
+	u64 **array = (u64**)data;
+	while (growing_array_get_valid_count(*array) > 0) {
+		growing_array_unordered_remove_by_index((void**)array, 0);
+	}
+}
+void benchmark_growing_array_fill(u64 op_count, void *data) {
+	u64 **array = (u64**)data;
+	growing_array_clear((void**)array);
+	for (u64 i = 0; i < op_count; i += 1) growing_array_add((void**)array, &i);
+}
+
+// Filtering, removing the dead quarter of an array of entities
+typedef struct Benchmark_Entity {
+	Vector3 position;
+	Vector3 velocity;
+	float32 health;
+	u32 flags;
+	u8 other_stuff[32];
+} Benchmark_Entity;
+typedef struct Benchmark_Filter_Data {
+	Benchmark_Entity *source;
+	Benchmark_Entity *entities; // Growing array
+	u64 *mask;
+} Benchmark_Filter_Data;
+
+bool benchmark_entity_is_dead(void *item, void *user_data) {
+	return ((Benchmark_Entity*)item)->health <= 0;
+}
+void benchmark_filter_setup(u64 op_count, void *data) {
+	Benchmark_Filter_Data *d = (Benchmark_Filter_Data*)data;
+	growing_array_clear((void**)&d->entities);
+	growing_array_add_multiple((void**)&d->entities, d->source, op_count);
+}
+void benchmark_filter_unordered_remove(u64 op_count, void *data) {
+	Benchmark_Filter_Data *d = (Benchmark_Filter_Data*)data;
+	for (s64 i = (s64)op_count-1; i >= 0; i -= 1) {
+		if (d->entities[i].health <= 0) growing_array_unordered_remove_by_index((void**)&d->entities, i);
+	}
+	benchmark_sink += growing_array_get_valid_count(d->entities);
+}
+void benchmark_filter_ordered_remove(u64 op_count, void *data) {
+	Benchmark_Filter_Data *d = (Benchmark_Filter_Data*)data;
+	for (s64 i = (s64)op_count-1; i >= 0; i -= 1) {
+		if (d->entities[i].health <= 0) growing_array_ordered_remove_by_index((void**)&d->entities, i);
+	}
+	benchmark_sink += growing_array_get_valid_count(d->entities);
+}
+void benchmark_filter_remove_if(u64 op_count, void *data) {
+	Benchmark_Filter_Data *d = (Benchmark_Filter_Data*)data;
+	benchmark_sink += growing_array_remove_if((void**)&d->entities, benchmark_entity_is_dead, 0);
+}
+void benchmark_filter_remove_by_mask(u64 op_count, void *data) {
+	Benchmark_Filter_Data *d = (Benchmark_Filter_Data*)data;
+	memset(d->mask, 0, ((op_count+63)/64)*sizeof(u64));
+	for (u64 i = 0; i < op_count; i += 1) {
+		d->mask[i/64] |= (u64)(d->entities[i].health <= 0) << (i%64);
+	}
+	benchmark_sink += growing_array_remove_by_mask((void**)&d->entities, d->mask);
+}
+
+// Pushing with growing_array_add against the typed push from DEFINE_GROWING_ARRAY
+DEFINE_GROWING_ARRAY(Benchmark_U64_Array, u64);
+DEFINE_GROWING_ARRAY(Benchmark_Entity_Array, Benchmark_Entity);
+void benchmark_growing_array_push_untyped(u64 op_count, void *data) {
+	u64 *array;
+	growing_array_init((void**)&array, sizeof(u64), get_heap_allocator());
+	for (u64 i = 0; i < op_count; i += 1) {
+		growing_array_add((void**)&array, &i);
+	}
+	benchmark_sink += array[op_count-1];
+	growing_array_deinit((void**)&array);
+}
+void benchmark_growing_array_push_typed(u64 op_count, void *data) {
+	u64 *array;
+	Benchmark_U64_Array_init(&array, get_heap_allocator());
+	for (u64 i = 0; i < op_count; i += 1) {
+		Benchmark_U64_Array_push(&array, i);
+	}
+	benchmark_sink += array[op_count-1];
+	Benchmark_U64_Array_deinit(&array);
+}
+void benchmark_growing_array_push_entity_untyped(u64 op_count, void *data) {
+	Benchmark_Entity *array;
+	growing_array_init((void**)&array, sizeof(Benchmark_Entity), get_heap_allocator());
+	Benchmark_Entity entity = ZERO(Benchmark_Entity);
+	for (u64 i = 0; i < op_count; i += 1) {
+		entity.flags = (u32)i;
+		growing_array_add((void**)&array, &entity);
+	}
+	benchmark_sink += array[op_count-1].flags;
+	growing_array_deinit((void**)&array);
+}
+void benchmark_growing_array_push_entity_typed(u64 op_count, void *data) {
+	Benchmark_Entity *array;
+	Benchmark_Entity_Array_init(&array, get_heap_allocator());
+	Benchmark_Entity entity = ZERO(Benchmark_Entity);
+	for (u64 i = 0; i < op_count; i += 1) {
+		entity.flags = (u32)i;
+		Benchmark_Entity_Array_push(&array, entity);
+	}
+	benchmark_sink += array[op_count-1].flags;
+	Benchmark_Entity_Array_deinit(&array);
+}
+
+// Slot map against a growing array with an allocated flag per item, which is searched for a
+// free item on add, the way emissions in ext_particles used to be
+typedef struct Benchmark_Sparse_Entity {
+	Benchmark_Entity entity;
+	bool allocated;
+	u32 generation;
+} Benchmark_Sparse_Entity;
+DEFINE_SLOT_MAP(Benchmark_Entity_Map, Benchmark_Entity);
+typedef struct Benchmark_Slot_Map_Data {
+	Benchmark_Entity_Map map;
+	Benchmark_Sparse_Entity *sparse; // Growing array
+	Slot_Map_Handle *handles;
+	Slot_Map_Handle *sparse_handles; // Index into sparse, in the same order as handles
+	u64 live_count;
+	u32 *random_indices; // Into handles and sparse_handles
+} Benchmark_Slot_Map_Data;
+
+void benchmark_slot_map_fill(Benchmark_Slot_Map_Data *d, u64 count, u64 remove_count) {
+	Benchmark_Entity_Map_clear(&d->map);
+	growing_array_clear((void**)&d->sparse);
+	Benchmark_Entity entity = ZERO(Benchmark_Entity);
+	for (u64 i = 0; i < count; i += 1) {
+		entity.health = (float32)i;
+		d->handles[i] = Benchmark_Entity_Map_add(&d->map, entity);
+		Benchmark_Sparse_Entity *sparse = growing_array_add_empty((void**)&d->sparse);
+		sparse->entity = entity;
+		sparse->allocated = true;
+		sparse->generation = 0;
+		d->sparse_handles[i] = (Slot_Map_Handle){ (u32)i, 0 };
+	}
+	// Remove from random places, so the sparse array has holes
+	d->live_count = count;
+	for (u64 i = 0; i < remove_count; i += 1) {
+		u64 n = get_random() % d->live_count;
+		Benchmark_Entity_Map_remove(&d->map, d->handles[n]);
+		d->sparse[d->sparse_handles[n].index].allocated = false;
+		d->live_count -= 1;
+		d->handles[n] = d->handles[d->live_count];
+		d->sparse_handles[n] = d->sparse_handles[d->live_count];
+	}
+}
+void benchmark_slot_map_iterate(u64 op_count, void *data) {
+	Benchmark_Slot_Map_Data *d = (Benchmark_Slot_Map_Data*)data;
+	float32 sum = 0;
+	for (u64 i = 0; i < d->map.count; i += 1) {
+		sum += d->map.values[i].health;
+	}
+	benchmark_sink += (u64)sum;
+}
+void benchmark_sparse_array_iterate(u64 op_count, void *data) {
+	Benchmark_Slot_Map_Data *d = (Benchmark_Slot_Map_Data*)data;
+	float32 sum = 0;
+	u64 count = growing_array_get_valid_count(d->sparse);
+	for (u64 i = 0; i < count; i += 1) {
+		if (!d->sparse[i].allocated) continue;
+		sum += d->sparse[i].entity.health;
+	}
+	benchmark_sink += (u64)sum;
+}
+void benchmark_slot_map_get(u64 op_count, void *data) {
+	Benchmark_Slot_Map_Data *d = (Benchmark_Slot_Map_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		benchmark_sink += Benchmark_Entity_Map_get(&d->map, d->handles[d->random_indices[i]])->flags;
+	}
+}
+void benchmark_slot_map_churn(u64 op_count, void *data) {
+	Benchmark_Slot_Map_Data *d = (Benchmark_Slot_Map_Data*)data;
+	Benchmark_Entity entity = ZERO(Benchmark_Entity);
+	for (u64 i = 0; i < op_count; i += 1) {
+		u32 n = d->random_indices[i];
+		Benchmark_Entity_Map_remove(&d->map, d->handles[n]);
+		d->handles[n] = Benchmark_Entity_Map_add(&d->map, entity);
+	}
+	benchmark_sink += d->map.count;
+}
+void benchmark_sparse_array_churn(u64 op_count, void *data) {
+	Benchmark_Slot_Map_Data *d = (Benchmark_Slot_Map_Data*)data;
+	Benchmark_Entity entity = ZERO(Benchmark_Entity);
+	u64 count = growing_array_get_valid_count(d->sparse);
+	for (u64 i = 0; i < op_count; i += 1) {
+		u32 n = d->random_indices[i];
+		Slot_Map_Handle h = d->sparse_handles[n];
+		if (d->sparse[h.index].generation == h.generation) d->sparse[h.index].allocated = false;
+
+		for (u64 j = 0; j < count; j += 1) {
+			if (!d->sparse[j].allocated) {
+				d->sparse[j].entity = entity;
+				d->sparse[j].allocated = true;
+				d->sparse[j].generation += 1;
+				d->sparse_handles[n] = (Slot_Map_Handle){ (u32)j, d->sparse[j].generation };
+				break;
+			}
+		}
+	}
+	benchmark_sink += count;
+}
+
+typedef struct Benchmark_Sort_Item {
+	u64 key;
+	u64 payload;
+} Benchmark_Sort_Item;
+typedef struct Benchmark_Sort_Data {
+	Benchmark_Sort_Item *source;
+	Benchmark_Sort_Item *items;
+	Benchmark_Sort_Item *help;
+} Benchmark_Sort_Data;
+
+int benchmark_compare_sort_items(const void *a, const void *b) {
+	u64 ka = ((Benchmark_Sort_Item*)a)->key;
+	u64 kb = ((Benchmark_Sort_Item*)b)->key;
+	return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+void benchmark_sort_setup(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	memcpy(d->items, d->source, op_count*sizeof(Benchmark_Sort_Item));
+}
+void benchmark_radix_sort(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	radix_sort(d->items, d->help, op_count, sizeof(Benchmark_Sort_Item), offsetof(Benchmark_Sort_Item, key), 32);
+}
+void benchmark_merge_sort(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	merge_sort(d->items, d->help, op_count, sizeof(Benchmark_Sort_Item), benchmark_compare_sort_items);
+}
+
+void benchmark_quick_sort(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	quick_sort(d->items, op_count, sizeof(Benchmark_Sort_Item), benchmark_compare_sort_items);
+}
+#define benchmark_sort_item_less(a, b) ((a)->key < (b)->key)
+DEFINE_QUICK_SORT(benchmark_quick_sort_items, Benchmark_Sort_Item, benchmark_sort_item_less);
+void benchmark_quick_sort_typed(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	benchmark_quick_sort_items(d->items, op_count);
+}
+void benchmark_merge_sort_ping_pong(u64 op_count, void *data) {
+	Benchmark_Sort_Data *d = (Benchmark_Sort_Data*)data;
+	merge_sort_ping_pong(d->items, d->help, op_count, sizeof(Benchmark_Sort_Item), benchmark_compare_sort_items);
+}
+
+// Sorting by an f32, radix with flipped float bits vs comparing
+typedef struct Benchmark_Float_Sort_Item {
+	f32 key;
+	u32 payload;
+} Benchmark_Float_Sort_Item;
+typedef struct Benchmark_Float_Sort_Data {
+	Benchmark_Float_Sort_Item *source;
+	Benchmark_Float_Sort_Item *items;
+	void *help;
+} Benchmark_Float_Sort_Data;
+
+int benchmark_compare_float_sort_items(const void *a, const void *b) {
+	f32 ka = ((Benchmark_Float_Sort_Item*)a)->key;
+	f32 kb = ((Benchmark_Float_Sort_Item*)b)->key;
+	return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+#define benchmark_float_sort_item_less(a, b) ((a)->key < (b)->key)
+DEFINE_QUICK_SORT(benchmark_quick_sort_float_items, Benchmark_Float_Sort_Item, benchmark_float_sort_item_less);
+void benchmark_float_sort_setup(u64 op_count, void *data) {
+	Benchmark_Float_Sort_Data *d = (Benchmark_Float_Sort_Data*)data;
+	memcpy(d->items, d->source, op_count*sizeof(Benchmark_Float_Sort_Item));
+}
+void benchmark_radix_sort_by_key_f32(u64 op_count, void *data) {
+	Benchmark_Float_Sort_Data *d = (Benchmark_Float_Sort_Data*)data;
+	radix_sort_by_key_f32(d->items, d->help, op_count, sizeof(Benchmark_Float_Sort_Item), offsetof(Benchmark_Float_Sort_Item, key));
+}
+void benchmark_quick_sort_f32_typed(u64 op_count, void *data) {
+	Benchmark_Float_Sort_Data *d = (Benchmark_Float_Sort_Data*)data;
+	benchmark_quick_sort_float_items(d->items, op_count);
+}
+void benchmark_merge_sort_f32(u64 op_count, void *data) {
+	Benchmark_Float_Sort_Data *d = (Benchmark_Float_Sort_Data*)data;
+	merge_sort(d->items, d->help, op_count, sizeof(Benchmark_Float_Sort_Item), benchmark_compare_float_sort_items);
+}
+
+// Parallel radix sort on 1 to N threads
+typedef struct Benchmark_Parallel_Sort_Data {
+	u64 *source_keys;
+	u64 *keys;
+	u64 *payloads;
+	u64 *help_keys;
+	u64 *help_payloads;
+	u64 thread_count;
+} Benchmark_Parallel_Sort_Data;
+
+void benchmark_parallel_sort_setup(u64 op_count, void *data) {
+	Benchmark_Parallel_Sort_Data *d = (Benchmark_Parallel_Sort_Data*)data;
+	memcpy(d->keys, d->source_keys, op_count*sizeof(u64));
+	for (u64 i = 0; i < op_count; i += 1) d->payloads[i] = i;
+}
+void benchmark_radix_sort_u32_parallel(u64 op_count, void *data) {
+	Benchmark_Parallel_Sort_Data *d = (Benchmark_Parallel_Sort_Data*)data;
+	radix_sort_u32_parallel((u32*)d->keys, (u32*)d->payloads, (u32*)d->help_keys, (u32*)d->help_payloads, op_count, 32, d->thread_count);
+}
+void benchmark_radix_sort_u64_parallel(u64 op_count, void *data) {
+	Benchmark_Parallel_Sort_Data *d = (Benchmark_Parallel_Sort_Data*)data;
+	radix_sort_u64_parallel(d->keys, d->payloads, d->help_keys, d->help_payloads, op_count, 64, d->thread_count);
+}
+
+void benchmark_tprint(u64 op_count, void *data) {
+	void *temporary_storage_pointer_before = temporary_storage_pointer;
+	for (u64 i = 0; i < op_count; i += 1) {
+		string s = tprint("Entity %llu at (%.2f, %.2f) named %s", i, (f64)i*0.5, (f64)i*0.25, STR("Bob"));
+		benchmark_sink += s.count;
+		temporary_storage_pointer = temporary_storage_pointer_before;
+	}
+}
+void benchmark_string_builder_print(u64 op_count, void *data) {
+	String_Builder *sb = (String_Builder*)data;
+	sb->count = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		string_builder_print(sb, "%d,", (s32)i);
+	}
+	benchmark_sink += sb->count;
+}
+
+void benchmark_utf8_decode(u64 op_count, void *data) {
+	string text = *(string*)data;
+	u64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) {
+		string s = text;
+		while (s.count > 0) sum += next_utf8(&s);
+	}
+	benchmark_sink += sum;
+}
+
+// Searching through a few megabytes of text, ns per byte searched. The needles aren't in the
+// text so every search goes all the way through.
+typedef struct Benchmark_Search_Data {
+	string text;
+	string needle;
+	u8 c;
+} Benchmark_Search_Data;
+
+// What string_find_from_left used to do
+s64 benchmark_naive_find(string s, string sub) {
+	for (u64 i = 0; i + sub.count <= s.count; i += 1) {
+		if (memcmp(s.data + i, sub.data, sub.count) == 0) return (s64)i;
+	}
+	return -1;
+}
+void benchmark_find_naive(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	benchmark_sink += benchmark_naive_find(d->text, d->needle);
+}
+void benchmark_find_from_left(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	benchmark_sink += string_find_from_left(d->text, d->needle);
+}
+void benchmark_find_from_right(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	benchmark_sink += string_find_from_right(d->text, d->needle);
+}
+void benchmark_find_char_loop(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	s64 index = -1;
+	for (u64 i = 0; i < d->text.count; i += 1) {
+		if (d->text.data[i] == d->c) { index = (s64)i; break; }
+	}
+	benchmark_sink += index;
+}
+void benchmark_find_char(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	benchmark_sink += string_find_char(d->text, d->c);
+}
+void benchmark_count_char_loop(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	u64 count = 0;
+	for (u64 i = 0; i < d->text.count; i += 1) count += d->text.data[i] == d->c;
+	benchmark_sink += count;
+}
+void benchmark_count_char(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	benchmark_sink += string_count_char(d->text, d->c);
+}
+void benchmark_find_any_of(u64 op_count, void *data) {
+	Benchmark_Search_Data *d = (Benchmark_Search_Data*)data;
+	benchmark_sink += string_find_any_of(d->text, d->needle);
+}
+
+void benchmark_m4_mul(u64 op_count, void *data) {
+	Matrix4 m = m4_identity();
+	Matrix4 step = m4_make_rotation_z(0.001);
+	for (u64 i = 0; i < op_count; i += 1) {
+		m = m4_mul(m, step);
+	}
+	benchmark_sink += (u64)(m.m[0][0]*1000.0);
+}
+void benchmark_m4_inverse(u64 op_count, void *data) {
+	Matrix4 m = m4_mul(m4_make_translation(v3(1, 2, 3)), m4_make_rotation_z(0.5));
+	for (u64 i = 0; i < op_count; i += 1) {
+		m = m4_inverse(m);
+	}
+	benchmark_sink += (u64)(m.m[0][0]*1000.0);
+}
+
+#ifndef OOGABOOGA_HEADLESS
+typedef struct Benchmark_Audio_Data {
+	void *dst;
+	void *src;
+	Audio_Format dst_format;
+	Audio_Format src_format;
+} Benchmark_Audio_Data;
+
+// op is one frame
+void benchmark_mix_frames(u64 op_count, void *data) {
+	Benchmark_Audio_Data *d = (Benchmark_Audio_Data*)data;
+	mix_frames(d->dst, d->src, op_count, d->dst_format);
+}
+void benchmark_convert_frames(u64 op_count, void *data) {
+	Benchmark_Audio_Data *d = (Benchmark_Audio_Data*)data;
+	benchmark_sink += convert_frames(d->dst, d->dst_format, d->src, d->src_format, op_count);
+}
+#endif // NOT OOGABOOGA_HEADLESS
+
+// Z-sorting quads: radix_sort copies whole quads every pass, the key-index sorts only move
+// 8 byte keys. Each one then walks the quads in sorted order like gfx_render_draw_frame does, so
+// reading them through indices (in a random order) is part of the cost.
+typedef struct Benchmark_Quad_Sort_Data {
+	Draw_Quad *quads;
+	Draw_Quad *help;      // For radix_sort
+	void *key_help;       // For the key-index sorts
+	u32 *sorted_indices;
+	u64 layer_count;      // 0 for random z in the whole range
+} Benchmark_Quad_Sort_Data;
+
+void benchmark_quad_sort_setup(u64 op_count, void *data) {
+	Benchmark_Quad_Sort_Data *d = (Benchmark_Quad_Sort_Data*)data;
+	for (u64 i = 0; i < op_count; i += 1) {
+		if (d->layer_count) d->quads[i].z = (s32)(get_random() % d->layer_count);
+		else d->quads[i].z = (s32)(get_random() % (2*MAX_Z-1)) - MAX_Z + 1;
+	}
+}
+void benchmark_quad_radix_sort(u64 op_count, void *data) {
+	Benchmark_Quad_Sort_Data *d = (Benchmark_Quad_Sort_Data*)data;
+	radix_sort(d->quads, d->help, op_count, sizeof(Draw_Quad), offsetof(Draw_Quad, z), MAX_Z_BITS);
+	s64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) sum += d->quads[i].z;
+	benchmark_sink += sum;
+}
+void benchmark_quad_radix_sort_by_key(u64 op_count, void *data) {
+	Benchmark_Quad_Sort_Data *d = (Benchmark_Quad_Sort_Data*)data;
+	radix_sort_by_key(d->quads, d->key_help, op_count, sizeof(Draw_Quad), offsetof(Draw_Quad, z), MAX_Z_BITS);
+	s64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) sum += d->quads[i].z;
+	benchmark_sink += sum;
+}
+void benchmark_quad_radix_sort_indices(u64 op_count, void *data) {
+	Benchmark_Quad_Sort_Data *d = (Benchmark_Quad_Sort_Data*)data;
+	radix_sort_indices(d->quads, d->sorted_indices, d->key_help, op_count, sizeof(Draw_Quad), offsetof(Draw_Quad, z), MAX_Z_BITS);
+	s64 sum = 0;
+	for (u64 i = 0; i < op_count; i += 1) sum += d->quads[d->sorted_indices[i]].z;
+	benchmark_sink += sum;
+}
+
+// Draw frame submission. We draw into our own Draw_Frame and z-sort it the same way
+// gfx_render_draw_frame does, but never render it, so nothing here touches the graphics device.
+// The font is made in memory with fixed size glyphs, so we don't need a font file or to
+// upload an atlas either.
+
+#define BENCHMARK_FONT_HEIGHT 32
+#define BENCHMARK_FONT_CODEPOINT_COUNT 128
+#define BENCHMARK_DRAW_WIDTH 1280
+#define BENCHMARK_DRAW_HEIGHT 720
+
+typedef enum Benchmark_Draw_Scene {
+	BENCHMARK_DRAW_SCENE_SPRITES,
+	BENCHMARK_DRAW_SCENE_TEXT,
+	BENCHMARK_DRAW_SCENE_MIXED,
+} Benchmark_Draw_Scene;
+
+typedef struct Benchmark_Draw_Data {
+	Benchmark_Draw_Scene scene;
+	u64 item_count;
+	Vector2 *positions;
+	s32 *layers;
+	Draw_Frame *frame;
+	u32 *sorted_indices;
+	void *sort_help_buffer;
+	Gfx_Image *image;
+	Gfx_Font *font;
+} Benchmark_Draw_Data;
+
+Gfx_Font *_benchmark_make_font(Gfx_Image *atlas_image, Allocator allocator) {
+	// stbtt_handle stays zeroed, which means there's no kerning
+	Gfx_Font *font = alloc(allocator, sizeof(Gfx_Font));
+	font->allocator = allocator;
+
+	Gfx_Font_Variation *variation = &font->variations[BENCHMARK_FONT_HEIGHT];
+	variation->font = font;
+	variation->height = BENCHMARK_FONT_HEIGHT;
+	variation->scale = 1.0;
+	variation->codepoint_range_per_atlas = BENCHMARK_FONT_CODEPOINT_COUNT;
+	variation->metrics.latin_ascent = 22;
+	variation->metrics.latin_descent = -6;
+	variation->metrics.max_ascent = 24;
+	variation->metrics.max_descent = -8;
+	variation->metrics.new_line_offset = BENCHMARK_FONT_HEIGHT;
+	variation->atlases = make_hash_table(u32, Gfx_Font_Atlas, allocator);
+	variation->initted = true;
+
+	Gfx_Font_Atlas atlas = ZERO(Gfx_Font_Atlas);
+	atlas.image = atlas_image;
+	atlas.first_codepoint = 0;
+	atlas.glyphs = alloc(allocator, BENCHMARK_FONT_CODEPOINT_COUNT*sizeof(Gfx_Glyph));
+	for (u32 c = 0; c < BENCHMARK_FONT_CODEPOINT_COUNT; c += 1) {
+		Gfx_Glyph *glyph = &atlas.glyphs[c];
+		glyph->codepoint = c;
+		glyph->width   = c == ' ' ? 0 : 14;
+		glyph->height  = c == ' ' ? 0 : 22;
+		glyph->advance = 16;
+		float x = (float)(c % 16)*16.0/(float)FONT_ATLAS_WIDTH;
+		float y = (float)(c / 16)*32.0/(float)FONT_ATLAS_HEIGHT;
+		glyph->uv = v4(x, y, x + 14.0/(float)FONT_ATLAS_WIDTH, y + 22.0/(float)FONT_ATLAS_HEIGHT);
+	}
+
+	u32 atlas_index = 0;
+	hash_table_add(&variation->atlases, atlas_index, atlas);
+
+	return font;
+}
+void _benchmark_destroy_font(Gfx_Font *font) {
+	Gfx_Font_Variation *variation = &font->variations[BENCHMARK_FONT_HEIGHT];
+	Gfx_Font_Atlas *atlas = (Gfx_Font_Atlas*)hash_table_get_nth_value(&variation->atlases, 0);
+	dealloc(font->allocator, atlas->glyphs);
+	hash_table_destroy(&variation->atlases);
+	dealloc(font->allocator, font);
+}
+
+void _benchmark_draw_submit(Benchmark_Draw_Data *d) {
+	Draw_Frame *frame = d->frame;
+
+	draw_frame_reset(frame);
+	frame->projection = m4_make_orthographic_projection(0, BENCHMARK_DRAW_WIDTH, 0, BENCHMARK_DRAW_HEIGHT, -1, 10);
+	frame->enable_z_sorting = true;
+
+	Matrix4 world_to_clip = m4_mul(frame->projection, m4_inverse(frame->camera_xform));
+	string text = STR("Ooga booga 0123456789");
+
+	for (u64 i = 0; i < d->item_count; i += 1) {
+		Vector2 p = d->positions[i];
+
+		push_z_layer_in_frame(d->layers[i], frame);
+
+		Benchmark_Draw_Scene scene = d->scene;
+		if (scene == BENCHMARK_DRAW_SCENE_MIXED) {
+			// Every fifth item is text, the rest are different kinds of quads
+			switch (i % 5) {
+				case 0: {
+					Draw_Quad q = ZERO(Draw_Quad);
+					q.bottom_left  = p;
+					q.top_left     = v2(p.x, p.y+24);
+					q.top_right    = v2(p.x+24, p.y+24);
+					q.bottom_right = v2(p.x+24, p.y);
+					q.color = COLOR_WHITE;
+					q.type = QUAD_TYPE_REGULAR;
+					draw_quad_projected_in_frame(q, world_to_clip, frame);
+					break;
+				}
+				case 1: draw_rect_in_frame(p, v2(48, 16), COLOR_WHITE, frame);            break;
+				case 2: draw_image_in_frame(d->image, p, v2(32, 32), COLOR_WHITE, frame); break;
+				case 3: draw_circle_in_frame(p, v2(16, 16), COLOR_WHITE, frame);          break;
+				case 4: scene = BENCHMARK_DRAW_SCENE_TEXT;                                break;
+			}
+		}
+
+		if (scene == BENCHMARK_DRAW_SCENE_SPRITES) {
+			draw_image_in_frame(d->image, p, v2(32, 32), COLOR_WHITE, frame);
+		} else if (scene == BENCHMARK_DRAW_SCENE_TEXT) {
+			draw_text_in_frame(d->font, text, BENCHMARK_FONT_HEIGHT, p, v2(1, 1), COLOR_WHITE, frame);
+		}
+
+		pop_z_layer_in_frame(frame);
+	}
+}
+
+// op is one quad
+void benchmark_draw_frame(u64 op_count, void *data) {
+	Benchmark_Draw_Data *d = (Benchmark_Draw_Data*)data;
+
+	_benchmark_draw_submit(d);
+
+	Draw_Frame *frame = d->frame;
+	u64 number_of_quads = growing_array_get_valid_count(frame->quad_buffer);
+	assert(number_of_quads == op_count, "Draw benchmark submitted %llu quads, expected %llu", number_of_quads, op_count);
+	radix_sort_indices(frame->quad_buffer, d->sorted_indices, d->sort_help_buffer, number_of_quads, sizeof(Draw_Quad), offsetof(Draw_Quad, z), MAX_Z_BITS);
+
+	benchmark_sink += frame->quad_buffer[d->sorted_indices[number_of_quads-1]].z;
+}
+
+void _benchmark_run_draw_scene(Benchmark_Suite *suite, const char *name, Benchmark_Draw_Data *d) {
+	// Submit once to count the quads, the scene is the same every repetition
+	_benchmark_draw_submit(d);
+	u64 number_of_quads = growing_array_get_valid_count(d->frame->quad_buffer);
+
+	u64 sort_bytes = number_of_quads*sizeof(u32) + get_radix_sort_indices_help_buffer_size(number_of_quads);
+	d->sorted_indices = alloc(get_heap_allocator(), number_of_quads*sizeof(u32));
+	d->sort_help_buffer = alloc(get_heap_allocator(), get_radix_sort_indices_help_buffer_size(number_of_quads));
+
+	Benchmark_Result *r = benchmark_run(suite, name, number_of_quads, 0, benchmark_draw_frame, d);
+
+	u64 quad_buffer_bytes = growing_array_get_allocated_count(d->frame->quad_buffer)*sizeof(Draw_Quad);
+	u64 resident_bytes = quad_buffer_bytes + sort_bytes;
+	print("    %llu quads, %.2f million quads/s, %llu bytes/quad submitted, %.1f bytes/quad resident (incl. sort buffer)\n",
+		number_of_quads,
+		1000.0/r->median_ns,
+		(u64)sizeof(Draw_Quad),
+		(f64)resident_bytes/(f64)number_of_quads
+	);
+
+	dealloc(get_heap_allocator(), d->sorted_indices);
+	dealloc(get_heap_allocator(), d->sort_help_buffer);
+	d->sorted_indices = 0;
+	d->sort_help_buffer = 0;
+}
+
+u64 oogabooga_run_benchmarks() {
+	Allocator heap = get_heap_allocator();
+
+	Benchmark_Suite *suite = alloc(heap, sizeof(Benchmark_Suite));
+
+	print("Running benchmarks (median of %d repetitions)\n", BENCHMARK_REPETITIONS);
+
+	// Memory
+	benchmark_run(suite, "heap alloc+dealloc 64b", 4096, 0, benchmark_heap_alloc_dealloc, (void*)64);
+	benchmark_run(suite, "heap alloc+dealloc 64kb", 1024, 0, benchmark_heap_alloc_dealloc, (void*)(64*1024));
+	void **pointers = alloc(heap, sizeof(void*)*4096);
+	benchmark_run(suite, "heap mixed sizes", 4096, 0, benchmark_heap_mixed, pointers);
+	dealloc(heap, pointers);
+	benchmark_run(suite, "talloc 64b", 16384, 0, benchmark_talloc, 0);
+
+	// Hashing bytes
+	Benchmark_Hash_Data hash_bytes_data;
+	hash_bytes_data.data = alloc(heap, 64*1024 + 8);
+	for (u64 i = 0; i < 64*1024 + 8; i += 1) hash_bytes_data.data[i] = (u8)get_random();
+	hash_bytes_data.size = 16;
+	_benchmark_run_hash(suite, "hash_bytes 16b", benchmark_hash_bytes, &hash_bytes_data, 16384);
+	hash_bytes_data.size = 48;
+	_benchmark_run_hash(suite, "hash_bytes 48b", benchmark_hash_bytes, &hash_bytes_data, 16384);
+	_benchmark_run_hash(suite, "djb2_hash 48b", benchmark_djb2_hash, &hash_bytes_data, 16384);
+	hash_bytes_data.size = 1024;
+	_benchmark_run_hash(suite, "hash_bytes 1kb", benchmark_hash_bytes, &hash_bytes_data, 4096);
+	_benchmark_run_hash(suite, "djb2_hash 1kb", benchmark_djb2_hash, &hash_bytes_data, 1024);
+	hash_bytes_data.size = 64*1024;
+	_benchmark_run_hash(suite, "hash_bytes 64kb", benchmark_hash_bytes, &hash_bytes_data, 64);
+	dealloc(heap, hash_bytes_data.data);
+
+	// Hash table, adding and looking up at different sizes. The linear scan gets fewer
+	// lookups at larger sizes or it would take all day.
+	const u64 max_hash_table_count = 10*1000*1000;
+	Benchmark_Hash_Table_Data hash_data;
+	hash_data.table = make_hash_table(u64, u64, heap);
+	hash_data.keys = alloc(heap, sizeof(u64)*max_hash_table_count);
+	for (u64 i = 0; i < max_hash_table_count; i += 1) hash_data.keys[i] = get_random();
+
+	hash_data.entry_count = 1000;
+	benchmark_run(suite, "hash_table_add u64 1k", 1000, benchmark_hash_table_setup, benchmark_hash_table_add, &hash_data);
+	benchmark_run(suite, "hash_table_find u64 1k", 1000, benchmark_hash_table_fill, benchmark_hash_table_find, &hash_data);
+	benchmark_run(suite, "hash_table_find u64 1k (linear scan)", 1000, benchmark_hash_table_fill, benchmark_hash_table_find_linear, &hash_data);
+
+	hash_data.entry_count = 100*1000;
+	benchmark_run(suite, "hash_table_add u64 100k", 100*1000, benchmark_hash_table_setup, benchmark_hash_table_add, &hash_data);
+	benchmark_run(suite, "hash_table_find u64 100k", 100*1000, benchmark_hash_table_fill, benchmark_hash_table_find, &hash_data);
+	benchmark_run(suite, "hash_table_find u64 100k (linear scan)", 256, benchmark_hash_table_fill, benchmark_hash_table_find_linear, &hash_data);
+	hash_table_clear(&hash_data.table);
+	benchmark_run(suite, "hash_table_remove+add u64 100k (churn)", 100*1000, benchmark_hash_table_churn_setup, benchmark_hash_table_churn, &hash_data);
+	hash_table_clear(&hash_data.table);
+
+	hash_data.entry_count = max_hash_table_count;
+	benchmark_run(suite, "hash_table_add u64 10m", max_hash_table_count, benchmark_hash_table_setup, benchmark_hash_table_add, &hash_data);
+	benchmark_run(suite, "hash_table_find u64 10m", 1000*1000, benchmark_hash_table_fill, benchmark_hash_table_find, &hash_data);
+	benchmark_run(suite, "hash_table_find u64 10m (linear scan)", 8, benchmark_hash_table_fill, benchmark_hash_table_find_linear, &hash_data);
+
+	hash_table_destroy(&hash_data.table);
+	dealloc(heap, hash_data.keys);
+
+	// Typed maps, adds go into cleared tables and finds look up what the adds added
+	const u64 map_count = 100*1000;
+	Benchmark_Hash_Map_Data map_data;
+	map_data.keys = alloc(heap, map_count*sizeof(u64));
+	map_data.string_keys = alloc(heap, map_count*sizeof(string));
+	u8 *string_key_data = alloc(heap, map_count*24);
+	for (u64 i = 0; i < map_count; i += 1) {
+		map_data.keys[i] = get_random();
+		string key = { 8 + get_random() % 17, string_key_data + i*24 };
+		for (u64 j = 0; j < key.count; j += 1) key.data[j] = 'a' + get_random() % 26;
+		map_data.string_keys[i] = key;
+	}
+	map_data.pointer_table = make_hash_table(u64, void*, heap);
+	map_data.string_table  = make_hash_table(string, Benchmark_Map_Value, heap);
+	Benchmark_Pointer_Map_init(&map_data.pointer_map, heap);
+	Benchmark_String_Map_init(&map_data.string_map, heap);
+	benchmark_run(suite, "hash_table_add u64->pointer 100k", map_count, benchmark_hash_map_setup, benchmark_hash_table_add_pointer, &map_data);
+	benchmark_run(suite, "hash_table_find u64->pointer 100k", map_count, 0, benchmark_hash_table_find_pointer, &map_data);
+	benchmark_run(suite, "DEFINE_HASH_MAP add u64->pointer 100k", map_count, benchmark_hash_map_setup, benchmark_hash_map_add_pointer, &map_data);
+	benchmark_run(suite, "DEFINE_HASH_MAP find u64->pointer 100k", map_count, 0, benchmark_hash_map_find_pointer, &map_data);
+	benchmark_run(suite, "hash_table_add string->struct 100k", map_count, benchmark_hash_map_setup, benchmark_hash_table_add_string, &map_data);
+	benchmark_run(suite, "hash_table_find string->struct 100k", map_count, 0, benchmark_hash_table_find_string, &map_data);
+	benchmark_run(suite, "DEFINE_HASH_MAP add string->struct 100k", map_count, benchmark_hash_map_setup, benchmark_hash_map_add_string, &map_data);
+	benchmark_run(suite, "DEFINE_HASH_MAP find string->struct 100k", map_count, 0, benchmark_hash_map_find_string, &map_data);
+	hash_table_destroy(&map_data.pointer_table);
+	hash_table_destroy(&map_data.string_table);
+	Benchmark_Pointer_Map_destroy(&map_data.pointer_map);
+	Benchmark_String_Map_destroy(&map_data.string_map);
+	dealloc(heap, string_key_data);
+	dealloc(heap, map_data.string_keys);
+	dealloc(heap, map_data.keys);
+
+	// String interning, with names like the map keys above
+	const u64 intern_count = 100*1000;
+	Benchmark_Intern_Data intern_data;
+	intern_data.interner = make_string_interner(heap);
+	intern_data.keys     = alloc(heap, intern_count*sizeof(string));
+	intern_data.copies   = alloc(heap, intern_count*sizeof(string));
+	intern_data.ids      = alloc(heap, intern_count*sizeof(Interned_String));
+	intern_data.copy_ids = alloc(heap, intern_count*sizeof(Interned_String));
+	u8 *intern_key_data = alloc(heap, intern_count*24*2);
+	for (u64 i = 0; i < intern_count; i += 1) {
+		string key  = { 8 + get_random() % 17, intern_key_data + i*48 };
+		string copy = { key.count, key.data + 24 };
+		for (u64 j = 0; j < key.count; j += 1) key.data[j] = 'a' + get_random() % 26;
+		memcpy(copy.data, key.data, key.count);
+		intern_data.keys[i] = key;
+		intern_data.copies[i] = copy;
+	}
+	benchmark_run(suite, "string_intern new 100k", intern_count, benchmark_string_intern_setup, benchmark_string_intern_new, &intern_data);
+	for (u64 i = 0; i < intern_count; i += 1) intern_data.copy_ids[i] = string_intern(&intern_data.interner, intern_data.copies[i]);
+	benchmark_run(suite, "string_intern existing 100k", intern_count, 0, benchmark_string_intern_existing, &intern_data);
+	benchmark_run(suite, "strings_match equal 8-24 chars", intern_count, 0, benchmark_strings_match_equal, &intern_data);
+	benchmark_run(suite, "Interned_String compare equal", intern_count, 0, benchmark_interned_strings_match_equal, &intern_data);
+	benchmark_run(suite, "string_get_hash 8-24 chars", intern_count, 0, benchmark_string_get_hash, &intern_data);
+	benchmark_run(suite, "string_interner_get_hash", intern_count, 0, benchmark_string_interner_get_hash, &intern_data);
+
+	intern_data.interner.thread_safe = true;
+	benchmark_run(suite, "string_intern new 100k (thread safe)", intern_count, benchmark_string_intern_setup, benchmark_string_intern_new, &intern_data);
+	benchmark_run(suite, "string_intern existing 100k (thread safe)", intern_count, 0, benchmark_string_intern_existing, &intern_data);
+	string_interner_destroy(&intern_data.interner);
+	dealloc(heap, intern_key_data);
+	dealloc(heap, intern_data.keys);
+	dealloc(heap, intern_data.copies);
+	dealloc(heap, intern_data.ids);
+	dealloc(heap, intern_data.copy_ids);
+
+	// Concurrent hash table, 95% finds and 5% sets from 1 to 16 threads.
+	// Thread start and join is included, which is why there are quite a lot of ops.
+	const u64 concurrent_key_count = 64*1024;
+	const u64 concurrent_op_count = 256*1024;
+	const char *concurrent_names[] = {
+		"concurrent_hash_table 95% find 1 thread",
+		"concurrent_hash_table 95% find 2 threads",
+		"concurrent_hash_table 95% find 4 threads",
+		"concurrent_hash_table 95% find 8 threads",
+		"concurrent_hash_table 95% find 16 threads",
+	};
+	const char *mutex_names[] = {
+		"Hash_Table+Mutex 95% find 1 thread",
+		"Hash_Table+Mutex 95% find 2 threads",
+		"Hash_Table+Mutex 95% find 4 threads",
+		"Hash_Table+Mutex 95% find 8 threads",
+		"Hash_Table+Mutex 95% find 16 threads",
+	};
+	Benchmark_Concurrent_Data concurrent_data = ZERO(Benchmark_Concurrent_Data);
+	concurrent_data.table = make_concurrent_hash_table(u64, u64, heap);
+	concurrent_data.locked_table = make_hash_table(u64, u64, heap);
+	mutex_init(&concurrent_data.mutex);
+	concurrent_data.key_count = concurrent_key_count;
+	concurrent_data.keys = alloc(heap, concurrent_key_count*sizeof(u64));
+	for (u64 i = 0; i < concurrent_key_count; i += 1) {
+		concurrent_data.keys[i] = get_random();
+		concurrent_hash_table_set(&concurrent_data.table, concurrent_data.keys[i], i);
+		hash_table_set(&concurrent_data.locked_table, concurrent_data.keys[i], i);
+	}
+	for (u64 i = 0; i < 5; i += 1) {
+		concurrent_data.thread_count = 1ull << i;
+
+		concurrent_data.use_mutex = false;
+		Benchmark_Result *r = benchmark_run(suite, concurrent_names[i], concurrent_op_count, 0, benchmark_concurrent_hash_table, &concurrent_data);
+		print("    %.2f million ops/s\n", 1000.0/r->median_ns);
+
+		concurrent_data.use_mutex = true;
+		r = benchmark_run(suite, mutex_names[i], concurrent_op_count, 0, benchmark_concurrent_hash_table, &concurrent_data);
+		print("    %.2f million ops/s\n", 1000.0/r->median_ns);
+	}
+	concurrent_hash_table_destroy(&concurrent_data.table);
+	hash_table_destroy(&concurrent_data.locked_table);
+	mutex_destroy(&concurrent_data.mutex);
+	dealloc(heap, concurrent_data.keys);
+
+	// Growing array
+	benchmark_run(suite, "growing_array_add u64", 16384, 0, benchmark_growing_array_add, 0);
+
+	benchmark_run(suite, "growing_array_add u64 10m", 10*1000*1000, 0, benchmark_growing_array_push_untyped, 0);
+	benchmark_run(suite, "DEFINE_GROWING_ARRAY push u64 10m", 10*1000*1000, 0, benchmark_growing_array_push_typed, 0);
+	benchmark_run(suite, "growing_array_add 64b struct 4m", 4*1000*1000, 0, benchmark_growing_array_push_entity_untyped, 0);
+	benchmark_run(suite, "DEFINE_GROWING_ARRAY push 64b struct 4m", 4*1000*1000, 0, benchmark_growing_array_push_entity_typed, 0);
+
+	// 100 million appends with each growth policy, to see what the reallocations cost
+	const u64 append_count = 100*1000*1000;
+	Benchmark_Growing_Array_Data append_data = { 2.0f, 0, false };
+	benchmark_run(suite, "growing_array_add u32 100m (factor 2)", append_count, 0, benchmark_growing_array_append, &append_data);
+	append_data.growth_factor = 1.5f;
+	benchmark_run(suite, "growing_array_add u32 100m (factor 1.5)", append_count, 0, benchmark_growing_array_append, &append_data);
+	append_data.growth_chunk_count = 1024*1024;
+	benchmark_run(suite, "growing_array_add u32 100m (chunk 1m)", append_count, 0, benchmark_growing_array_append, &append_data);
+	append_data.reserve_up_front = true;
+	benchmark_run(suite, "growing_array_add u32 100m (reserved)", append_count, 0, benchmark_growing_array_append, &append_data);
+
+	u64 *array;
+	growing_array_init((void**)&array, sizeof(u64), heap);
+	benchmark_run(suite, "growing_array_unordered_remove u64", 4096, benchmark_growing_array_fill, benchmark_growing_array_unordered_remove, &array);
+	growing_array_deinit((void**)&array);
+
+	// Filtering. Ordered remove one at a time is quadratic, so it only gets 10k entities.
+	const u64 filter_count = 1000*1000;
+	Benchmark_Filter_Data filter_data;
+	filter_data.source = alloc(heap, filter_count*sizeof(Benchmark_Entity));
+	filter_data.mask = alloc(heap, ((filter_count+63)/64)*sizeof(u64));
+	for (u64 i = 0; i < filter_count; i += 1) {
+		filter_data.source[i].health = get_random() % 4 == 0 ? 0 : 100;
+		filter_data.source[i].flags = (u32)i;
+	}
+	growing_array_init_reserve((void**)&filter_data.entities, sizeof(Benchmark_Entity), filter_count, heap);
+	benchmark_run(suite, "filter 1m entities (unordered_remove loop)", filter_count, benchmark_filter_setup, benchmark_filter_unordered_remove, &filter_data);
+	benchmark_run(suite, "filter 1m entities (remove_if)", filter_count, benchmark_filter_setup, benchmark_filter_remove_if, &filter_data);
+	benchmark_run(suite, "filter 1m entities (remove_by_mask)", filter_count, benchmark_filter_setup, benchmark_filter_remove_by_mask, &filter_data);
+	benchmark_run(suite, "filter 10k entities (ordered_remove loop)", 10*1000, benchmark_filter_setup, benchmark_filter_ordered_remove, &filter_data);
+	benchmark_run(suite, "filter 10k entities (remove_if)", 10*1000, benchmark_filter_setup, benchmark_filter_remove_if, &filter_data);
+	growing_array_deinit((void**)&filter_data.entities);
+	dealloc(heap, filter_data.source);
+	dealloc(heap, filter_data.mask);
+
+	// Slot map. A quarter of the entities are removed before iterating, which leaves holes in
+	// the sparse array. Churn removes a random entity and adds a new one. Searching for a free
+	// item is linear, so churn on the sparse array only gets 10k entities.
+	const u64 slot_map_count = 1000*1000;
+	Benchmark_Slot_Map_Data slot_map_data = ZERO(Benchmark_Slot_Map_Data);
+	Benchmark_Entity_Map_init(&slot_map_data.map, heap);
+	Benchmark_Entity_Map_reserve(&slot_map_data.map, slot_map_count);
+	growing_array_init_reserve((void**)&slot_map_data.sparse, sizeof(Benchmark_Sparse_Entity), slot_map_count, heap);
+	slot_map_data.handles = alloc(heap, slot_map_count*sizeof(Slot_Map_Handle));
+	slot_map_data.sparse_handles = alloc(heap, slot_map_count*sizeof(Slot_Map_Handle));
+	slot_map_data.random_indices = alloc(heap, slot_map_count*sizeof(u32));
+
+	benchmark_slot_map_fill(&slot_map_data, slot_map_count, slot_map_count/4);
+	for (u64 i = 0; i < slot_map_count; i += 1) slot_map_data.random_indices[i] = (u32)(get_random() % slot_map_data.live_count);
+	benchmark_run(suite, "slot map iterate 1m entities (750k live)", slot_map_count, 0, benchmark_slot_map_iterate, &slot_map_data);
+	benchmark_run(suite, "sparse array iterate 1m entities (750k live)", slot_map_count, 0, benchmark_sparse_array_iterate, &slot_map_data);
+	benchmark_run(suite, "slot map get random handle 750k", slot_map_count, 0, benchmark_slot_map_get, &slot_map_data);
+	benchmark_run(suite, "slot map remove+add random 750k (churn)", slot_map_count, 0, benchmark_slot_map_churn, &slot_map_data);
+
+	const u64 small_slot_map_count = 10*1000;
+	benchmark_slot_map_fill(&slot_map_data, small_slot_map_count, 0);
+	for (u64 i = 0; i < slot_map_count; i += 1) slot_map_data.random_indices[i] = (u32)(get_random() % small_slot_map_count);
+	benchmark_run(suite, "slot map remove+add random 10k (churn)", small_slot_map_count, 0, benchmark_slot_map_churn, &slot_map_data);
+	benchmark_run(suite, "sparse array remove+add random 10k (churn)", small_slot_map_count, 0, benchmark_sparse_array_churn, &slot_map_data);
+
+	Benchmark_Entity_Map_destroy(&slot_map_data.map);
+	growing_array_deinit((void**)&slot_map_data.sparse);
+	dealloc(heap, slot_map_data.handles);
+	dealloc(heap, slot_map_data.sparse_handles);
+	dealloc(heap, slot_map_data.random_indices);
+
+	// Sorting
+	const u64 sort_count = 1024*64;
+	Benchmark_Sort_Data sort_data;
+	sort_data.source = alloc(heap, sizeof(Benchmark_Sort_Item)*sort_count);
+	sort_data.items  = alloc(heap, sizeof(Benchmark_Sort_Item)*sort_count);
+	sort_data.help   = alloc(heap, sizeof(Benchmark_Sort_Item)*sort_count);
+	for (u64 i = 0; i < sort_count; i += 1) {
+		sort_data.source[i].key = get_random() & 0xFFFFFFFF;
+		sort_data.source[i].payload = i;
+	}
+	benchmark_run(suite, "radix_sort 64k items 32 bits", sort_count, benchmark_sort_setup, benchmark_radix_sort, &sort_data);
+	benchmark_run(suite, "merge_sort 64k items", sort_count, benchmark_sort_setup, benchmark_merge_sort, &sort_data);
+	benchmark_run(suite, "merge_sort_ping_pong 64k items", sort_count, benchmark_sort_setup, benchmark_merge_sort_ping_pong, &sort_data);
+	benchmark_run(suite, "quick_sort 64k items", sort_count, benchmark_sort_setup, benchmark_quick_sort, &sort_data);
+	benchmark_run(suite, "DEFINE_QUICK_SORT 64k items", sort_count, benchmark_sort_setup, benchmark_quick_sort_typed, &sort_data);
+	// Already sorted, except for every 100th item
+	benchmark_quick_sort_items(sort_data.source, sort_count);
+	for (u64 i = 0; i < sort_count; i += 100) sort_data.source[i].key = get_random() & 0xFFFFFFFF;
+	benchmark_run(suite, "merge_sort 64k nearly sorted", sort_count, benchmark_sort_setup, benchmark_merge_sort, &sort_data);
+	benchmark_run(suite, "merge_sort_ping_pong 64k nearly sorted", sort_count, benchmark_sort_setup, benchmark_merge_sort_ping_pong, &sort_data);
+	benchmark_run(suite, "quick_sort 64k nearly sorted", sort_count, benchmark_sort_setup, benchmark_quick_sort, &sort_data);
+	benchmark_run(suite, "DEFINE_QUICK_SORT 64k nearly sorted", sort_count, benchmark_sort_setup, benchmark_quick_sort_typed, &sort_data);
+	dealloc(heap, sort_data.source);
+	dealloc(heap, sort_data.items);
+	dealloc(heap, sort_data.help);
+
+	Benchmark_Float_Sort_Data float_sort_data;
+	float_sort_data.source = alloc(heap, sizeof(Benchmark_Float_Sort_Item)*sort_count);
+	float_sort_data.items  = alloc(heap, sizeof(Benchmark_Float_Sort_Item)*sort_count);
+	float_sort_data.help   = alloc(heap, get_radix_sort_by_key_help_buffer_size(sort_count, sizeof(Benchmark_Float_Sort_Item)));
+	for (u64 i = 0; i < sort_count; i += 1) {
+		float_sort_data.source[i].key = get_random_float32_in_range(-1000.0f, 1000.0f);
+		float_sort_data.source[i].payload = (u32)i;
+	}
+	benchmark_run(suite, "radix_sort_by_key_f32 64k items", sort_count, benchmark_float_sort_setup, benchmark_radix_sort_by_key_f32, &float_sort_data);
+	benchmark_run(suite, "DEFINE_QUICK_SORT f32 64k items", sort_count, benchmark_float_sort_setup, benchmark_quick_sort_f32_typed, &float_sort_data);
+	benchmark_run(suite, "merge_sort f32 64k items", sort_count, benchmark_float_sort_setup, benchmark_merge_sort_f32, &float_sort_data);
+	dealloc(heap, float_sort_data.source);
+	dealloc(heap, float_sort_data.items);
+	dealloc(heap, float_sort_data.help);
+
+	// Parallel radix sort, 1 thread and then doubling up to one per logical processor. The u32
+	// sorts only use the first half of each buffer.
+	const u64 parallel_sort_count = 1000*1000;
+	Benchmark_Parallel_Sort_Data parallel_sort_data;
+	parallel_sort_data.source_keys   = alloc(heap, parallel_sort_count*sizeof(u64));
+	parallel_sort_data.keys          = alloc(heap, parallel_sort_count*sizeof(u64));
+	parallel_sort_data.payloads      = alloc(heap, parallel_sort_count*sizeof(u64));
+	parallel_sort_data.help_keys     = alloc(heap, parallel_sort_count*sizeof(u64));
+	parallel_sort_data.help_payloads = alloc(heap, parallel_sort_count*sizeof(u64));
+	for (u64 i = 0; i < parallel_sort_count; i += 1) parallel_sort_data.source_keys[i] = get_random();
+	u64 max_sort_threads = min(os_get_number_of_logical_processors(), RADIX_SORT_PARALLEL_MAX_THREADS);
+	for (u64 thread_count = 1; ; thread_count = min(thread_count*2, max_sort_threads)) {
+		parallel_sort_data.thread_count = thread_count;
+		// The suite keeps the names until it's written out, so these can't be in temporary storage
+		const char *u32_name = convert_to_null_terminated_string(tprint("radix_sort_u32_parallel 1m, %llu threads", thread_count), heap);
+		const char *u64_name = convert_to_null_terminated_string(tprint("radix_sort_u64_parallel 1m, %llu threads", thread_count), heap);
+		benchmark_run(suite, u32_name, parallel_sort_count, benchmark_parallel_sort_setup, benchmark_radix_sort_u32_parallel, &parallel_sort_data);
+		benchmark_run(suite, u64_name, parallel_sort_count, benchmark_parallel_sort_setup, benchmark_radix_sort_u64_parallel, &parallel_sort_data);
+		if (thread_count == max_sort_threads) break;
+	}
+	dealloc(heap, parallel_sort_data.source_keys);
+	dealloc(heap, parallel_sort_data.keys);
+	dealloc(heap, parallel_sort_data.payloads);
+	dealloc(heap, parallel_sort_data.help_keys);
+	dealloc(heap, parallel_sort_data.help_payloads);
+
+	// Strings
+	benchmark_run(suite, "tprint 4 args", 4096, 0, benchmark_tprint, 0);
+	String_Builder sb;
+	string_builder_init_reserve(&sb, 16384*12, heap);
+	benchmark_run(suite, "string_builder_print %d", 16384, 0, benchmark_string_builder_print, &sb);
+	string_builder_deinit(&sb);
+	string utf8_text = STR("Ooga booga, \xc3\xa5\xc3\xa4\xc3\xb6 \xe2\x82\xac \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e \xf0\x9f\x98\x80 ascii ascii ascii ascii ascii.");
+	benchmark_run(suite, "utf8 decode (per string)", 4096, 0, benchmark_utf8_decode, &utf8_text);
+
+	// 8mb of lowercase words, spaces and newlines
+	const u64 search_count = 8*1024*1024;
+	Benchmark_Search_Data search_data;
+	search_data.text = alloc_string(heap, search_count);
+	for (u64 i = 0; i < search_count; i += 1) {
+		u64 r = get_random() % 32;
+		search_data.text.data[i] = r < 26 ? 'a' + (u8)r : (r < 31 ? ' ' : '\n');
+	}
+	search_data.needle = STR("ooga booga");
+	benchmark_run(suite, "naive find 8mb (per byte)", search_count, 0, benchmark_find_naive, &search_data);
+	benchmark_run(suite, "string_find_from_left 8mb (per byte)", search_count, 0, benchmark_find_from_left, &search_data);
+	benchmark_run(suite, "string_find_from_right 8mb (per byte)", search_count, 0, benchmark_find_from_right, &search_data);
+	search_data.needle = STR("the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog");
+	benchmark_run(suite, "naive find 8mb, 87 byte sub", search_count, 0, benchmark_find_naive, &search_data);
+	benchmark_run(suite, "string_find_from_left 8mb, 87 byte sub", search_count, 0, benchmark_find_from_left, &search_data);
+	search_data.c = '#';
+	benchmark_run(suite, "find char loop 8mb (per byte)", search_count, 0, benchmark_find_char_loop, &search_data);
+	benchmark_run(suite, "string_find_char 8mb (per byte)", search_count, 0, benchmark_find_char, &search_data);
+	search_data.c = '\n';
+	benchmark_run(suite, "count char loop 8mb (per byte)", search_count, 0, benchmark_count_char_loop, &search_data);
+	benchmark_run(suite, "string_count_char 8mb (per byte)", search_count, 0, benchmark_count_char, &search_data);
+	search_data.needle = STR("#;=\t");
+	benchmark_run(suite, "string_find_any_of 4 bytes 8mb (per byte)", search_count, 0, benchmark_find_any_of, &search_data);
+	search_data.needle = STR("#;=\t{}[]()");
+	benchmark_run(suite, "string_find_any_of 10 bytes 8mb (per byte)", search_count, 0, benchmark_find_any_of, &search_data);
+	// All the same byte, so the first and last bytes of the sub match everywhere. This is the
+	// worst case, the naive find compares every position up to the b, and string_find_* switch
+	// to two-way after a few of those.
+	memset(search_data.text.data, 'a', search_count);
+	search_data.needle = STR("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabaaaaaaaaaaaaaaaaaaaa");
+	benchmark_run(suite, "naive find 8mb, repetitive", search_count, 0, benchmark_find_naive, &search_data);
+	benchmark_run(suite, "string_find_from_left 8mb, repetitive", search_count, 0, benchmark_find_from_left, &search_data);
+	benchmark_run(suite, "string_find_from_right 8mb, repetitive", search_count, 0, benchmark_find_from_right, &search_data);
+	// A 4kb sub, the naive find would compare ~2kb at each of the 8 million positions
+	string long_needle = alloc_string(heap, 4096);
+	memset(long_needle.data, 'a', long_needle.count);
+	long_needle.data[long_needle.count/2] = 'b';
+	search_data.needle = long_needle;
+	benchmark_run(suite, "string_find_from_left 8mb, repetitive 4kb sub", search_count, 0, benchmark_find_from_left, &search_data);
+	benchmark_run(suite, "string_find_from_right 8mb, repetitive 4kb sub", search_count, 0, benchmark_find_from_right, &search_data);
+	dealloc_string(heap, long_needle);
+	dealloc_string(heap, search_data.text);
+
+	// Math
+	benchmark_run(suite, "m4_mul", 16384, 0, benchmark_m4_mul, 0);
+	benchmark_run(suite, "m4_inverse", 16384, 0, benchmark_m4_inverse, 0);
+
+#ifndef OOGABOOGA_HEADLESS
+	// Audio
+	const u64 frame_count = 4096;
+	Benchmark_Audio_Data audio_data;
+	audio_data.dst = alloc(heap, frame_count*4*sizeof(f32)); // Room for resampling up
+	audio_data.src = alloc(heap, frame_count*2*sizeof(f32));
+	for (u64 i = 0; i < frame_count*2; i += 1) ((f32*)audio_data.src)[i] = get_random_float32_in_range(-0.5, 0.5);
+	audio_data.dst_format = (Audio_Format){ AUDIO_BITS_32, 2, 48000 };
+	audio_data.src_format = (Audio_Format){ AUDIO_BITS_32, 2, 48000 };
+	benchmark_run(suite, "mix_frames f32 stereo (per frame)", frame_count, 0, benchmark_mix_frames, &audio_data);
+
+	for (u64 i = 0; i < frame_count*2; i += 1) ((s16*)audio_data.src)[i] = (s16)(get_random() & 0xFFFF);
+	audio_data.src_format = (Audio_Format){ AUDIO_BITS_16, 2, 48000 };
+	benchmark_run(suite, "convert_frames s16->f32 stereo (per frame)", frame_count, 0, benchmark_convert_frames, &audio_data);
+
+	audio_data.src_format = (Audio_Format){ AUDIO_BITS_16, 1, 44100 };
+	benchmark_run(suite, "convert_frames s16 44.1k mono->f32 48k stereo", frame_count, 0, benchmark_convert_frames, &audio_data);
+	dealloc(heap, audio_data.dst);
+	dealloc(heap, audio_data.src);
+#endif
+
+	// Z-sorting quads
+	const u64 max_quad_sort_count = 1000*1000;
+	Benchmark_Quad_Sort_Data quad_sort_data = ZERO(Benchmark_Quad_Sort_Data);
+	quad_sort_data.quads = alloc(heap, max_quad_sort_count*sizeof(Draw_Quad));
+	quad_sort_data.help  = alloc(heap, max_quad_sort_count*sizeof(Draw_Quad));
+	quad_sort_data.key_help = alloc(heap, get_radix_sort_by_key_help_buffer_size(max_quad_sort_count, sizeof(Draw_Quad)));
+	quad_sort_data.sorted_indices = alloc(heap, max_quad_sort_count*sizeof(u32));
+	memset(quad_sort_data.quads, 0, max_quad_sort_count*sizeof(Draw_Quad));
+	benchmark_run(suite, "radix_sort 100k quads (per quad)", 100*1000, benchmark_quad_sort_setup, benchmark_quad_radix_sort, &quad_sort_data);
+	benchmark_run(suite, "radix_sort_by_key 100k quads (per quad)", 100*1000, benchmark_quad_sort_setup, benchmark_quad_radix_sort_by_key, &quad_sort_data);
+	benchmark_run(suite, "radix_sort_indices 100k quads (per quad)", 100*1000, benchmark_quad_sort_setup, benchmark_quad_radix_sort_indices, &quad_sort_data);
+	benchmark_run(suite, "radix_sort 1m quads (per quad)", max_quad_sort_count, benchmark_quad_sort_setup, benchmark_quad_radix_sort, &quad_sort_data);
+	benchmark_run(suite, "radix_sort_by_key 1m quads (per quad)", max_quad_sort_count, benchmark_quad_sort_setup, benchmark_quad_radix_sort_by_key, &quad_sort_data);
+	benchmark_run(suite, "radix_sort_indices 1m quads (per quad)", max_quad_sort_count, benchmark_quad_sort_setup, benchmark_quad_radix_sort_indices, &quad_sort_data);
+	quad_sort_data.layer_count = 16;
+	benchmark_run(suite, "radix_sort 1m quads, 16 z (per quad)", max_quad_sort_count, benchmark_quad_sort_setup, benchmark_quad_radix_sort, &quad_sort_data);
+	benchmark_run(suite, "radix_sort_indices 1m quads, 16 z (per quad)", max_quad_sort_count, benchmark_quad_sort_setup, benchmark_quad_radix_sort_indices, &quad_sort_data);
+	dealloc(heap, quad_sort_data.quads);
+	dealloc(heap, quad_sort_data.help);
+	dealloc(heap, quad_sort_data.key_help);
+	dealloc(heap, quad_sort_data.sorted_indices);
+
+	// Drawing
+	// draw_quad_projected_in_frame snaps to window pixels. There's no window in headless, so
+	// pretend it's this size in both builds to draw the same thing.
+	const Os_Window window_before = window;
+	window.width  = BENCHMARK_DRAW_WIDTH;
+	window.height = BENCHMARK_DRAW_HEIGHT;
+	const u64 max_draw_items = 16384;
+	Gfx_Image draw_image = ZERO(Gfx_Image);
+	draw_image.width = draw_image.height = 32;
+	draw_image.channels = 4;
+	Benchmark_Draw_Data draw_data = ZERO(Benchmark_Draw_Data);
+	draw_data.positions = alloc(heap, max_draw_items*sizeof(Vector2));
+	draw_data.layers    = alloc(heap, max_draw_items*sizeof(s32));
+	draw_data.frame     = alloc(heap, sizeof(Draw_Frame));
+	draw_data.image     = &draw_image;
+	draw_data.font      = _benchmark_make_font(&draw_image, heap);
+	for (u64 i = 0; i < max_draw_items; i += 1) {
+		// Leave room for the text so nothing is culled
+		draw_data.positions[i] = v2(get_random_float32_in_range(0, BENCHMARK_DRAW_WIDTH-400), get_random_float32_in_range(0, BENCHMARK_DRAW_HEIGHT-40));
+		draw_data.layers[i] = (s32)(get_random() % 16);
+	}
+	draw_frame_init_reserve(draw_data.frame, max_draw_items);
+
+	draw_data.scene = BENCHMARK_DRAW_SCENE_SPRITES;
+	draw_data.item_count = max_draw_items;
+	_benchmark_run_draw_scene(suite, "draw frame sprites 16k (per quad)", &draw_data);
+
+	draw_data.scene = BENCHMARK_DRAW_SCENE_TEXT;
+	draw_data.item_count = 1024;
+	_benchmark_run_draw_scene(suite, "draw frame text 1k strings (per quad)", &draw_data);
+
+	draw_data.scene = BENCHMARK_DRAW_SCENE_MIXED;
+	draw_data.item_count = 8192;
+	_benchmark_run_draw_scene(suite, "draw frame mixed 8k (per quad)", &draw_data);
+
+	growing_array_deinit((void**)&draw_data.frame->quad_buffer);
+	_benchmark_destroy_font(draw_data.font);
+	dealloc(heap, draw_data.frame);
+	dealloc(heap, draw_data.positions);
+	dealloc(heap, draw_data.layers);
+	window = window_before;
+
+	string json = benchmark_suite_to_json(suite, heap);
+	os_write_entire_file(BENCHMARK_RESULTS_PATH, json);
+	print("Wrote %cs\n", BENCHMARK_RESULTS_PATH);
+
+	u64 regression_count = 0;
+#if BENCHMARK_SAVE_BASELINE
+	os_write_entire_file(BENCHMARK_BASELINE_PATH, json);
+	print("Saved baseline to %cs\n", BENCHMARK_BASELINE_PATH);
+#else
+	string baseline;
+	if (os_is_file(BENCHMARK_BASELINE_PATH) && os_read_entire_file(BENCHMARK_BASELINE_PATH, &baseline, heap)) {
+		regression_count = benchmark_suite_compare_to_baseline(suite, baseline);
+		if (regression_count > 0) {
+			log_warning("%llu benchmarks regressed more than %.0f%% against %cs", regression_count, BENCHMARK_REGRESSION_THRESHOLD*100.0, BENCHMARK_BASELINE_PATH);
+		}
+		dealloc_string(heap, baseline);
+	}
+#endif
+
+	dealloc_string(heap, json);
+	dealloc(heap, suite);
+
+	return regression_count;
+}
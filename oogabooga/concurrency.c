@@ -1,7 +1,9 @@
 
 typedef struct Spinlock Spinlock;
+typedef struct RW_Spinlock RW_Spinlock;
 typedef struct Mutex Mutex;
 typedef struct Binary_Semaphore Binary_Semaphore;
+typedef struct Lock_Stats Lock_Stats;
 
 // These are probably your best friend for sync-free multi-processing.
 inline bool compare_and_swap_8(volatile uint8_t *a, uint8_t b, uint8_t old);
@@ -16,11 +18,20 @@ inline bool compare_and_swap_bool(volatile bool *a, bool b, bool old);
 // Beneficial if contention is low or sync speed is important
 typedef struct Spinlock {
 	volatile bool locked;
+#if ENABLE_LOCK_STATS
+	Lock_Stats *stats; // Only set by spinlock_init_named
+	u64 acquired_cycles;
+#endif
 } Spinlock;
 
 void ogb_instance
 spinlock_init(Spinlock *l);
 
+// Records contention stats under name with ENABLE_LOCK_STATS, see Lock_Stats below.
+// Same as spinlock_init otherwise.
+void ogb_instance
+spinlock_init_named(Spinlock *l, const char *name);
+
 void ogb_instance
 spinlock_acquire_or_wait(Spinlock* l);
 
@@ -32,6 +43,54 @@ void ogb_instance
 spinlock_release(Spinlock* l);
 
 
+///
+// Reader-writer spinlock
+// Any number of readers or one writer. Readers only touch the lock word, so readers don't
+// wait on each other. A waiting writer stops new readers from acquiring so it can't starve.
+// Yields the thread after spinning for a while, in case we wait on a thread which isn't
+// running.
+#define RW_SPINLOCK_WRITER (1ull << 63)
+#define RW_SPINLOCK_SPINS_BEFORE_YIELD 256
+typedef struct RW_Spinlock {
+	volatile u64 state; // RW_SPINLOCK_WRITER | number of readers
+} RW_Spinlock;
+
+void ogb_instance
+rw_spinlock_init(RW_Spinlock *l);
+
+void ogb_instance
+rw_spinlock_acquire_read(RW_Spinlock *l);
+
+void ogb_instance
+rw_spinlock_release_read(RW_Spinlock *l);
+
+void ogb_instance
+rw_spinlock_acquire_write(RW_Spinlock *l);
+
+void ogb_instance
+rw_spinlock_release_write(RW_Spinlock *l);
+
+
+///
+// Spin barrier
+// Makes thread_count threads wait for each other. Each thread calls spin_barrier_wait and
+// they all return once the last one has arrived. It can be waited on again right away, so
+// threads working in phases can use one barrier between every phase.
+// Spins, then yields like RW_Spinlock, so it's for short waits between threads which are
+// all running.
+typedef struct Spin_Barrier {
+	u64 thread_count;
+	volatile u64 arrived_count;
+	volatile u64 generation; // Bumped by the last thread to arrive, which releases the rest
+} Spin_Barrier;
+
+void ogb_instance
+spin_barrier_init(Spin_Barrier *b, u64 thread_count);
+
+void ogb_instance
+spin_barrier_wait(Spin_Barrier *b);
+
+
 ///
 // High-level mutex primitive (short spinlock then OS mutex lock)
 // Just spins for a few (configurable) microseconds with a spinlock,
@@ -43,11 +102,18 @@ typedef struct Mutex {
 	Mutex_Handle os_handle;
 	volatile bool spinlock_acquired;
 	volatile u64 acquiring_thread;
+#if ENABLE_LOCK_STATS
+	Lock_Stats *stats; // Only set by mutex_init_named
+	u64 acquired_cycles;
+#endif
 } Mutex;
 
 void ogb_instance
 mutex_init(Mutex *m);
 
+void ogb_instance
+mutex_init_named(Mutex *m, const char *name);
+
 void ogb_instance
 mutex_destroy(Mutex *m);
 
@@ -58,12 +124,187 @@ void ogb_instance
 mutex_release(Mutex *m);
 
 
+///
+// Lock contention stats
+// With ENABLE_LOCK_STATS, locks initialized with spinlock_init_named/mutex_init_named count
+// acquisitions, contended acquisitions, time spent waiting and time held. Locks with the same
+// name share their stats, so all locks of one kind (i.e. "audio player sample_lock") show up
+// as one.
+// Without ENABLE_LOCK_STATS a Spinlock is just the lock byte, names are ignored and there are
+// no stats to report.
+// With ENABLE_PROFILING, contended waits longer than LOCK_STATS_TRACE_WAIT_MICROSECONDS
+// also show up in the profiler trace.
+#ifndef MAX_LOCK_STATS
+	#define MAX_LOCK_STATS 128
+#endif
+#ifndef LOCK_STATS_TRACE_WAIT_MICROSECONDS
+	#define LOCK_STATS_TRACE_WAIT_MICROSECONDS 20
+#endif
+typedef struct Lock_Stats {
+	const char *name;
+	volatile u64 acquisition_count;
+	volatile u64 contended_count; // Lock was taken by someone else when we tried
+	volatile u64 total_wait_cycles; // Only contended acquisitions wait
+	volatile u64 max_wait_cycles;
+	volatile u64 total_hold_cycles;
+	volatile u64 max_hold_cycles;
+} Lock_Stats;
+
+// Returns the stats registered under name, registering them if needed.
+// Returns 0 if MAX_LOCK_STATS is reached.
+Lock_Stats ogb_instance *
+lock_stats_get(const char *name);
+
+// Stats of all named locks, returns the count
+u64 ogb_instance
+lock_stats_get_all(Lock_Stats **out, u64 max_count);
+
+void ogb_instance
+lock_stats_reset();
+
+// Logs a line per named lock which was acquired at least once
+void ogb_instance
+lock_stats_log_report();
+
+// #Global
+ogb_instance Lock_Stats _lock_stats[MAX_LOCK_STATS];
+ogb_instance u64 _lock_stats_count;
+ogb_instance Spinlock _lock_stats_lock;
+
+// Implemented in profiling.c
+void profiler_init();
+inline f64 profiler_cycles_to_seconds(s64 cycles);
+// Records a trace event if the wait is longer than LOCK_STATS_TRACE_WAIT_MICROSECONDS
+void _profiler_record_lock_wait(const char *name, u64 start_cycles, u64 end_cycles);
+
+
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 
+Lock_Stats _lock_stats[MAX_LOCK_STATS];
+u64 _lock_stats_count = 0;
+Spinlock _lock_stats_lock = {0};
+
+inline void
+_lock_stats_max(volatile u64 *a, u64 value) {
+	u64 old = *a;
+	while (value > old && !compare_and_swap_64(a, value, old)) old = *a;
+}
+void _lock_stats_record_acquire(Lock_Stats *stats, bool contended, u64 start_cycles, u64 end_cycles) {
+	atomic_add_64(&stats->acquisition_count, 1);
+	if (!contended) return;
+	
+	u64 wait_cycles = end_cycles-start_cycles;
+	atomic_add_64(&stats->contended_count, 1);
+	atomic_add_64(&stats->total_wait_cycles, wait_cycles);
+	_lock_stats_max(&stats->max_wait_cycles, wait_cycles);
+	
+#if ENABLE_PROFILING
+	_profiler_record_lock_wait(stats->name, start_cycles, end_cycles);
+#endif
+}
+void _lock_stats_record_release(Lock_Stats *stats, u64 acquired_cycles) {
+	u64 hold_cycles = rdtsc()-acquired_cycles;
+	atomic_add_64(&stats->total_hold_cycles, hold_cycles);
+	_lock_stats_max(&stats->max_hold_cycles, hold_cycles);
+}
+
+Lock_Stats *lock_stats_get(const char *name) {
+	// Registry lock is never named so this can't recurse
+	spinlock_acquire_or_wait(&_lock_stats_lock);
+	
+	Lock_Stats *stats = 0;
+	for (u64 i = 0; i < _lock_stats_count; i += 1) {
+		if (strings_match(STR(_lock_stats[i].name), STR(name))) {
+			stats = &_lock_stats[i];
+			break;
+		}
+	}
+	if (!stats && _lock_stats_count < MAX_LOCK_STATS) {
+		stats = &_lock_stats[_lock_stats_count];
+		memset(stats, 0, sizeof(Lock_Stats));
+		stats->name = name;
+		MEMORY_BARRIER;
+		_lock_stats_count += 1;
+	}
+	
+	spinlock_release(&_lock_stats_lock);
+	
+	return stats;
+}
+
+u64 lock_stats_get_all(Lock_Stats **out, u64 max_count) {
+	u64 count = min(_lock_stats_count, max_count);
+	for (u64 i = 0; i < count; i += 1) out[i] = &_lock_stats[i];
+	return count;
+}
+
+void lock_stats_reset() {
+	for (u64 i = 0; i < _lock_stats_count; i += 1) {
+		Lock_Stats *stats = &_lock_stats[i];
+		stats->acquisition_count = 0;
+		stats->contended_count   = 0;
+		stats->total_wait_cycles = 0;
+		stats->max_wait_cycles   = 0;
+		stats->total_hold_cycles = 0;
+		stats->max_hold_cycles   = 0;
+	}
+}
+
+void lock_stats_log_report() {
+	// Needed for cycles to seconds
+	profiler_init();
+	
+	for (u64 i = 0; i < _lock_stats_count; i += 1) {
+		Lock_Stats *stats = &_lock_stats[i];
+		if (stats->acquisition_count == 0) continue;
+		
+		log_info("%cs: %llu acquisitions, %llu contended (%.2f%%), waited %.3fms (max %.3fms), held %.3fms (max %.3fms)",
+			stats->name,
+			stats->acquisition_count,
+			stats->contended_count,
+			(f64)stats->contended_count / (f64)stats->acquisition_count * 100.0,
+			profiler_cycles_to_seconds(stats->total_wait_cycles)*1000.0,
+			profiler_cycles_to_seconds(stats->max_wait_cycles)*1000.0,
+			profiler_cycles_to_seconds(stats->total_hold_cycles)*1000.0,
+			profiler_cycles_to_seconds(stats->max_hold_cycles)*1000.0
+		);
+	}
+}
+
 void spinlock_init(Spinlock *l) {
 	memset(l, 0, sizeof(*l));
 }
+void spinlock_init_named(Spinlock *l, const char *name) {
+	spinlock_init(l);
+#if ENABLE_LOCK_STATS
+	l->stats = lock_stats_get(name);
+#endif
+}
+#if ENABLE_LOCK_STATS
+void _spinlock_acquire_or_wait_with_stats(Spinlock* l) {
+	u64 start_cycles = rdtsc();
+	bool contended = false;
+	while (true) {
+        bool expected = false;
+        if (compare_and_swap_bool(&l->locked, true, expected)) {
+            break;
+        }
+        contended = true;
+        while (l->locked) {
+            // spinny boi
+        }
+    }
+    l->acquired_cycles = rdtsc();
+    _lock_stats_record_acquire(l->stats, contended, start_cycles, l->acquired_cycles);
+}
+#endif
 void spinlock_acquire_or_wait(Spinlock* l) {
+#if ENABLE_LOCK_STATS
+	if (l->stats) {
+		_spinlock_acquire_or_wait_with_stats(l);
+		return;
+	}
+#endif
 	while (true) {
         bool expected = false;
         if (compare_and_swap_bool(&l->locked, true, expected)) {
@@ -77,11 +318,24 @@ void spinlock_acquire_or_wait(Spinlock* l) {
 // Returns true on aquired, false if timeout seconds reached
 bool spinlock_acquire_or_wait_timeout(Spinlock* l, f64 timeout_seconds) {
     f64 start = os_get_elapsed_seconds();
+#if ENABLE_LOCK_STATS
+    u64 start_cycles = l->stats ? rdtsc() : 0;
+    bool contended = false;
+#endif
 	while (true) {
         bool expected = false;
         if (compare_and_swap_bool(&l->locked, true, expected)) {
+#if ENABLE_LOCK_STATS
+            if (l->stats) {
+                l->acquired_cycles = rdtsc();
+                _lock_stats_record_acquire(l->stats, contended, start_cycles, l->acquired_cycles);
+            }
+#endif
             return true;
         }
+#if ENABLE_LOCK_STATS
+        contended = true;
+#endif
         while (l->locked) {
             // spinny boi
             if ((os_get_elapsed_seconds()-start) >= timeout_seconds) return false;
@@ -90,12 +344,94 @@ bool spinlock_acquire_or_wait_timeout(Spinlock* l, f64 timeout_seconds) {
     return true;
 }
 void spinlock_release(Spinlock* l) {
+#if ENABLE_LOCK_STATS
+	if (l->stats) _lock_stats_record_release(l->stats, l->acquired_cycles);
+#endif
 	bool expected = true;
     bool success = compare_and_swap_bool(&l->locked, false, expected);
     assert(success, "This thread should have acquired the spinlock but compare_and_swap failed");
 }
 
 
+///
+// Reader-writer spinlock
+
+void rw_spinlock_init(RW_Spinlock *l) {
+	l->state = 0;
+}
+void rw_spinlock_acquire_read(RW_Spinlock *l) {
+	u64 spins = 0;
+	while (true) {
+		u64 state = l->state;
+		if (!(state & RW_SPINLOCK_WRITER) && compare_and_swap_64(&l->state, state+1, state)) {
+			return;
+		}
+		spins += 1;
+		if (spins % RW_SPINLOCK_SPINS_BEFORE_YIELD == 0) os_yield_thread();
+	}
+}
+void rw_spinlock_release_read(RW_Spinlock *l) {
+	assert((l->state & ~RW_SPINLOCK_WRITER) != 0, "Tried to release a read lock which is not acquired");
+	atomic_add_64(&l->state, (u64)-1);
+}
+void rw_spinlock_acquire_write(RW_Spinlock *l) {
+	u64 spins = 0;
+	
+	// Claim the writer bit, after this readers can only leave
+	while (true) {
+		u64 state = l->state;
+		if (!(state & RW_SPINLOCK_WRITER) && compare_and_swap_64(&l->state, state | RW_SPINLOCK_WRITER, state)) {
+			break;
+		}
+		spins += 1;
+		if (spins % RW_SPINLOCK_SPINS_BEFORE_YIELD == 0) os_yield_thread();
+	}
+	
+	// Wait for the readers to leave. Checked with a compare_and_swap rather than a plain read
+	// so it's a full barrier against their reads.
+	while (!compare_and_swap_64(&l->state, RW_SPINLOCK_WRITER, RW_SPINLOCK_WRITER)) {
+		spins += 1;
+		if (spins % RW_SPINLOCK_SPINS_BEFORE_YIELD == 0) os_yield_thread();
+	}
+}
+void rw_spinlock_release_write(RW_Spinlock *l) {
+	bool success = compare_and_swap_64(&l->state, 0, RW_SPINLOCK_WRITER);
+	assert(success, "This thread should have acquired the write lock but compare_and_swap failed");
+}
+
+
+///
+// Spin barrier
+
+void spin_barrier_init(Spin_Barrier *b, u64 thread_count) {
+	assert(thread_count > 0, "Spin barrier needs at least one thread");
+	b->thread_count = thread_count;
+	b->arrived_count = 0;
+	b->generation = 0;
+}
+void spin_barrier_wait(Spin_Barrier *b) {
+	// Read before arriving, the last thread bumps it as soon as we've arrived
+	u64 generation = b->generation;
+	
+	if (atomic_add_64(&b->arrived_count, 1) == b->thread_count-1) {
+		// Reset before releasing anyone, so a thread which goes straight to the next wait
+		// counts from 0
+		b->arrived_count = 0;
+		atomic_add_64(&b->generation, 1);
+		return;
+	}
+	
+	u64 spins = 0;
+	while (b->generation == generation) {
+		spins += 1;
+		if (spins % RW_SPINLOCK_SPINS_BEFORE_YIELD == 0) os_yield_thread();
+	}
+	
+	// Full barrier, so we see everything the other threads wrote before arriving
+	atomic_add_64(&b->generation, 0);
+}
+
+
 ///
 // High-level mutex primitive (short spinlock then OS mutex lock)
 
@@ -105,11 +441,29 @@ void mutex_init(Mutex *m) {
 	m->os_handle = os_make_mutex();
 	m->spinlock_acquired = false;
 	m->acquiring_thread = 0;
+#if ENABLE_LOCK_STATS
+	m->stats = 0;
+#endif
+}
+void mutex_init_named(Mutex *m, const char *name) {
+	mutex_init(m);
+#if ENABLE_LOCK_STATS
+	m->stats = lock_stats_get(name);
+#endif
 }
 void mutex_destroy(Mutex *m) {
 	os_destroy_mutex(m->os_handle);
 }
 void mutex_acquire_or_wait(Mutex *m) {
+#if ENABLE_LOCK_STATS
+	u64 start_cycles = 0;
+	bool contended = false;
+	if (m->stats) {
+		start_cycles = rdtsc();
+		contended = m->acquiring_thread != 0 || m->spinlock.locked;
+	}
+#endif
+	
 	if (spinlock_acquire_or_wait_timeout(&m->spinlock, m->spin_time_microseconds / 1000000.0)) {
         assert(!m->spinlock_acquired, "Internal sync error in Mutex");
     	m->spinlock_acquired = true;
@@ -118,10 +472,20 @@ void mutex_acquire_or_wait(Mutex *m) {
     
     assert(!m->acquiring_thread, "Internal sync error in Mutex: Multiple threads acquired");
     m->acquiring_thread = context.thread_id;
+    
+#if ENABLE_LOCK_STATS
+    if (m->stats) {
+    	m->acquired_cycles = rdtsc();
+    	_lock_stats_record_acquire(m->stats, contended, start_cycles, m->acquired_cycles);
+    }
+#endif
 }
 void mutex_release(Mutex *m) {
 	assert(m->acquiring_thread != 0, "Tried to release a mutex which is not acquired");
 	assert(m->acquiring_thread == context.thread_id, "Non-owning thread tried to release mutex");
+#if ENABLE_LOCK_STATS
+	if (m->stats) _lock_stats_record_release(m->stats, m->acquired_cycles);
+#endif
 	m->acquiring_thread = 0;
 	bool was_spinlock_acquired = m->spinlock_acquired;
 	m->spinlock_acquired = false;
@@ -0,0 +1,238 @@
+
+// Concurrent hash table.
+// A Hash_Table split into shards by hash, each with its own reader-writer spinlock. Lookups only
+// take a shard's read lock, so any number of threads can read at once, and writes only block
+// the one shard they go to.
+// Values are copied in and out under the lock, since a pointer into a shard would be
+// invalidated by the next write to it from any thread.
+
+/*
+
+	Example Usage:
+
+
+	Concurrent_Hash_Table textures = make_concurrent_hash_table(string, Gfx_Image*, get_heap_allocator());
+
+	// Same as hash_table_set
+	bool newly_added = concurrent_hash_table_set(&textures, path, image);
+
+	// Copies the value to image if the key exists
+	Gfx_Image *image;
+	if (concurrent_hash_table_find(&textures, path, &image)) {
+
+	}
+
+	bool exists  = concurrent_hash_table_contains(&textures, path);
+	bool removed = concurrent_hash_table_remove(&textures, path);
+
+	// Find the value, or make it with create_proc and add it if the key doesn't exist.
+	// When several threads race for the same key, create_proc runs once and they all get
+	// the value it made. Returns true if this call made it.
+	void load_texture(void *key, void *value, void *user_data) {
+		*(Gfx_Image**)value = load_image_from_disk(*(string*)key, get_heap_allocator());
+	}
+	bool created = concurrent_hash_table_get_or_add(&textures, path, &image, load_texture, 0);
+
+	// Copy of all entries as a Hash_Table, to iterate without holding any locks
+	Hash_Table snapshot = concurrent_hash_table_snapshot(&textures, get_temporary_allocator());
+	for (u64 i = 0; i < snapshot.count; i += 1) {
+		string key = *(string*)hash_table_get_nth_key(&snapshot, i);
+		Gfx_Image *image = *(Gfx_Image**)hash_table_get_nth_value(&snapshot, i);
+	}
+	hash_table_destroy(&snapshot);
+
+	u64 count = concurrent_hash_table_count(&textures);
+
+	concurrent_hash_table_clear(&textures);
+	concurrent_hash_table_destroy(&textures);
+
+
+	Notes:
+		- create_proc runs with the key's shard write-locked, so it blocks other threads from
+		  that shard while it runs. If making a value is slow (like above), consider adding a
+		  pointer to something with its own loaded flag instead and loading outside the table.
+		- A snapshot locks one shard at a time, so it's consistent per shard but another
+		  thread can change shard 3 while we copy shard 5.
+		- Count is the sum of the shard counts, read without locks, so it's only exact when no
+		  one is writing.
+		- Keys and limitations are the same as for Hash_Table. For a custom key_equals, set it
+		  on the table of every shard before using the table:
+		  
+			for (u64 i = 0; i < CONCURRENT_HASH_TABLE_SHARD_COUNT; i += 1) {
+				table.shards[i].table.key_equals = my_key_equals;
+			}
+
+*/
+
+#ifndef CONCURRENT_HASH_TABLE_SHARD_COUNT
+	// Power of two
+	#define CONCURRENT_HASH_TABLE_SHARD_COUNT 64
+#endif
+
+typedef void(*Concurrent_Hash_Table_Create_Proc)(void *key, void *value, void *user_data);
+
+typedef struct Concurrent_Hash_Table_Shard {
+	RW_Spinlock lock;
+	Hash_Table table;
+
+	// So writing one shard's lock doesn't evict the next shard's cache line
+	u8 _padding[64];
+} Concurrent_Hash_Table_Shard;
+
+typedef struct Concurrent_Hash_Table {
+	Concurrent_Hash_Table_Shard *shards;
+
+	u64 _key_size;
+	u64 _value_size;
+
+	Allocator allocator;
+} Concurrent_Hash_Table;
+
+// API:
+#define make_concurrent_hash_table(Key_Type, Value_Type, allocator) \
+	make_concurrent_hash_table_raw(sizeof(Key_Type), sizeof(Value_Type), _hash_table_key_mode(Key_Type), allocator)
+
+#define concurrent_hash_table_find(table_ptr, key, value_out_ptr) \
+	concurrent_hash_table_find_raw((table_ptr), get_hash(key), &(key), (value_out_ptr), sizeof(key), sizeof(*(value_out_ptr)))
+
+#define concurrent_hash_table_contains(table_ptr, key) \
+	concurrent_hash_table_find_raw((table_ptr), get_hash(key), &(key), 0, sizeof(key), 0)
+
+#define concurrent_hash_table_set(table_ptr, key, value) \
+	concurrent_hash_table_set_raw((table_ptr), get_hash(key), &(key), &(value), sizeof(key), sizeof(value))
+
+#define concurrent_hash_table_remove(table_ptr, key) \
+	concurrent_hash_table_remove_raw((table_ptr), get_hash(key), &(key), sizeof(key))
+
+#define concurrent_hash_table_get_or_add(table_ptr, key, value_out_ptr, create_proc, user_data) \
+	concurrent_hash_table_get_or_add_raw((table_ptr), get_hash(key), &(key), (value_out_ptr), sizeof(key), sizeof(*(value_out_ptr)), (create_proc), (user_data))
+
+inline Concurrent_Hash_Table_Shard *
+_concurrent_hash_table_get_shard(Concurrent_Hash_Table *t, u64 hash) {
+	// Hash_Table indexes with the low bits and the top 7, so we shard with bits in between
+	return &t->shards[(hash >> 32) & (CONCURRENT_HASH_TABLE_SHARD_COUNT-1)];
+}
+
+Concurrent_Hash_Table make_concurrent_hash_table_raw(u64 key_size, u64 value_size, Hash_Table_Key_Mode key_mode, Allocator allocator) {
+	Concurrent_Hash_Table t = ZERO(Concurrent_Hash_Table);
+
+	t._key_size = key_size;
+	t._value_size = value_size;
+	t.allocator = allocator;
+
+	t.shards = alloc(allocator, CONCURRENT_HASH_TABLE_SHARD_COUNT*sizeof(Concurrent_Hash_Table_Shard));
+	for (u64 i = 0; i < CONCURRENT_HASH_TABLE_SHARD_COUNT; i += 1) {
+		rw_spinlock_init(&t.shards[i].lock);
+		t.shards[i].table = make_hash_table_reserve_raw(key_size, value_size, key_mode, 8, allocator);
+	}
+
+	return t;
+}
+
+void concurrent_hash_table_destroy(Concurrent_Hash_Table *t) {
+	for (u64 i = 0; i < CONCURRENT_HASH_TABLE_SHARD_COUNT; i += 1) {
+		hash_table_destroy(&t->shards[i].table);
+	}
+	dealloc(t->allocator, t->shards);
+	t->shards = 0;
+}
+
+void concurrent_hash_table_clear(Concurrent_Hash_Table *t) {
+	for (u64 i = 0; i < CONCURRENT_HASH_TABLE_SHARD_COUNT; i += 1) {
+		Concurrent_Hash_Table_Shard *shard = &t->shards[i];
+		rw_spinlock_acquire_write(&shard->lock);
+		hash_table_clear(&shard->table);
+		rw_spinlock_release_write(&shard->lock);
+	}
+}
+
+u64 concurrent_hash_table_count(Concurrent_Hash_Table *t) {
+	u64 count = 0;
+	for (u64 i = 0; i < CONCURRENT_HASH_TABLE_SHARD_COUNT; i += 1) {
+		count += t->shards[i].table.count;
+	}
+	return count;
+}
+
+// Returns true if key exists. value_out can be null.
+bool concurrent_hash_table_find_raw(Concurrent_Hash_Table *t, u64 hash, void *k, void *value_out, u64 key_size, u64 value_size) {
+	assert(!value_out || t->_value_size == value_size, "Value type size does not match concurrent hash table initted value type size");
+
+	Concurrent_Hash_Table_Shard *shard = _concurrent_hash_table_get_shard(t, hash);
+
+	rw_spinlock_acquire_read(&shard->lock);
+	void *value = hash_table_find_raw(&shard->table, hash, k, key_size);
+	if (value && value_out) memcpy(value_out, value, value_size);
+	rw_spinlock_release_read(&shard->lock);
+
+	return value != 0;
+}
+
+// Returns true if key was newly added or false if it already existed
+bool concurrent_hash_table_set_raw(Concurrent_Hash_Table *t, u64 hash, void *k, void *v, u64 key_size, u64 value_size) {
+	Concurrent_Hash_Table_Shard *shard = _concurrent_hash_table_get_shard(t, hash);
+
+	rw_spinlock_acquire_write(&shard->lock);
+	bool newly_added = hash_table_set_raw(&shard->table, hash, k, v, key_size, value_size);
+	rw_spinlock_release_write(&shard->lock);
+
+	return newly_added;
+}
+
+// Returns true if key existed
+bool concurrent_hash_table_remove_raw(Concurrent_Hash_Table *t, u64 hash, void *k, u64 key_size) {
+	Concurrent_Hash_Table_Shard *shard = _concurrent_hash_table_get_shard(t, hash);
+
+	rw_spinlock_acquire_write(&shard->lock);
+	bool removed = hash_table_remove_raw(&shard->table, hash, k, key_size);
+	rw_spinlock_release_write(&shard->lock);
+
+	return removed;
+}
+
+// Returns true if the value was made by create_proc in this call.
+// Either way, value_out holds the value for key after.
+bool concurrent_hash_table_get_or_add_raw(Concurrent_Hash_Table *t, u64 hash, void *k, void *value_out, u64 key_size, u64 value_size, Concurrent_Hash_Table_Create_Proc create_proc, void *user_data) {
+
+	// Most of the time the key exists and we don't need to block anyone
+	if (concurrent_hash_table_find_raw(t, hash, k, value_out, key_size, value_size)) return false;
+
+	Concurrent_Hash_Table_Shard *shard = _concurrent_hash_table_get_shard(t, hash);
+
+	rw_spinlock_acquire_write(&shard->lock);
+
+	// Someone may have added it between our find and getting the write lock
+	void *existing = hash_table_find_raw(&shard->table, hash, k, key_size);
+	if (existing) {
+		memcpy(value_out, existing, value_size);
+	} else {
+		create_proc(k, value_out, user_data);
+		hash_table_add_raw(&shard->table, hash, k, value_out, key_size, value_size);
+	}
+
+	rw_spinlock_release_write(&shard->lock);
+
+	return existing == 0;
+}
+
+Hash_Table concurrent_hash_table_snapshot(Concurrent_Hash_Table *t, Allocator allocator) {
+	Hash_Table *first = &t->shards[0].table;
+
+	Hash_Table snapshot = make_hash_table_reserve_raw(t->_key_size, t->_value_size, first->_key_mode, concurrent_hash_table_count(t), allocator);
+	snapshot.key_equals = first->key_equals;
+
+	for (u64 i = 0; i < CONCURRENT_HASH_TABLE_SHARD_COUNT; i += 1) {
+		Concurrent_Hash_Table_Shard *shard = &t->shards[i];
+
+		rw_spinlock_acquire_read(&shard->lock);
+		for (u64 j = 0; j < shard->table.count; j += 1) {
+			u64 hash = *(u64*)_hash_table_get_entry(&shard->table, j);
+			void *key = hash_table_get_nth_key(&shard->table, j);
+			void *value = hash_table_get_nth_value(&shard->table, j);
+			hash_table_add_raw(&snapshot, hash, key, value, t->_key_size, t->_value_size);
+		}
+		rw_spinlock_release_read(&shard->lock);
+	}
+
+	return snapshot;
+}
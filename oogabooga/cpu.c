@@ -25,13 +25,13 @@ typedef struct Cpu_Capabilities {
 
 ///
 // Compiler specific stuff
-#if COMPILER_MVSC
+#if COMPILER_MSVC
 	#define inline __forceinline
 	#define alignat(x) __declspec(align(x))
 	#define noreturn __declspec(noreturn)
     #define COMPILER_HAS_MEMCPY_INTRINSICS 1
-    inline void 
-    crash() noreturn {
+    noreturn inline void 
+    crash() {
 		__debugbreak();
 		volatile int *a = 0;
 		*a = 5;
@@ -73,12 +73,13 @@ typedef struct Cpu_Capabilities {
 		#define COMPILER_CAN_DO_AVX512 0
 	#endif
 	
-	#define DEPRECATED(proc, msg) __declspec(deprecated(msg)) func
+	#define DEPRECATED(proc, msg) __declspec(deprecated(msg)) proc
 	
 	#pragma intrinsic(_InterlockedCompareExchange8)
 	#pragma intrinsic(_InterlockedCompareExchange16)
 	#pragma intrinsic(_InterlockedCompareExchange)
 	#pragma intrinsic(_InterlockedCompareExchange64)
+	#pragma intrinsic(_InterlockedExchangeAdd64)
 	
 	inline bool 
 	compare_and_swap_8(volatile uint8_t *a, uint8_t b, uint8_t old) {
@@ -105,6 +106,36 @@ typedef struct Cpu_Capabilities {
 	    return compare_and_swap_8((uint8_t*)a, (uint8_t)b, (uint8_t)old);
 	}
 	
+	// Returns the value before the add
+	inline u64 
+	atomic_add_64(volatile u64 *a, u64 b) {
+	    return (u64)_InterlockedExchangeAdd64((volatile long long*)a, (long long)b);
+	}
+	
+	#pragma intrinsic(_BitScanForward)
+	#pragma intrinsic(_BitScanForward64)
+	#pragma intrinsic(_BitScanReverse64)
+	
+	// x must not be 0
+	inline u32 
+	count_trailing_zeros_32(u32 x) {
+		unsigned long i;
+		_BitScanForward(&i, x);
+		return (u32)i;
+	}
+	inline u32 
+	count_trailing_zeros_64(u64 x) {
+		unsigned long i;
+		_BitScanForward64(&i, x);
+		return (u32)i;
+	}
+	inline u32 
+	count_leading_zeros_64(u64 x) {
+		unsigned long i;
+		_BitScanReverse64(&i, x);
+		return 63 - (u32)i;
+	}
+	
 	#define MEMORY_BARRIER _ReadWriteBarrier()
 	
 	#define thread_local __declspec(thread)
@@ -225,6 +256,26 @@ typedef struct Cpu_Capabilities {
 	    return compare_and_swap_8((uint8_t*)a, (uint8_t)b, (uint8_t)old);
 	}
 	
+	// Returns the value before the add
+	inline u64 
+	atomic_add_64(volatile u64 *a, u64 b) {
+	    return __sync_fetch_and_add(a, b);
+	}
+	
+	// x must not be 0
+	inline u32 
+	count_trailing_zeros_32(u32 x) {
+		return (u32)__builtin_ctz(x);
+	}
+	inline u32 
+	count_trailing_zeros_64(u64 x) {
+		return (u32)__builtin_ctzll(x);
+	}
+	inline u32 
+	count_leading_zeros_64(u64 x) {
+		return (u32)__builtin_clzll(x);
+	}
+	
 	#define MEMORY_BARRIER {__asm__ __volatile__("" ::: "memory");__sync_synchronize();}
 	
 	#define thread_local __thread
@@ -244,6 +295,17 @@ typedef struct Cpu_Capabilities {
     inline u64 
     rdtsc() { return 0; }
     inline Cpu_Info_X86 cpuid(u32 function_id) {return (Cpu_Info_X86){0};}
+    
+    inline u64 
+    atomic_add_64(volatile u64 *a, u64 b) { u64 old = *a; *a += b; return old; }
+    
+    inline u32 
+    count_trailing_zeros_32(u32 x) { u32 n = 0; while (!(x & 1)) { x >>= 1; n += 1; } return n; }
+    inline u32 
+    count_trailing_zeros_64(u64 x) { u32 n = 0; while (!(x & 1)) { x >>= 1; n += 1; } return n; }
+    inline u32 
+    count_leading_zeros_64(u64 x) { u32 n = 0; while (!(x & (1ull << 63))) { x <<= 1; n += 1; } return n; }
+    
     #define COMPILER_CAN_DO_SSE2 0
     #define COMPILER_CAN_DO_AVX 0
     #define COMPILER_CAN_DO_AVX2 0
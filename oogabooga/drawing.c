@@ -53,6 +53,10 @@
 	
 			- For loading and dealing with fonts see font.c, or for a practical example see examples/text_rendering.c
 			
+		- Drawing the live profiler stats of a thread (see profiling.c), positioned by the top left corner:
+		
+			void draw_profiler_stats(Gfx_Font *font, u32 raster_height, Vector2 top_left, u64 thread_id);
+			
 		- Lower-level quad drawing:
 		
 			Draw_Quad *draw_quad_projected(Draw_Quad quad, Matrix4 world_to_clip);
@@ -186,6 +190,8 @@ typedef struct Draw_Quad {
 	
 } Draw_Quad;
 
+DEFINE_GROWING_ARRAY(Draw_Quad_Array, Draw_Quad);
+
 typedef struct Draw_Frame {
 	Matrix4 projection;
 	// #Cleanup
@@ -294,11 +300,7 @@ Draw_Quad *draw_quad_projected_in_frame(Draw_Quad quad, Matrix4 world_to_clip, D
 	
 	memset(quad.userdata, 0, sizeof(quad.userdata));
 	
-	Draw_Quad **target_buffer = &frame->quad_buffer;
-	
-	growing_array_add((void**)target_buffer, &quad);
-	
-	Draw_Quad *q = &(*target_buffer)[growing_array_get_valid_count(*target_buffer)-1];
+	Draw_Quad *q = Draw_Quad_Array_push(&frame->quad_buffer, quad);
 	
 	// This is meant to fix the annoying artifacts that shows up when sampling from a large atlas
     // presumably for floating point precision issues or something.
@@ -502,6 +504,57 @@ void pop_window_scissor_in_frame(Draw_Frame *frame) {
 }
 
 
+///
+// Profiler stats table, see "Live statistics" in profiling.c
+//
+
+void draw_profiler_stats_in_frame(Gfx_Font *font, u32 raster_height, Vector2 top_left, u64 thread_id, Draw_Frame *frame) {
+	Profile_Scope_Stats *stats = talloc(sizeof(Profile_Scope_Stats)*PROFILER_MAX_STAT_NODES);
+	u64 count = profiler_get_stats(thread_id, stats, PROFILER_MAX_STAT_NODES);
+	
+	Gfx_Font_Metrics metrics = get_font_metrics(font, raster_height);
+	float row_height   = metrics.line_spacing;
+	float indent       = raster_height;
+	float name_width   = raster_height*14;
+	float column_width = raster_height*5;
+	const u64 column_count = PROFILER_THREAD_CYCLES ? 7 : 6;
+	
+	Vector2 table_size = v2(name_width + column_width*column_count, row_height*(count+1.5));
+	draw_rect_in_frame(v2(top_left.x, top_left.y-table_size.y), table_size, v4(0, 0, 0, 0.7), frame);
+	
+	const char *headers[] = { "calls", "total ms", "self ms", "avg ms", "min ms", "max ms", "kcycles ran" };
+	Vector4 header_color = v4(0.7, 0.7, 0.7, 1.0);
+	
+	float y = top_left.y - metrics.latin_ascent;
+	draw_text_in_frame(font, tprint("Thread %llu, frame %llu", thread_id, profiler_frame_index-1), raster_height, v2(top_left.x, y), v2(1, 1), header_color, frame);
+	for (u64 c = 0; c < column_count; c += 1) {
+		draw_text_in_frame(font, STR(headers[c]), raster_height, v2(top_left.x + name_width + column_width*c, y), v2(1, 1), header_color, frame);
+	}
+	
+	for (u64 i = 0; i < count; i += 1) {
+		Profile_Scope_Stats *s = &stats[i];
+		y -= row_height;
+		
+		// Fade out scopes that weren't called last frame
+		Vector4 color = s->call_count ? v4(1.0, 1.0, 1.0, 1.0) : v4(0.5, 0.5, 0.5, 1.0);
+		
+		draw_text_in_frame(font, STR(s->name), raster_height, v2(top_left.x + indent*(s->depth-1), y), v2(1, 1), color, frame);
+		
+		string columns[] = {
+			tprint("%llu", s->call_count),
+			tprint("%.3f", s->total_seconds*1000.0),
+			tprint("%.3f", s->self_seconds*1000.0),
+			tprint("%.3f", s->average_seconds*1000.0),
+			tprint("%.3f", s->min_seconds*1000.0),
+			tprint("%.3f", s->max_seconds*1000.0),
+			tprint("%.1f", (f64)s->thread_cycles/1000.0),
+		};
+		for (u64 c = 0; c < column_count; c += 1) {
+			draw_text_in_frame(font, columns[c], raster_height, v2(top_left.x + name_width + column_width*c, y), v2(1, 1), color, frame);
+		}
+	}
+}
+
 ///
 // Global draw api (draw to global draw_frame)
 //
@@ -562,6 +615,10 @@ void draw_line(Vector2 p0, Vector2 p1, float line_width, Vector4 color) {
 	draw_line_in_frame(p0, p1, line_width, color, &draw_frame);
 }
 
+void draw_profiler_stats(Gfx_Font *font, u32 raster_height, Vector2 top_left, u64 thread_id) {
+	draw_profiler_stats_in_frame(font, raster_height, top_left, thread_id, &draw_frame);
+}
+
 inline
 void push_z_layer(s32 z) { push_z_layer_in_frame(z, &draw_frame); }
 inline
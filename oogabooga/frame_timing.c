@@ -0,0 +1,198 @@
+
+/*
+	Frame timing.
+
+	Records durations into a fixed size histogram so we can look at percentiles rather than
+	averages. Recording is a couple of integer ops and an increment, so it's always on, also
+	in release builds.
+
+	frame_timing
+		Global Frame_Timer which os_update() feeds with the time between calls to os_update(),
+		i.e. the duration of each frame.
+
+	Frame_Timer
+		Histogram with logarithmic buckets, 32 per power of two microseconds, so percentiles
+		are accurate to ~3%. Everything from 1 microsecond to over an hour fits.
+		Not thread safe, use one Frame_Timer per thread.
+
+	frame_timer_init(&timer, "Name", hitch_threshold_seconds)
+	frame_timer_record(&timer, seconds)
+	frame_timer_reset(&timer)
+
+	frame_timer_scope(&timer) { ... }
+		Records the duration of the scope. Useful for timing phases of a frame:
+
+			local_persist Frame_Timer physics_timing;
+			if (!physics_timing.name) frame_timer_init(&physics_timing, "Physics", 0.004);
+			frame_timer_scope(&physics_timing) {
+				update_physics();
+			}
+
+	frame_timer_get_percentile(&timer, 0.99)
+		p99 in seconds. Percentile is 0.0-1.0.
+
+	frame_timer_log_summary(&timer)
+		Logs count, average, p50, p90, p99, max and the number of hitches.
+
+	frame_timer_log_summary_on_exit(&timer)
+		Logs the summary when the program exits. FRAME_TIMING_LOG_SUMMARY_ON_EXIT 1 does this
+		for frame_timing.
+
+	FRAME_TIMING_HITCH_THRESHOLD is the hitch threshold of frame_timing, 1/30th of a second by
+	default.
+*/
+
+#ifndef FRAME_TIMING_HITCH_THRESHOLD
+	#define FRAME_TIMING_HITCH_THRESHOLD (1.0/30.0)
+#endif
+#ifndef FRAME_TIMING_LOG_SUMMARY_ON_EXIT
+	#define FRAME_TIMING_LOG_SUMMARY_ON_EXIT 0
+#endif
+
+// Buckets 0-63 are 1 microsecond each, after that 32 buckets per power of two
+#define FRAME_TIMER_LINEAR_BUCKETS 64
+#define FRAME_TIMER_SUB_BUCKET_BITS 5
+#define FRAME_TIMER_BUCKET_COUNT (FRAME_TIMER_LINEAR_BUCKETS + 26*(1 << FRAME_TIMER_SUB_BUCKET_BITS))
+
+#define MAX_FRAME_TIMERS_LOGGED_ON_EXIT 32
+
+typedef struct Frame_Timer {
+	const char *name;
+	f64 hitch_threshold_seconds;
+
+	u64 sample_count;
+	u64 hitch_count;
+	f64 total_seconds;
+	f64 max_seconds;
+
+	u32 buckets[FRAME_TIMER_BUCKET_COUNT];
+} Frame_Timer;
+
+// #Global
+ogb_instance Frame_Timer frame_timing;
+ogb_instance f64 _frame_timing_last_update_seconds;
+ogb_instance Frame_Timer *_frame_timers_logged_on_exit[MAX_FRAME_TIMERS_LOGGED_ON_EXIT];
+ogb_instance u64 _frame_timers_logged_on_exit_count;
+
+#if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
+Frame_Timer frame_timing = { "Frame", FRAME_TIMING_HITCH_THRESHOLD };
+f64 _frame_timing_last_update_seconds = 0;
+Frame_Timer *_frame_timers_logged_on_exit[MAX_FRAME_TIMERS_LOGGED_ON_EXIT];
+u64 _frame_timers_logged_on_exit_count = 0;
+#endif
+
+void frame_timer_init(Frame_Timer *timer, const char *name, f64 hitch_threshold_seconds) {
+	memset(timer, 0, sizeof(Frame_Timer));
+	timer->name = name;
+	timer->hitch_threshold_seconds = hitch_threshold_seconds;
+}
+
+void frame_timer_reset(Frame_Timer *timer) {
+	frame_timer_init(timer, timer->name, timer->hitch_threshold_seconds);
+}
+
+inline u64
+_frame_timer_bucket_index(u64 microseconds) {
+	if (microseconds < FRAME_TIMER_LINEAR_BUCKETS) return microseconds;
+
+	u64 exponent = 63 - count_leading_zeros_64(microseconds);
+	u64 sub_bucket = (microseconds >> (exponent-FRAME_TIMER_SUB_BUCKET_BITS)) & ((1 << FRAME_TIMER_SUB_BUCKET_BITS)-1);
+	u64 index = FRAME_TIMER_LINEAR_BUCKETS + (exponent-6)*(1 << FRAME_TIMER_SUB_BUCKET_BITS) + sub_bucket;
+
+	return min(index, FRAME_TIMER_BUCKET_COUNT-1);
+}
+// Exclusive upper bound of a bucket in microseconds
+u64 _frame_timer_bucket_upper_bound(u64 index) {
+	if (index < FRAME_TIMER_LINEAR_BUCKETS) return index+1;
+
+	index -= FRAME_TIMER_LINEAR_BUCKETS;
+	u64 exponent = 6 + index / (1 << FRAME_TIMER_SUB_BUCKET_BITS);
+	u64 sub_bucket = index % (1 << FRAME_TIMER_SUB_BUCKET_BITS);
+
+	return ((1 << FRAME_TIMER_SUB_BUCKET_BITS) + sub_bucket + 1) << (exponent-FRAME_TIMER_SUB_BUCKET_BITS);
+}
+
+inline void
+frame_timer_record(Frame_Timer *timer, f64 seconds) {
+	if (seconds < 0) seconds = 0;
+
+	// Rounded, 100*0.000001 seconds is 99.99999 microseconds and would land a bucket low
+	timer->buckets[_frame_timer_bucket_index((u64)(seconds*1000000.0 + 0.5))] += 1;
+
+	timer->sample_count  += 1;
+	timer->total_seconds += seconds;
+	if (seconds > timer->max_seconds) timer->max_seconds = seconds;
+	if (timer->hitch_threshold_seconds > 0 && seconds > timer->hitch_threshold_seconds) timer->hitch_count += 1;
+}
+
+f64 frame_timer_get_percentile(Frame_Timer *timer, f64 percentile) {
+	if (timer->sample_count == 0) return 0;
+
+	percentile = clamp(percentile, 0.0, 1.0);
+
+	u64 target = (u64)ceil(percentile * (f64)timer->sample_count);
+	if (target == 0) target = 1;
+
+	u64 count = 0;
+	for (u64 i = 0; i < FRAME_TIMER_BUCKET_COUNT; i += 1) {
+		count += timer->buckets[i];
+		if (count >= target) {
+			f64 upper_bound = (f64)_frame_timer_bucket_upper_bound(i) / 1000000.0;
+			return min(upper_bound, timer->max_seconds);
+		}
+	}
+
+	return timer->max_seconds;
+}
+
+f64 frame_timer_get_average(Frame_Timer *timer) {
+	if (timer->sample_count == 0) return 0;
+	return timer->total_seconds / (f64)timer->sample_count;
+}
+
+void frame_timer_log_summary(Frame_Timer *timer) {
+	log_info("%cs timing: %llu samples, avg %.2fms, p50 %.2fms, p90 %.2fms, p99 %.2fms, max %.2fms, %llu hitches over %.2fms",
+		timer->name ? timer->name : "Unnamed",
+		timer->sample_count,
+		frame_timer_get_average(timer)*1000.0,
+		frame_timer_get_percentile(timer, 0.50)*1000.0,
+		frame_timer_get_percentile(timer, 0.90)*1000.0,
+		frame_timer_get_percentile(timer, 0.99)*1000.0,
+		timer->max_seconds*1000.0,
+		timer->hitch_count,
+		timer->hitch_threshold_seconds*1000.0
+	);
+}
+
+void frame_timer_log_summary_on_exit(Frame_Timer *timer) {
+	for (u64 i = 0; i < _frame_timers_logged_on_exit_count; i += 1) {
+		if (_frame_timers_logged_on_exit[i] == timer) return;
+	}
+	assert(_frame_timers_logged_on_exit_count < MAX_FRAME_TIMERS_LOGGED_ON_EXIT, "Too many frame timers to log on exit, max is %d", MAX_FRAME_TIMERS_LOGGED_ON_EXIT);
+	_frame_timers_logged_on_exit[_frame_timers_logged_on_exit_count] = timer;
+	_frame_timers_logged_on_exit_count += 1;
+}
+
+// Called from main() when ENTRY_PROC returns
+void _frame_timing_log_exit_summaries() {
+#if FRAME_TIMING_LOG_SUMMARY_ON_EXIT
+	frame_timer_log_summary_on_exit(&frame_timing);
+#endif
+	for (u64 i = 0; i < _frame_timers_logged_on_exit_count; i += 1) {
+		frame_timer_log_summary(_frame_timers_logged_on_exit[i]);
+	}
+}
+
+// Called by os_update() at the start of each frame
+void frame_timing_new_frame() {
+	f64 now = os_get_elapsed_seconds();
+	if (_frame_timing_last_update_seconds != 0) {
+		frame_timer_record(&frame_timing, now - _frame_timing_last_update_seconds);
+	}
+	_frame_timing_last_update_seconds = now;
+}
+
+#define frame_timer_scope(timer) \
+    for (f64 _ft_start = os_get_elapsed_seconds(), _ft_done = 0; \
+         !_ft_done; \
+         _ft_done = 1, frame_timer_record(timer, os_get_elapsed_seconds() - _ft_start))
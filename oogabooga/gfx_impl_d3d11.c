@@ -58,8 +58,9 @@ ID3D11Buffer *d3d11_quad_ibo = 0;
 u32 d3d11_quad_vbo_size = 0;
 void *d3d11_staging_quad_buffer = 0;
 
-Draw_Quad *d3d11_sort_quad_buffer = 0;
-u64 d3d11_sort_quad_buffer_size = 0;
+// Sorted quad indices, followed by the help buffer for radix_sort_indices
+u32 *d3d11_sorted_quad_indices = 0;
+u64 d3d11_sort_buffer_size = 0;
 
 u64 d3d11_thread_id = 0;
 
@@ -622,6 +623,7 @@ void d3d11_draw_call(int number_of_rendered_quads, ID3D11ShaderResourceView **te
     }
 
     ID3D11DeviceContext_DrawIndexed(d3d11_context, number_of_rendered_quads * 6, 0, 0);
+    tm_counter("draw calls", 1);
      
     ID3D11ShaderResourceView* null_srv[32] = {0};
     ID3D11DeviceContext_PSSetShaderResources(d3d11_context, 31, num_textures, null_srv);
@@ -651,6 +653,7 @@ void gfx_render_draw_frame(Draw_Frame *frame, Gfx_Image *render_target) {
 	if (!frame->quad_buffer) return;
 
 	u64 number_of_quads = growing_array_get_valid_count(frame->quad_buffer);
+	tm_counter("quads", number_of_quads);
 	
 	///
 	// Maybe grow quad vbo
@@ -730,18 +733,23 @@ void gfx_render_draw_frame(Draw_Frame *frame, Gfx_Image *render_target) {
 		//
 		{
 			if (frame->enable_z_sorting) {
-				if (!d3d11_sort_quad_buffer || (d3d11_sort_quad_buffer_size < number_of_quads*sizeof(Draw_Quad))) {
+				// Sort indices rather than the quads themselves, so we don't copy whole quads
+				// around. We read the quads in sorted order below instead.
+				u64 index_bytes = align_next(number_of_quads*sizeof(u32), 8);
+				u64 needed_size = index_bytes + get_radix_sort_indices_help_buffer_size(number_of_quads);
+				if (!d3d11_sorted_quad_indices || (d3d11_sort_buffer_size < needed_size)) {
 					// #Memory #Heapalloc
-					if (d3d11_sort_quad_buffer) dealloc(get_heap_allocator(), d3d11_sort_quad_buffer);
-					d3d11_sort_quad_buffer = alloc(get_heap_allocator(), number_of_quads*sizeof(Draw_Quad));
-					d3d11_sort_quad_buffer_size = number_of_quads*sizeof(Draw_Quad);
+					if (d3d11_sorted_quad_indices) dealloc(get_heap_allocator(), d3d11_sorted_quad_indices);
+					d3d11_sorted_quad_indices = alloc(get_heap_allocator(), needed_size);
+					d3d11_sort_buffer_size = needed_size;
 				}
-				radix_sort(frame->quad_buffer, d3d11_sort_quad_buffer, number_of_quads, sizeof(Draw_Quad), offsetof(Draw_Quad, z), MAX_Z_BITS);
+				void *help_buffer = (u8*)d3d11_sorted_quad_indices + index_bytes;
+				radix_sort_indices(frame->quad_buffer, d3d11_sorted_quad_indices, help_buffer, number_of_quads, sizeof(Draw_Quad), offsetof(Draw_Quad, z), MAX_Z_BITS);
 			}
 		
 			for (u64 i = 0; i < number_of_quads; i++)  {
 				
-				Draw_Quad *q = &frame->quad_buffer[i];
+				Draw_Quad *q = &frame->quad_buffer[frame->enable_z_sorting ? d3d11_sorted_quad_indices[i] : i];
 				
 				assert(q->z <= MAX_Z, "Z is too high. Z is %d, Max is %d.", q->z, MAX_Z);
 				assert(q->z >= (-MAX_Z+1), "Z is too low. Z is %d, Min is %d.", q->z, -MAX_Z+1);
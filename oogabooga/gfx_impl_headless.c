@@ -0,0 +1,50 @@
+
+// There's no graphics device in headless mode.
+// Draw frames are still built (and z-sorted, if you sort them yourself) the same way as
+// with a renderer, they are just never rendered. Images only keep their size, and fonts
+// can still be loaded and measured.
+
+const Gfx_Handle GFX_INVALID_HANDLE = 0;
+
+void gfx_init() {
+	draw_frame_init(&draw_frame);
+	draw_frame_reset(&draw_frame);
+}
+
+void gfx_render_draw_frame(Draw_Frame *frame, Gfx_Image *render_target) {
+}
+void gfx_render_draw_frame_to_window(Draw_Frame *frame) {
+}
+
+void gfx_update() {
+	draw_frame_reset(&draw_frame);
+}
+
+void gfx_reserve_vbo_bytes(u64 number_of_bytes) {
+}
+
+void gfx_init_image(Gfx_Image *image, void *initial_data, bool render_target) {
+	image->gfx_handle = GFX_INVALID_HANDLE;
+	image->gfx_render_target = 0;
+}
+void gfx_set_image_data(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *data) {
+}
+// There is no image data to read, so this is all zeroes
+void gfx_read_image_data(Gfx_Image *image, u32 x, u32 y, u32 w, u32 h, void *output) {
+	memset(output, 0, (u64)w*(u64)h*(u64)image->channels);
+}
+void gfx_deinit_image(Gfx_Image *image) {
+}
+
+bool gfx_compile_shader_extension(string ext_source, u64 cbuffer_size, Gfx_Shader_Extension *result) {
+	*result = (Gfx_Shader_Extension){0};
+	return false;
+}
+void gfx_destroy_shader_extension(Gfx_Shader_Extension shader_extension) {
+}
+
+// DEPRECATED #Cleanup
+bool
+gfx_shader_recompile_with_extension(string ext_source, u64 cbuffer_size) {
+	return false;
+}
@@ -1,4 +1,11 @@
-#if GFX_RENDERER == GFX_RENDERER_D3D11
+#ifdef OOGABOOGA_HEADLESS
+	// No renderer, see gfx_impl_headless.c
+	typedef void * Gfx_Handle;
+	typedef void * Gfx_Render_Target_Handle;
+	
+	typedef struct { void *ps; void *cbuffer; u64 cbuffer_size; } Gfx_Shader_Extension;
+	
+#elif GFX_RENDERER == GFX_RENDERER_D3D11
 	#include <d3d11.h>
 	#include <dxgi.h>
 	#include <dxgi1_2.h>
@@ -8,28 +8,39 @@
 		void growing_array_deinit(void **array);
 		
 		void *growing_array_add_empty(void **array);
-		void *growing_array_add_multiple_empty(void **array);
+		void *growing_array_add_multiple_empty(void **array, u64 count);
 		void growing_array_add(void **array, void *item);
 		void growing_array_add_multiple(void **array, void *items, u64 count);
 		
+		void *growing_array_insert_multiple_empty(void **array, u64 index, u64 count);
+		void growing_array_insert(void **array, u64 index, void *item);
+		void growing_array_insert_multiple(void **array, u64 index, void *items, u64 count);
+		
 		void growing_array_reserve(void **array, u64 count_to_reserve);
+		void growing_array_set_growth_factor(void **array, float32 factor);
+		void growing_array_set_growth_chunk(void **array, u64 chunk_count);
 		void growing_array_resize(void **array, u64 new_count);
 		void growing_array_pop(void **array);
 		void growing_array_clear(void **array);
 		
 		// Returns -1 if not found
-		s32  growing_array_find_index_from_left_by_pointer(void **array, void *p);
-		s32  growing_array_find_index_from_left_by_value(void **array, void *p);
+		s64  growing_array_find_index_from_left_by_pointer(void **array, void *p);
+		s64  growing_array_find_index_from_left_by_value(void **array, void *p);
 		
-		void growing_array_ordered_remove_by_index(void **array, u32 index);
-		void growing_array_unordered_remove_by_index(void **array, u32 index);
+		void growing_array_ordered_remove_by_index(void **array, u64 index);
+		void growing_array_ordered_remove_range(void **array, u64 index, u64 count);
+		void growing_array_unordered_remove_by_index(void **array, u64 index);
 		bool growing_array_ordered_remove_by_pointer(void **array, void *p);
 		bool growing_array_unordered_remove_by_pointer(void **array, void *p);
 		bool growing_array_ordered_remove_one_by_value(void **array, void *p);
 		bool growing_array_unordered_remove_one_by_value(void **array, void *p);
 		
-		u32  growing_array_get_valid_count(void *array);
-		u32  growing_array_get_allocated_count(void *array);
+		// These keep the order and return the number of removed items
+		u64  growing_array_remove_if(void **array, Growing_Array_Predicate should_remove, void *user_data);
+		u64  growing_array_remove_by_mask(void **array, u64 *remove_mask);
+		
+		u64  growing_array_get_valid_count(void *array);
+		u64  growing_array_get_allocated_count(void *array);
 
 	Usage:
 	
@@ -43,15 +54,35 @@
 	    
 	    Thing *nth_thing = &things[n];
 	    
+	    // Fill many things directly in the array
+	    Thing *new_things = growing_array_add_multiple_empty(&things, 100);
+	    
+	    growing_array_insert(&things, 3, &new_thing);
+	    growing_array_insert_multiple(&things, 3, more_things, 10);
+	    
 	    growing_array_reserve_count(&things, 690);
 	    growing_array_resize_count(&things, 69);
 	    
+	    // When full, grow to 1.5x the size instead of 2x
+	    growing_array_set_growth_factor(&things, 1.5);
+	    // Or grow by 4096 things at a time
+	    growing_array_set_growth_chunk(&things, 4096);
+	    
 	    // "Slow", but stuff in the array keeps the same order
 	    growing_array_ordered_remove_by_index(&things, i);
 	    
 	    // Fast, but will not keep stuff ordered
 	    growing_array_unordered_remove_by_index(&things, i);
 	    
+	    growing_array_ordered_remove_range(&things, i, 10);
+	    
+	    // Remove everything the predicate returns true for, in one pass
+	    bool is_dead(void *thing, void *user_data) { return ((Thing*)thing)->health <= 0; }
+	    growing_array_remove_if(&things, is_dead, 0);
+	    
+	    // Or everything with its bit set, bit i of remove_mask[i/64] for thing i
+	    growing_array_remove_by_mask(&things, remove_mask);
+	    
 	    growing_array_ordered_remove_by_pointer(&things, nth_thing);
 	    growing_array_unordered_remove_by_pointer(&things, nth_thing);
 	    
@@ -63,16 +94,50 @@
 	    
 	    growing_array_get_valid_count(&things);
 	    growing_array_get_allocated_count(&things);
+	    
+	Typed arrays:
+	
+		DEFINE_GROWING_ARRAY(Thing_Array, Thing);
+		
+		Makes inline functions for arrays of Thing, which copy whole Things instead of calling
+		memcpy with the size from the header, and only check the signature in debug builds.
+		They work on the same Thing* as the functions above, so both can be used on one array.
+		
+	    Thing *things;
+	    Thing_Array_init(&things, get_heap_allocator());
+	    Thing_Array_init_reserve(&things, 1024, get_heap_allocator());
+	    
+	    Thing *added = Thing_Array_push(&things, new_thing); // new_thing doesn't need to be an lvalue
+	    Thing *empty = Thing_Array_push_empty(&things);
+	    Thing *last  = Thing_Array_last(things);
+	    u64 count    = Thing_Array_count(things);
+	    
+	    Thing_Array_pop(&things);
+	    Thing_Array_unordered_remove(&things, i);
+	    Thing_Array_reserve(&things, 4096);
+	    Thing_Array_clear(&things);
+	    Thing_Array_deinit(&things);
+	    
+	Notes:
+		- Growing reallocates through the array's allocator, so with the heap allocator it
+		  grows in place when there's free memory after the array. Pointers into the array are
+		  invalidated by anything that may grow it either way.
     
 */
 
 #define GROWING_ARRAY_SIGNATURE 2224364215
+#define GROWING_ARRAY_DEFAULT_GROWTH_FACTOR 2.0f
+
+typedef bool(*Growing_Array_Predicate)(void *item, void *user_data);
 
+// 48 bytes, so the items after it stay 16 byte aligned
 typedef struct Growing_Array_Header {
 	u32 signature;
-    u32 valid_count;
-    u32 allocated_count;
     u32 block_size_in_bytes;
+    u64 valid_count;
+    u64 allocated_count;
+    float32 growth_factor; // Used when growth_chunk_count is 0
+    u32 growth_chunk_count;
     Allocator allocator;
 } Growing_Array_Header;
 
@@ -83,10 +148,21 @@ check_growing_array_signature(void **array) {
 	return true;
 }
 
+// Don't round up past what the heap can give in one allocation, unless we actually need that many
+u64
+_growing_array_clamp_count(Allocator allocator, u64 block_size_in_bytes, u64 count, u64 required_count) {
+    if (allocator.proc != get_heap_allocator().proc) return count;
+    
+    u64 max_count = (get_heap_max_allocation_size()-sizeof(Growing_Array_Header))/block_size_in_bytes;
+    if (count > max_count) count = max(max_count, required_count);
+    
+    return count;
+}
+
 void
 growing_array_init_reserve(void **array, u64 block_size_in_bytes, u64 count_to_reserve, Allocator allocator) {
     
-    count_to_reserve = get_next_power_of_two(count_to_reserve);
+    count_to_reserve = _growing_array_clamp_count(allocator, block_size_in_bytes, get_next_power_of_two(count_to_reserve), count_to_reserve);
     u64 bytes_to_allocate = count_to_reserve*block_size_in_bytes + sizeof(Growing_Array_Header);
     
     Growing_Array_Header *header = (Growing_Array_Header*)alloc(allocator, bytes_to_allocate);
@@ -95,6 +171,8 @@ growing_array_init_reserve(void **array, u64 block_size_in_bytes, u64 count_to_r
     header->block_size_in_bytes = block_size_in_bytes;
     header->valid_count = 0;
     header->allocated_count = count_to_reserve;
+    header->growth_factor = GROWING_ARRAY_DEFAULT_GROWTH_FACTOR;
+    header->growth_chunk_count = 0;
     header->signature = GROWING_ARRAY_SIGNATURE;
     
     *array = header+1;
@@ -110,6 +188,22 @@ growing_array_deinit(void **array) {
     dealloc(header->allocator, header);
 }
 
+void
+growing_array_set_growth_factor(void **array, float32 factor) {
+	assert(check_growing_array_signature(array), "Not a valid growing array");
+	assert(factor > 1.0f, "Growing array growth factor must be more than 1");
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    header->growth_factor = factor;
+    header->growth_chunk_count = 0;
+}
+void
+growing_array_set_growth_chunk(void **array, u64 chunk_count) {
+	assert(check_growing_array_signature(array), "Not a valid growing array");
+	assert(chunk_count > 0 && chunk_count <= UINT32_MAX, "Growing array growth chunk must be between 1 and %u", UINT32_MAX);
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    header->growth_chunk_count = (u32)chunk_count;
+}
+
 void
 growing_array_reserve(void **array, u64 count_to_reserve) {
 	assert(check_growing_array_signature(array), "Not a valid growing array");
@@ -117,19 +211,28 @@ growing_array_reserve(void **array, u64 count_to_reserve) {
     
     if (header->allocated_count >= count_to_reserve) return;
     
-    u64 old_allocated_bytes = header->allocated_count*header->block_size_in_bytes+sizeof(Growing_Array_Header);
-    count_to_reserve = get_next_power_of_two(count_to_reserve);
-    u64 bytes_to_allocate = count_to_reserve*header->block_size_in_bytes+sizeof(Growing_Array_Header);
-    Growing_Array_Header *new_header = (Growing_Array_Header*)alloc(header->allocator, bytes_to_allocate);
+    u64 new_count;
+    if (header->growth_chunk_count) {
+        u64 chunk = header->growth_chunk_count;
+        new_count = ((count_to_reserve + chunk - 1)/chunk)*chunk;
+    } else {
+        new_count = (u64)((float64)header->allocated_count*header->growth_factor);
+        new_count = max(new_count, count_to_reserve);
+    }
     
-    memcpy(new_header, header, old_allocated_bytes);
+    new_count = _growing_array_clamp_count(header->allocator, header->block_size_in_bytes, new_count, count_to_reserve);
     
+    u64 old_allocated_bytes = header->allocated_count*header->block_size_in_bytes+sizeof(Growing_Array_Header);
+    u64 bytes_to_allocate = new_count*header->block_size_in_bytes+sizeof(Growing_Array_Header);
+    Growing_Array_Header *new_header = (Growing_Array_Header*)reallocate(header->allocator, header, old_allocated_bytes, bytes_to_allocate);
     
-    *array = new_header+1;
+#if DO_ZERO_INITIALIZATION
+    memset((u8*)new_header + old_allocated_bytes, 0, bytes_to_allocate-old_allocated_bytes);
+#endif
     
-    new_header->allocated_count = count_to_reserve;
+    *array = new_header+1;
     
-    dealloc(header->allocator, header);
+    new_header->allocated_count = new_count;
 }
 
 void*
@@ -181,6 +284,47 @@ growing_array_add_multiple(void **array, void *items, u64 count) {
     memcpy(start, items, header->block_size_in_bytes*count);
 }
 
+void*
+growing_array_insert_multiple_empty(void **array, u64 index, u64 count) {
+	assert(check_growing_array_signature(array), "Not a valid growing array");
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    assert(index <= header->valid_count, "Growing array index out of range");
+    growing_array_reserve(array, header->valid_count+count);
+    
+    // Pointer might have been invalidated after reserve
+    header = ((Growing_Array_Header*)*array) - 1; 
+    
+    u8 *start = (u8*)*array + index*header->block_size_in_bytes;
+    
+    memmove(
+        start + count*header->block_size_in_bytes,
+        start,
+        (header->valid_count-index)*header->block_size_in_bytes
+    );
+    
+    header->valid_count += count;
+    
+    return start;
+}
+void
+growing_array_insert(void **array, u64 index, void *item) {
+
+    void *new = growing_array_insert_multiple_empty(array, index, 1);
+
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    
+    memcpy(new, item, header->block_size_in_bytes);
+}
+void
+growing_array_insert_multiple(void **array, u64 index, void *items, u64 count) {
+
+    void *start = growing_array_insert_multiple_empty(array, index, count);
+
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    
+    memcpy(start, items, header->block_size_in_bytes*count);
+}
+
 void growing_array_resize(void **array, u64 new_count) {
     growing_array_reserve(array, new_count);
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
@@ -201,7 +345,7 @@ void growing_array_clear(void **array) {
 }
 
 void 
-growing_array_ordered_remove_by_index(void **array, u32 index) {
+growing_array_ordered_remove_by_index(void **array, u64 index) {
 	assert(check_growing_array_signature(array), "Not a valid growing array");
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     assert(index < header->valid_count, "Growing array index out of range");
@@ -213,7 +357,8 @@ growing_array_ordered_remove_by_index(void **array, u32 index) {
     
     u64 byte_index = header->block_size_in_bytes*index;
     
-    memcpy(
+    // Source and destination overlap
+    memmove(
         (u8*)*array + byte_index, 
         (u8*)*array + byte_index + header->block_size_in_bytes,
         (header->valid_count-index-1)*header->block_size_in_bytes
@@ -221,7 +366,23 @@ growing_array_ordered_remove_by_index(void **array, u32 index) {
     header->valid_count -= 1;
 }
 void 
-growing_array_unordered_remove_by_index(void **array, u32 index) {
+growing_array_ordered_remove_range(void **array, u64 index, u64 count) {
+	assert(check_growing_array_signature(array), "Not a valid growing array");
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    assert(index <= header->valid_count && count <= header->valid_count-index, "Growing array range out of range");
+    
+    u64 byte_index = header->block_size_in_bytes*index;
+    u64 byte_count = header->block_size_in_bytes*count;
+    
+    memmove(
+        (u8*)*array + byte_index, 
+        (u8*)*array + byte_index + byte_count,
+        (header->valid_count-index-count)*header->block_size_in_bytes
+    );
+    header->valid_count -= count;
+}
+void 
+growing_array_unordered_remove_by_index(void **array, u64 index) {
 	assert(check_growing_array_signature(array), "Not a valid growing array");
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     assert(index < header->valid_count, "Growing array index out of range");
@@ -242,12 +403,12 @@ growing_array_unordered_remove_by_index(void **array, u32 index) {
     header->valid_count -= 1;
 }
 
-s32
+s64
 growing_array_find_index_from_left_by_pointer(void **array, void *p) {
 	assert(check_growing_array_signature(array), "Not a valid growing array");
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     
-    for (u32 i = 0; i < header->valid_count; i++) {
+    for (u64 i = 0; i < header->valid_count; i++) {
         void *next = (u8*)*array + i*header->block_size_in_bytes;
         
         if (next == p) {
@@ -256,12 +417,12 @@ growing_array_find_index_from_left_by_pointer(void **array, void *p) {
     }
     return -1;
 }
-s32
+s64
 growing_array_find_index_from_left_by_value(void **array, void *p) {
 	assert(check_growing_array_signature(array), "Not a valid growing array");
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     
-    for (u32 i = 0; i < header->valid_count; i++) {
+    for (u64 i = 0; i < header->valid_count; i++) {
         void *next = (u8*)*array + i*header->block_size_in_bytes;
         
         if (bytes_match(next, p, header->block_size_in_bytes)) {
@@ -275,7 +436,7 @@ bool
 growing_array_ordered_remove_by_pointer(void **array, void *p) {
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     
-    s32 i = growing_array_find_index_from_left_by_pointer(array, p);
+    s64 i = growing_array_find_index_from_left_by_pointer(array, p);
     
     if (i < 0) return false;
     
@@ -287,7 +448,7 @@ bool
 growing_array_unordered_remove_by_pointer(void **array, void *p) {
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     
-    s32 i = growing_array_find_index_from_left_by_pointer(array, p);
+    s64 i = growing_array_find_index_from_left_by_pointer(array, p);
     
     if (i < 0) return false;
     
@@ -299,7 +460,7 @@ bool
 growing_array_ordered_remove_one_by_value(void **array, void *p) {
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     
-    s32 i = growing_array_find_index_from_left_by_value(array, p);
+    s64 i = growing_array_find_index_from_left_by_value(array, p);
     
     if (i < 0) return false;
     
@@ -311,7 +472,7 @@ bool
 growing_array_unordered_remove_one_by_value(void **array, void *p) {
     Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
     
-    s32 i = growing_array_find_index_from_left_by_value(array, p);
+    s64 i = growing_array_find_index_from_left_by_value(array, p);
     
     if (i < 0) return false;
     
@@ -320,19 +481,157 @@ growing_array_unordered_remove_one_by_value(void **array, void *p) {
     return true;
 }
 
+// Removes all items should_remove returns true for, keeping the order of the rest.
+// Kept items are moved in runs, so each item moves at most once.
+u64
+growing_array_remove_if(void **array, Growing_Array_Predicate should_remove, void *user_data) {
+	assert(check_growing_array_signature(array), "Not a valid growing array");
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    
+    u8 *items = (u8*)*array;
+    u64 size = header->block_size_in_bytes;
+    
+    u64 kept_count = 0;
+    u64 run_start = 0;
+    for (u64 i = 0; i < header->valid_count; i++) {
+        if (!should_remove(items + i*size, user_data)) continue;
+        
+        if (i > run_start) {
+            if (kept_count != run_start) memmove(items + kept_count*size, items + run_start*size, (i-run_start)*size);
+            kept_count += i-run_start;
+        }
+        run_start = i+1;
+    }
+    if (header->valid_count > run_start) {
+        if (kept_count != run_start) memmove(items + kept_count*size, items + run_start*size, (header->valid_count-run_start)*size);
+        kept_count += header->valid_count-run_start;
+    }
+    
+    u64 removed_count = header->valid_count-kept_count;
+    header->valid_count = kept_count;
+    return removed_count;
+}
+// Same as growing_array_remove_if, removing item i if bit i%64 of remove_mask[i/64] is set.
+// remove_mask needs (valid_count+63)/64 u64's.
+u64
+growing_array_remove_by_mask(void **array, u64 *remove_mask) {
+	assert(check_growing_array_signature(array), "Not a valid growing array");
+    Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1;
+    
+    u8 *items = (u8*)*array;
+    u64 size = header->block_size_in_bytes;
+    u64 count = header->valid_count;
+    
+    u64 kept_count = 0;
+    u64 run_start = 0;
+    for (u64 word_index = 0; word_index*64 < count; word_index++) {
+        u64 word = remove_mask[word_index];
+        
+        // Don't look at bits past the last item
+        u64 bits_in_word = min(count - word_index*64, 64);
+        if (bits_in_word < 64) word &= (1ull << bits_in_word) - 1;
+        
+        while (word) {
+            u64 i = word_index*64 + count_trailing_zeros_64(word);
+            word &= word-1;
+            
+            if (i > run_start) {
+                if (kept_count != run_start) memmove(items + kept_count*size, items + run_start*size, (i-run_start)*size);
+                kept_count += i-run_start;
+            }
+            run_start = i+1;
+        }
+    }
+    if (count > run_start) {
+        if (kept_count != run_start) memmove(items + kept_count*size, items + run_start*size, (count-run_start)*size);
+        kept_count += count-run_start;
+    }
+    
+    header->valid_count = kept_count;
+    return count-kept_count;
+}
+
 // #Incomplete
 // s32 growing_array_ordered_remove_one_by_value(void **array, void *p)
 // s32 growing_array_unordered_remove_one_by_value(void **array, void *p)
 
-u32
+u64
 growing_array_get_valid_count(void *array) {
 	assert(check_growing_array_signature(&array), "Not a valid growing array");
     Growing_Array_Header *header = ((Growing_Array_Header*)array) - 1;
     return header->valid_count;
 }
-u32
+u64
 growing_array_get_allocated_count(void *array) {
 	assert(check_growing_array_signature(&array), "Not a valid growing array");
     Growing_Array_Header *header = ((Growing_Array_Header*)array) - 1;
     return header->allocated_count;
-}
\ No newline at end of file
+}
+
+#if CONFIGURATION == DEBUG
+	#define _growing_array_check_typed(header, Type) \
+		assert((header)->signature == GROWING_ARRAY_SIGNATURE, "Not a valid growing array"); \
+		assert((header)->block_size_in_bytes == sizeof(Type), "Growing array of " #Type " was initted with a different item size")
+#else
+	#define _growing_array_check_typed(header, Type)
+#endif
+
+#define DEFINE_GROWING_ARRAY(Name, Type) \
+	inline void Name##_init_reserve(Type **array, u64 count_to_reserve, Allocator allocator) { \
+		growing_array_init_reserve((void**)array, sizeof(Type), count_to_reserve, allocator); \
+	} \
+	inline void Name##_init(Type **array, Allocator allocator) { \
+		growing_array_init((void**)array, sizeof(Type), allocator); \
+	} \
+	inline void Name##_deinit(Type **array) { \
+		growing_array_deinit((void**)array); \
+		*array = 0; \
+	} \
+	inline void Name##_reserve(Type **array, u64 count_to_reserve) { \
+		growing_array_reserve((void**)array, count_to_reserve); \
+	} \
+	inline u64 Name##_count(Type *array) { \
+		Growing_Array_Header *header = ((Growing_Array_Header*)array) - 1; \
+		_growing_array_check_typed(header, Type); \
+		return header->valid_count; \
+	} \
+	inline Type *Name##_push_empty(Type **array) { \
+		Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1; \
+		_growing_array_check_typed(header, Type); \
+		if (header->valid_count == header->allocated_count) { \
+			growing_array_reserve((void**)array, header->valid_count+1); \
+			header = ((Growing_Array_Header*)*array) - 1; \
+		} \
+		Type *item = *array + header->valid_count; \
+		header->valid_count += 1; \
+		return item; \
+	} \
+	inline Type *Name##_push(Type **array, Type item) { \
+		Type *new_item = Name##_push_empty(array); \
+		*new_item = item; \
+		return new_item; \
+	} \
+	inline Type *Name##_last(Type *array) { \
+		Growing_Array_Header *header = ((Growing_Array_Header*)array) - 1; \
+		_growing_array_check_typed(header, Type); \
+		assert(header->valid_count > 0, "No last item in empty growing array"); \
+		return array + header->valid_count-1; \
+	} \
+	inline void Name##_pop(Type **array) { \
+		Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1; \
+		_growing_array_check_typed(header, Type); \
+		assert(header->valid_count > 0, "No items to pop in growing array"); \
+		header->valid_count -= 1; \
+	} \
+	inline void Name##_unordered_remove(Type **array, u64 index) { \
+		Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1; \
+		_growing_array_check_typed(header, Type); \
+		assert(index < header->valid_count, "Growing array index out of range"); \
+		header->valid_count -= 1; \
+		(*array)[index] = (*array)[header->valid_count]; \
+	} \
+	inline void Name##_clear(Type **array) { \
+		Growing_Array_Header *header = ((Growing_Array_Header*)*array) - 1; \
+		_growing_array_check_typed(header, Type); \
+		header->valid_count = 0; \
+	}
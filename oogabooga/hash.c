@@ -54,9 +54,378 @@ u64 djb2_hash(string s) {
     return hash;
 }
 
+///
+// Byte hashing
+// hash_bytes() is what string_get_hash() (and so Hash_Table) uses, and what you'd use to
+// content-address blobs of data.
+// Up to HASH_LONG_INPUT_SIZE bytes it's wyhash: a few 64x64->128 bit multiplies, with a fast path
+// for up to 16 bytes. Longer input goes into 8 accumulators 64 bytes (a stripe) at a time, like
+// XXH3, with SSE2 or AVX2 when enabled. The result doesn't depend on which one, so hashes can be
+// saved to disk.
+// Different seeds give unrelated hashes, f.ex. to keep keys you don't control from
+// being picked to collide.
+// Hash_Stream hashes input which comes in pieces, like a file read in chunks, and gives the
+// same hash as hash_bytes() of all of it at once.
+
+#define HASH_LONG_INPUT_SIZE 256
+#define HASH_STRIPE_SIZE 64
+#define HASH_SECRET_SIZE 192
+// Each stripe of a block uses the secret 8 bytes further in
+#define HASH_STRIPES_PER_BLOCK ((HASH_SECRET_SIZE-HASH_STRIPE_SIZE)/8)
+
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+
+// Random bytes, the key for long input
+const u8 _hash_secret[HASH_SECRET_SIZE] = {
+	0x43, 0x7d, 0xee, 0xdd, 0x69, 0x5e, 0x2a, 0x78, 0xc3, 0x59, 0x56, 0xbb, 0xcd, 0xc7, 0xda, 0x77,
+	0x76, 0xc7, 0x7e, 0xbe, 0xce, 0x59, 0xc9, 0x03, 0x3e, 0x97, 0xb3, 0x6f, 0x9a, 0x54, 0x46, 0x46,
+	0xa6, 0x83, 0x92, 0x7a, 0xce, 0x19, 0x97, 0x4b, 0xd5, 0x50, 0xb7, 0x5f, 0x12, 0x66, 0xc2, 0x57,
+	0x9c, 0x9d, 0xc0, 0x65, 0xd7, 0x4a, 0x40, 0x80, 0x9a, 0x3b, 0xc6, 0x6d, 0x84, 0x17, 0x1a, 0xd2,
+	0x3c, 0x19, 0x61, 0x45, 0x8d, 0xfe, 0x12, 0x5f, 0x98, 0x58, 0xcf, 0xf6, 0x69, 0xc7, 0x1e, 0x42,
+	0x1c, 0xbb, 0x7b, 0xd9, 0x8d, 0xea, 0x35, 0x93, 0x43, 0xe6, 0xc0, 0x47, 0x1a, 0xa6, 0x7f, 0x26,
+	0x21, 0x49, 0x25, 0xa3, 0x57, 0x03, 0x76, 0x85, 0xc5, 0x18, 0xb0, 0xa1, 0x0c, 0xa6, 0x3f, 0x47,
+	0x23, 0x9c, 0x98, 0xf0, 0x59, 0x35, 0x63, 0x61, 0x31, 0x6d, 0xde, 0x72, 0xc1, 0x25, 0x13, 0x3a,
+	0x58, 0x9c, 0xd8, 0x29, 0x5c, 0xf0, 0xae, 0xa0, 0x44, 0xd0, 0x68, 0xce, 0xab, 0xa3, 0x08, 0xd3,
+	0x85, 0xdc, 0xd8, 0x44, 0x5b, 0xe0, 0x2d, 0x8d, 0xfb, 0x38, 0xa8, 0x37, 0x29, 0xe4, 0x5b, 0xb1,
+	0x91, 0xa0, 0x45, 0xdc, 0x0f, 0xe9, 0x48, 0xe2, 0xac, 0x07, 0xbc, 0xc1, 0xd0, 0xb0, 0xb3, 0x78,
+	0x50, 0x1e, 0x1c, 0xf7, 0xc8, 0x7d, 0x70, 0x18, 0x83, 0x41, 0xc4, 0x69, 0xd2, 0xc1, 0xe2, 0x6d,
+};
+// wyhash's constants, the key for short input
+const u64 _wyhash_secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+typedef struct Hash_Stream {
+	u64 acc[8];
+	u64 seed;
+	u64 total_size;
+	u64 stripes_in_block;
+	u64 buffered_size;
+	u8 secret[HASH_SECRET_SIZE];
+	// The stripe before the buffered bytes, then the buffered bytes. The last stripe is the
+	// last 64 bytes of input, which can begin before what's buffered.
+	u8 buffer[HASH_STRIPE_SIZE + HASH_LONG_INPUT_SIZE];
+} Hash_Stream;
+
+inline u64 _hash_read_64(const u8 *p) {
+	u64 x;
+	memcpy(&x, p, sizeof(u64));
+	return x;
+}
+inline u64 _hash_read_32(const u8 *p) {
+	u32 x;
+	memcpy(&x, p, sizeof(u32));
+	return x;
+}
+
+// a*b, low 64 bits in a and high 64 bits in b
+inline void _hash_multiply_128(u64 *a, u64 *b) {
+#if COMPILER_MSVC
+	u64 high;
+	*a = _umul128(*a, *b, &high);
+	*b = high;
+#elif COMPILER_GCC || COMPILER_CLANG
+	unsigned __int128 r = (unsigned __int128)*a * *b;
+	*a = (u64)r;
+	*b = (u64)(r >> 64);
+#else
+	u64 a_low = (u32)*a, a_high = *a >> 32, b_low = (u32)*b, b_high = *b >> 32;
+	u64 low_low = a_low*b_low, high_low = a_high*b_low, low_high = a_low*b_high, high_high = a_high*b_high;
+	u64 cross = (low_low >> 32) + (u32)high_low + low_high;
+	*a = (cross << 32) | (u32)low_low;
+	*b = high_high + (high_low >> 32) + (cross >> 32);
+#endif
+}
+inline u64 _hash_multiply_fold(u64 a, u64 b) {
+	_hash_multiply_128(&a, &b);
+	return a ^ b;
+}
+
+// wyhash
+u64 _hash_bytes_short(const u8 *p, u64 size, u64 seed) {
+	const u64 *secret = _wyhash_secret;
+
+	seed ^= _hash_multiply_fold(seed ^ secret[0], secret[1]);
+
+	u64 a, b;
+	if (size <= 16) {
+		if (size >= 4) {
+			// Two overlapping reads from each end
+			u64 middle = (size >> 3) << 2;
+			a = (_hash_read_32(p) << 32) | _hash_read_32(p + middle);
+			b = (_hash_read_32(p + size - 4) << 32) | _hash_read_32(p + size - 4 - middle);
+		} else if (size > 0) {
+			a = ((u64)p[0] << 16) | ((u64)p[size >> 1] << 8) | p[size - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		u64 i = size;
+		if (i > 48) {
+			u64 seed1 = seed, seed2 = seed;
+			do {
+				seed  = _hash_multiply_fold(_hash_read_64(p)      ^ secret[1], _hash_read_64(p + 8)  ^ seed);
+				seed1 = _hash_multiply_fold(_hash_read_64(p + 16) ^ secret[2], _hash_read_64(p + 24) ^ seed1);
+				seed2 = _hash_multiply_fold(_hash_read_64(p + 32) ^ secret[3], _hash_read_64(p + 40) ^ seed2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= seed1 ^ seed2;
+		}
+		while (i > 16) {
+			seed = _hash_multiply_fold(_hash_read_64(p) ^ secret[1], _hash_read_64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = _hash_read_64(p + i - 16);
+		b = _hash_read_64(p + i - 8);
+	}
+
+	a ^= secret[1];
+	b ^= seed;
+	_hash_multiply_128(&a, &b);
+	return _hash_multiply_fold(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+inline void _hash_init_accumulators(u64 *acc) {
+	acc[0] = PRIME32_3; acc[1] = PRIME64_1; acc[2] = PRIME64_2; acc[3] = PRIME64_3;
+	acc[4] = PRIME64_4; acc[5] = PRIME32_2; acc[6] = PRIME64_5; acc[7] = PRIME32_1;
+}
+
+// Accumulating a stripe, for each of the 8 lanes: acc[lane^1] += data, acc[lane] += low 32 bits
+// times high 32 bits of data^secret.
+// Scrambling mixes the high bits of the accumulators back into the low bits, which are all the
+// 32x32 bit multiplies see.
+// The SIMD versions work on 2 or 4 lanes per register and keep the accumulators in registers.
+#if SIMD_ENABLE_AVX2
+inline __m256i _hash_accumulate_256(__m256i acc, const u8 *p, const u8 *secret) {
+	__m256i data      = _mm256_loadu_si256((const __m256i*)p);
+	__m256i data_key  = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)secret));
+	__m256i key_high  = _mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+	__m256i product   = _mm256_mul_epu32(data_key, key_high);
+	__m256i data_swap = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+	return _mm256_add_epi64(product, _mm256_add_epi64(acc, data_swap));
+}
+inline __m256i _hash_scramble_256(__m256i acc, const u8 *secret) {
+	__m256i prime = _mm256_set1_epi32((int)PRIME32_1);
+	acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+	acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i*)secret));
+	__m256i product_low  = _mm256_mul_epu32(acc, prime);
+	__m256i product_high = _mm256_mul_epu32(_mm256_shuffle_epi32(acc, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+	return _mm256_add_epi64(product_low, _mm256_slli_epi64(product_high, 32));
+}
+#elif SIMD_ENABLE_SSE2
+inline __m128i _hash_accumulate_128(__m128i acc, const u8 *p, const u8 *secret) {
+	__m128i data      = _mm_loadu_si128((const __m128i*)p);
+	__m128i data_key  = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)secret));
+	__m128i key_high  = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+	__m128i product   = _mm_mul_epu32(data_key, key_high);
+	__m128i data_swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+	return _mm_add_epi64(product, _mm_add_epi64(acc, data_swap));
+}
+inline __m128i _hash_scramble_128(__m128i acc, const u8 *secret) {
+	__m128i prime = _mm_set1_epi32((int)PRIME32_1);
+	acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+	acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i*)secret));
+	__m128i product_low  = _mm_mul_epu32(acc, prime);
+	__m128i product_high = _mm_mul_epu32(_mm_shuffle_epi32(acc, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+	return _mm_add_epi64(product_low, _mm_slli_epi64(product_high, 32));
+}
+#endif
+
+// Accumulates stripes continuing from stripes_in_block, scrambling at the end of each block
+void _hash_accumulate_stripes(u64 *acc, u64 *stripes_in_block, const u8 *p, u64 stripe_count, const u8 *secret) {
+	const u8 *scramble_secret = secret + HASH_SECRET_SIZE - HASH_STRIPE_SIZE;
+	u64 stripe = *stripes_in_block;
+
+#if SIMD_ENABLE_AVX2
+	__m256i a0 = _mm256_loadu_si256((__m256i*)acc);
+	__m256i a1 = _mm256_loadu_si256((__m256i*)acc + 1);
+	for (u64 i = 0; i < stripe_count; i += 1) {
+		const u8 *s = secret + stripe*8;
+		a0 = _hash_accumulate_256(a0, p,      s);
+		a1 = _hash_accumulate_256(a1, p + 32, s + 32);
+		p += HASH_STRIPE_SIZE;
+		stripe += 1;
+		if (stripe == HASH_STRIPES_PER_BLOCK) {
+			a0 = _hash_scramble_256(a0, scramble_secret);
+			a1 = _hash_scramble_256(a1, scramble_secret + 32);
+			stripe = 0;
+		}
+	}
+	_mm256_storeu_si256((__m256i*)acc,     a0);
+	_mm256_storeu_si256((__m256i*)acc + 1, a1);
+#elif SIMD_ENABLE_SSE2
+	__m128i a0 = _mm_loadu_si128((__m128i*)acc);
+	__m128i a1 = _mm_loadu_si128((__m128i*)acc + 1);
+	__m128i a2 = _mm_loadu_si128((__m128i*)acc + 2);
+	__m128i a3 = _mm_loadu_si128((__m128i*)acc + 3);
+	for (u64 i = 0; i < stripe_count; i += 1) {
+		const u8 *s = secret + stripe*8;
+		a0 = _hash_accumulate_128(a0, p,      s);
+		a1 = _hash_accumulate_128(a1, p + 16, s + 16);
+		a2 = _hash_accumulate_128(a2, p + 32, s + 32);
+		a3 = _hash_accumulate_128(a3, p + 48, s + 48);
+		p += HASH_STRIPE_SIZE;
+		stripe += 1;
+		if (stripe == HASH_STRIPES_PER_BLOCK) {
+			a0 = _hash_scramble_128(a0, scramble_secret);
+			a1 = _hash_scramble_128(a1, scramble_secret + 16);
+			a2 = _hash_scramble_128(a2, scramble_secret + 32);
+			a3 = _hash_scramble_128(a3, scramble_secret + 48);
+			stripe = 0;
+		}
+	}
+	_mm_storeu_si128((__m128i*)acc,     a0);
+	_mm_storeu_si128((__m128i*)acc + 1, a1);
+	_mm_storeu_si128((__m128i*)acc + 2, a2);
+	_mm_storeu_si128((__m128i*)acc + 3, a3);
+#else
+	for (u64 i = 0; i < stripe_count; i += 1) {
+		const u8 *s = secret + stripe*8;
+		for (u64 lane = 0; lane < 8; lane += 1) {
+			u64 data = _hash_read_64(p + lane*8);
+			u64 data_key = data ^ _hash_read_64(s + lane*8);
+			acc[lane ^ 1] += data;
+			acc[lane] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+		}
+		p += HASH_STRIPE_SIZE;
+		stripe += 1;
+		if (stripe == HASH_STRIPES_PER_BLOCK) {
+			for (u64 lane = 0; lane < 8; lane += 1) {
+				u64 a = acc[lane];
+				a ^= a >> 47;
+				a ^= _hash_read_64(scramble_secret + lane*8);
+				acc[lane] = a * PRIME32_1;
+			}
+			stripe = 0;
+		}
+	}
+#endif
+
+	*stripes_in_block = stripe;
+}
+
+// last_stripe is the last 64 bytes of input, which always get accumulated on their own
+u64 _hash_finish_long(u64 *acc, const u8 *last_stripe, u64 size, const u8 *secret) {
+	const u8 *last_secret = secret + HASH_SECRET_SIZE - HASH_STRIPE_SIZE - 7;
+	for (u64 lane = 0; lane < 8; lane += 1) {
+		u64 data = _hash_read_64(last_stripe + lane*8);
+		u64 data_key = data ^ _hash_read_64(last_secret + lane*8);
+		acc[lane ^ 1] += data;
+		acc[lane] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+	}
+
+	u64 h = size * PRIME64_1;
+	for (u64 i = 0; i < 4; i += 1) {
+		h += _hash_multiply_fold(acc[i*2] ^ _hash_read_64(secret + 11 + i*16), acc[i*2+1] ^ _hash_read_64(secret + 11 + i*16 + 8));
+	}
+
+	h ^= h >> 37;
+	h *= 0x165667919E3779F9ull;
+	h ^= h >> 32;
+	return h;
+}
+
+u64 _hash_bytes_long(const u8 *p, u64 size, const u8 *secret) {
+	u64 acc[8];
+	_hash_init_accumulators(acc);
+
+	// Every stripe except the one with the last byte
+	u64 stripes_in_block = 0;
+	_hash_accumulate_stripes(acc, &stripes_in_block, p, (size-1)/HASH_STRIPE_SIZE, secret);
+
+	return _hash_finish_long(acc, p + size - HASH_STRIPE_SIZE, size, secret);
+}
+
+void _hash_derive_secret(u8 *secret, u64 seed) {
+	for (u64 i = 0; i < HASH_SECRET_SIZE; i += 16) {
+		u64 low  = _hash_read_64(_hash_secret + i) + seed;
+		u64 high = _hash_read_64(_hash_secret + i + 8) - seed;
+		memcpy(secret + i, &low, sizeof(u64));
+		memcpy(secret + i + 8, &high, sizeof(u64));
+	}
+}
+
+u64 hash_bytes_seeded(const void *data, u64 size, u64 seed) {
+	if (size <= HASH_LONG_INPUT_SIZE) return _hash_bytes_short((const u8*)data, size, seed);
+
+	if (seed == 0) return _hash_bytes_long((const u8*)data, size, _hash_secret);
+
+	u8 secret[HASH_SECRET_SIZE];
+	_hash_derive_secret(secret, seed);
+	return _hash_bytes_long((const u8*)data, size, secret);
+}
+inline u64 hash_bytes(const void *data, u64 size) {
+	return hash_bytes_seeded(data, size, 0);
+}
+
+void hash_stream_init(Hash_Stream *stream, u64 seed) {
+	memset(stream, 0, sizeof(Hash_Stream));
+	stream->seed = seed;
+	_hash_init_accumulators(stream->acc);
+	if (seed == 0) memcpy(stream->secret, _hash_secret, HASH_SECRET_SIZE);
+	else           _hash_derive_secret(stream->secret, seed);
+}
+
+void hash_stream_update(Hash_Stream *stream, const void *data, u64 size) {
+	const u8 *p = (const u8*)data;
+	u8 *buffered = stream->buffer + HASH_STRIPE_SIZE;
+
+	stream->total_size += size;
+
+	if (stream->buffered_size + size <= HASH_LONG_INPUT_SIZE) {
+		memcpy(buffered + stream->buffered_size, p, size);
+		stream->buffered_size += size;
+		return;
+	}
+
+	// There's more input after the buffer, so none of the stripes we accumulate here is the last one
+	const u8 *previous_stripe = 0;
+	if (stream->buffered_size > 0) {
+		u64 fill = HASH_LONG_INPUT_SIZE - stream->buffered_size;
+		memcpy(buffered + stream->buffered_size, p, fill);
+		p += fill;
+		size -= fill;
+
+		_hash_accumulate_stripes(stream->acc, &stream->stripes_in_block, buffered, HASH_LONG_INPUT_SIZE/HASH_STRIPE_SIZE, stream->secret);
+		previous_stripe = buffered + HASH_LONG_INPUT_SIZE - HASH_STRIPE_SIZE;
+	}
+	while (size > HASH_LONG_INPUT_SIZE) {
+		_hash_accumulate_stripes(stream->acc, &stream->stripes_in_block, p, HASH_LONG_INPUT_SIZE/HASH_STRIPE_SIZE, stream->secret);
+		p += HASH_LONG_INPUT_SIZE;
+		size -= HASH_LONG_INPUT_SIZE;
+		previous_stripe = p - HASH_STRIPE_SIZE;
+	}
+
+	memcpy(stream->buffer, previous_stripe, HASH_STRIPE_SIZE);
+	memcpy(buffered, p, size);
+	stream->buffered_size = size;
+}
+
+// Doesn't change the stream, so you can keep adding to it after
+u64 hash_stream_finish(Hash_Stream *stream) {
+	u8 *buffered = stream->buffer + HASH_STRIPE_SIZE;
+
+	if (stream->total_size <= HASH_LONG_INPUT_SIZE) {
+		return _hash_bytes_short(buffered, stream->total_size, stream->seed);
+	}
+
+	u64 acc[8];
+	memcpy(acc, stream->acc, sizeof(acc));
+	u64 stripes_in_block = stream->stripes_in_block;
+
+	_hash_accumulate_stripes(acc, &stripes_in_block, buffered, (stream->buffered_size-1)/HASH_STRIPE_SIZE, stream->secret);
+
+	return _hash_finish_long(acc, buffered + stream->buffered_size - HASH_STRIPE_SIZE, stream->total_size, stream->secret);
+}
+
 u64 string_get_hash(string s) {
-    if (s.count > 32) return djb2_hash(s);
-    return city_hash(s);
+	return hash_bytes(s.data, s.count);
+}
+u64 string_get_hash_seeded(string s, u64 seed) {
+	return hash_bytes_seeded(s.data, s.count, seed);
 }
 u64 pointer_get_hash(void *p) {
 	return xx_hash((u64)p);
@@ -1,6 +1,12 @@
 
-// Very naive implementation but it should be very cache efficient so it's alright
-// for non-excessive use for now.
+// Open addressing hash table.
+// Entries (hash + key + value) are kept densely packed in the order they were added, so they can
+// be iterated with hash_table_get_nth_key() and hash_table_get_nth_value(). Lookups go through a
+// separate index of slots with one control byte each, which holds 7 bits of the hash or marks the
+// slot as empty or deleted. Slots are probed 16 at a time (one SSE2 compare) in groups with
+// triangular probing, and the index is grown to keep it at most 7/8 full.
+// Removing swaps the last entry into the removed one's place, so entries stay densely packed.
+// When the hash matches we compare the keys too, so keys with colliding hashes are still told apart.
 
 /*
 
@@ -30,20 +36,81 @@
 		
 	}
 	
-	// Reset all entries (but keep allocated memory)
-	hash_table_reset(&table);
+	// Remove an entry. Returns whether or not the key existed.
+	// This moves the last entry into the removed entry's place, so it changes the order of
+	// hash_table_get_nth_value() and invalidates pointers to the last value.
+	bool removed = hash_table_remove(&table, key);
+	
+	// Remove all entries (but keep allocated memory)
+	hash_table_clear(&table);
+	
+	// Free memory that's not needed for the current entries, f.ex. after a lot of removes
+	hash_table_shrink_to_fit(&table);
 	
 	// Free allocated entries in hash table
 	hash_table_destroy(&table);
 	
 	
+	Keys:
+		Keys are stored in the table and compared with memcmp, except for string keys which are
+		copied into memory owned by the table and compared with strings_match(). So it's fine to
+		look things up with, or add, a string from temporary storage.
+		
+		For other key equality, f.ex. struct keys with padding, set table.key_equals:
+		
+			bool my_key_equals(void *a, void *b, u64 key_size) { ... }
+			
+			Hash_Table table = make_hash_table(My_Key, int, get_heap_allocator());
+			table.key_equals = my_key_equals;
+			
+		Keys that are equal must have the same hash.
+		
+		If you'd rather save the memory of storing keys, and accept that two keys with the same
+		64 bit hash will be treated as the same key, you can opt out of storing keys:
+		
+			Hash_Table table = make_hash_table_hash_only(string, int, get_heap_allocator());
+			
+	
+	Typed maps:
+		Hash_Table handles any key and value size at runtime, which means a memcpy and a call
+		through key_equals per entry. When a map is hot, you can generate one for specific types
+		instead, with the same index and behaviour but fixed size entries that the compiler can
+		inline everything for:
+		
+			//              Name        Key     Value    Hash procedure   Equals procedure
+			DEFINE_HASH_MAP(Entity_Map, u64,    Entity*, get_hash,        hash_map_equals);
+			DEFINE_HASH_MAP(Sprite_Map, string, Sprite,  string_get_hash, strings_match);
+			
+			Entity_Map map;
+			Entity_Map_init(&map, get_heap_allocator());
+			
+			bool newly_added = Entity_Map_set(&map, id, entity);
+			Entity **e = Entity_Map_find(&map, id); // Null if id doesn't exist
+			bool exists = Entity_Map_contains(&map, id);
+			bool removed = Entity_Map_remove(&map, id);
+			Entity_Map_add(&map, id, entity); // Doesn't check if id exists
+			
+			for (u64 i = 0; i < map.count; i += 1) {
+				Entity_Map_Entry entry = map.entries[i];
+				...
+			}
+			
+			Entity_Map_clear(&map);
+			Entity_Map_shrink_to_fit(&map);
+			Entity_Map_destroy(&map);
+			
+		Unlike Hash_Table, keys are stored as they are, so string keys are NOT copied and need
+		to outlive the map. Key and value don't need to be lvalues.
+	
 	Limitations:
-		- Key can only be a base type or pointer
+		- Key can only be a base type, pointer, string or a struct without padding (unless you
+		  set key_equals)
 		- Key and value passed to the following function needs to be lvalues (we need to be able to take their addresses with '&'):
 			- hash_table_add
 			- hash_table_find
 			- hash_table_contains
 			- hash_table_set
+			- hash_table_remove
 			
 			Example:
 			
@@ -58,69 +125,443 @@
 
 typedef struct Hash_Table Hash_Table;
 
+typedef bool(*Hash_Table_Key_Equals_Proc)(void *a, void *b, u64 key_size);
+
+typedef enum Hash_Table_Key_Mode {
+	HASH_TABLE_KEY_BYTES,     // Key is stored and compared with key_equals (memcmp by default)
+	HASH_TABLE_KEY_STRING,    // Key is a string, its data is copied into the table
+	HASH_TABLE_KEY_HASH_ONLY, // Key isn't stored, entries only match on the 64 bit hash
+} Hash_Table_Key_Mode;
+
+#define _hash_table_key_mode(Key_Type) \
+	_Generic((Key_Type){0}, string: HASH_TABLE_KEY_STRING, default: HASH_TABLE_KEY_BYTES)
+
 // API:
 #define make_hash_table_reserve(Key_Type, Value_Type, capacity_count, allocator) \
-	make_hash_table_reserve(sizeof(Key_Type), sizeof(Value_Type), capacity_count, allocator)
+	make_hash_table_reserve_raw(sizeof(Key_Type), sizeof(Value_Type), _hash_table_key_mode(Key_Type), capacity_count, allocator)
 	
 #define make_hash_table(Key_Type, Value_Type, allocator) \
-	make_hash_table_raw(sizeof(Key_Type), sizeof(Value_Type), allocator)
+	make_hash_table_raw(sizeof(Key_Type), sizeof(Value_Type), _hash_table_key_mode(Key_Type), allocator)
+	
+#define make_hash_table_hash_only(Key_Type, Value_Type, allocator) \
+	make_hash_table_raw(sizeof(Key_Type), sizeof(Value_Type), HASH_TABLE_KEY_HASH_ONLY, allocator)
 
 #define hash_table_add(table_ptr, key, value) \
 	hash_table_add_raw((table_ptr), get_hash(key), &(key), &(value), sizeof(key), sizeof(value))
 
 #define hash_table_find(table_ptr, key) \
-	hash_table_find_raw((table_ptr), get_hash(key))
+	hash_table_find_raw((table_ptr), get_hash(key), &(key), sizeof(key))
 	
 #define hash_table_contains(table_ptr, key) \
-	hash_table_contains_raw((table_ptr), get_hash(key))
+	hash_table_contains_raw((table_ptr), get_hash(key), &(key), sizeof(key))
 	
 #define hash_table_set(table_ptr, key, value) \
 	hash_table_set_raw((table_ptr), get_hash(key), &key, &value, sizeof(key), sizeof(value))
+	
+#define hash_table_remove(table_ptr, key) \
+	hash_table_remove_raw((table_ptr), get_hash(key), &(key), sizeof(key))
 
 void hash_table_reserve(Hash_Table *t, u64 required_count);
 
+#define HASH_TABLE_GROUP_SIZE 16
+#define HASH_TABLE_CONTROL_EMPTY 0x80
+#define HASH_TABLE_CONTROL_DELETED 0xFE
+#define HASH_TABLE_KEY_BLOCK_SIZE 16384
+
+// The lookup index, shared by Hash_Table and the maps made with DEFINE_HASH_MAP.
+// It maps hashes to indices into a densely packed array of entries, which must all start with
+// the u64 hash. control and slots live in the same allocation.
+typedef struct Hash_Table_Index {
+	u8  *control; // HASH_TABLE_CONTROL_EMPTY, HASH_TABLE_CONTROL_DELETED or the top 7 bits of the hash, per slot
+	u32 *slots;   // Entry index, per slot
+	u64 slot_count; // Power of two, at least HASH_TABLE_GROUP_SIZE
+	u64 deleted_count; // Number of HASH_TABLE_CONTROL_DELETED slots
+} Hash_Table_Index;
 
 typedef struct Hash_Table {
 	
-	// Each entry is hash-key-value
-	// Hash is sizeof(u64) bytes, key is _key_size bytes and value is _value_size bytes
+	// Each entry is hash-key-value, each part aligned to 8 bytes
+	// Key is not stored if _key_mode is HASH_TABLE_KEY_HASH_ONLY
 	void *entries; 
 	
 	u64 count; // Number of valid entries
 	u64 capacity_count; // Number of allocated entries
 	
+	Hash_Table_Key_Equals_Proc key_equals; // Null if _key_mode is HASH_TABLE_KEY_HASH_ONLY
+	
 	u64 _key_size;
 	u64 _value_size;
+	Hash_Table_Key_Mode _key_mode;
+	
+	u64 _entry_size;
+	u64 _key_offset;
+	u64 _value_offset;
+	
+	Hash_Table_Index _index;
+	
+	// Storage for copies of string keys. Blocks don't move, so the stored strings can point
+	// into them. Removed keys leave holes which are compacted when they take up more space
+	// than the live keys.
+	struct Hash_Table_Key_Block *_key_blocks;
+	u64 _key_bytes_live;
+	u64 _key_bytes_dead;
 	
 	Allocator allocator;
 } Hash_Table;
 
-Hash_Table make_hash_table_reserve_raw(u64 key_size, u64 value_size, u64 capacity_count, Allocator allocator) {
+typedef struct Hash_Table_Key_Block {
+	struct Hash_Table_Key_Block *next;
+	u64 used;
+	u64 size;
+	// Data follows
+} Hash_Table_Key_Block;
+
+bool hash_table_key_equals_bytes(void *a, void *b, u64 key_size) {
+	return memcmp(a, b, key_size) == 0;
+}
+bool hash_table_key_equals_string(void *a, void *b, u64 key_size) {
+	return strings_match(*(string*)a, *(string*)b);
+}
+
+///
+// Index
+
+// Bit i is set if group[i] == byte
+inline u32 
+_hash_table_match_group(u8 *group, u8 byte) {
+#if SIMD_ENABLE_SSE2
+	__m128i g = _mm_loadu_si128((__m128i*)group);
+	return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)byte)));
+#else
+	u32 mask = 0;
+	for (u32 i = 0; i < HASH_TABLE_GROUP_SIZE; i += 1) {
+		if (group[i] == byte) mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+// Bit i is set if group[i] is empty or deleted, which are the only control bytes with the high bit set
+inline u32 
+_hash_table_match_group_free(u8 *group) {
+#if SIMD_ENABLE_SSE2
+	return (u32)_mm_movemask_epi8(_mm_loadu_si128((__m128i*)group));
+#else
+	u32 mask = 0;
+	for (u32 i = 0; i < HASH_TABLE_GROUP_SIZE; i += 1) {
+		if (group[i] & 0x80) mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+inline u8 
+_hash_table_control_byte(u64 hash) {
+	return (u8)(hash >> 57);
+}
+
+// Smallest slot count which keeps count entries at or below 7/8 load
+u64 _hash_table_slot_count_for(u64 count) {
+	u64 slot_count = get_next_power_of_two(count + count/7 + 1);
+	return max(slot_count, HASH_TABLE_GROUP_SIZE);
+}
+
+// First empty or deleted slot
+u64 _hash_table_index_find_free_slot(Hash_Table_Index *index, u64 hash) {
+	u64 group_mask = index->slot_count/HASH_TABLE_GROUP_SIZE - 1;
+	u64 group = hash & group_mask;
+	
+	for (u64 step = 1; ; step += 1) {
+		u32 free_mask = _hash_table_match_group_free(index->control + group*HASH_TABLE_GROUP_SIZE);
+		if (free_mask) return group*HASH_TABLE_GROUP_SIZE + count_trailing_zeros_32(free_mask);
+		
+		// Triangular numbers visit every group when the group count is a power of two
+		group = (group + step) & group_mask;
+	}
+}
+
+void _hash_table_index_insert(Hash_Table_Index *index, u64 hash, u64 entry_index) {
+	u64 slot = _hash_table_index_find_free_slot(index, hash);
+	if (index->control[slot] == HASH_TABLE_CONTROL_DELETED) index->deleted_count -= 1;
+	index->control[slot] = _hash_table_control_byte(hash);
+	index->slots[slot] = (u32)entry_index;
+}
+
+// Slot pointing to entry_index, -1 if there is none
+s64 _hash_table_index_find_entry_slot(Hash_Table_Index *index, u64 hash, u64 entry_index) {
+	u8 control = _hash_table_control_byte(hash);
+	
+	u64 group_mask = index->slot_count/HASH_TABLE_GROUP_SIZE - 1;
+	u64 group = hash & group_mask;
+	
+	for (u64 step = 1; ; step += 1) {
+		u8 *group_control = index->control + group*HASH_TABLE_GROUP_SIZE;
+		
+		u32 match = _hash_table_match_group(group_control, control);
+		while (match) {
+			u64 slot = group*HASH_TABLE_GROUP_SIZE + count_trailing_zeros_32(match);
+			if (index->slots[slot] == entry_index) return (s64)slot;
+			match &= match-1;
+		}
+		
+		if (_hash_table_match_group(group_control, HASH_TABLE_CONTROL_EMPTY)) return -1;
+		
+		group = (group + step) & group_mask;
+	}
+}
+
+void _hash_table_index_rehash(Hash_Table_Index *index, u64 slot_count, void *entries, u64 entry_size, u64 count, Allocator allocator) {
+	if (index->control) dealloc(allocator, index->control);
+	
+	u8 *memory = alloc(allocator, slot_count + slot_count*sizeof(u32));
+	
+	index->control = memory;
+	index->slots = (u32*)(memory + slot_count);
+	index->slot_count = slot_count;
+	index->deleted_count = 0;
+	
+	memset(index->control, HASH_TABLE_CONTROL_EMPTY, slot_count);
+	
+	for (u64 i = 0; i < count; i += 1) {
+		u64 hash = *(u64*)((u8*)entries + i*entry_size);
+		_hash_table_index_insert(index, hash, i);
+	}
+}
+
+void _hash_table_index_reserve(Hash_Table_Index *index, u64 required_count, void *entries, u64 entry_size, u64 count, Allocator allocator) {
+	// Rehash when the index would go past 7/8 load, counting deleted slots.
+	// If it's mostly deleted slots we can rehash at the same size, but if that would leave the
+	// index more than half full we grow anyway so we don't end up rehashing all the time.
+	u64 max_load = index->slot_count - index->slot_count/8;
+	if (required_count + index->deleted_count >= max_load) {
+		u64 slot_count = _hash_table_slot_count_for(required_count);
+		if (slot_count == index->slot_count && required_count > max_load/2) slot_count *= 2;
+		_hash_table_index_rehash(index, slot_count, entries, entry_size, count, allocator);
+	}
+}
+
+// Removes the entry at slot, by moving the last entry to its place.
+void _hash_table_index_remove(Hash_Table_Index *index, u64 slot, void *entries, u64 entry_size, u64 count) {
+	u64 entry_index = index->slots[slot];
+	
+	// A group which still has an empty slot has never been full, so no probe sequence goes
+	// past it and we can mark the slot empty. Otherwise it has to be marked deleted so lookups
+	// keep probing past it.
+	u8 *group_control = index->control + (slot/HASH_TABLE_GROUP_SIZE)*HASH_TABLE_GROUP_SIZE;
+	if (_hash_table_match_group(group_control, HASH_TABLE_CONTROL_EMPTY)) {
+		index->control[slot] = HASH_TABLE_CONTROL_EMPTY;
+	} else {
+		index->control[slot] = HASH_TABLE_CONTROL_DELETED;
+		index->deleted_count += 1;
+	}
+	
+	// Move the last entry into the hole
+	u64 last_index = count-1;
+	if (entry_index != last_index) {
+		u8 *entry = (u8*)entries + entry_index*entry_size;
+		u8 *last_entry = (u8*)entries + last_index*entry_size;
+		
+		s64 last_slot = _hash_table_index_find_entry_slot(index, *(u64*)last_entry, last_index);
+		assert(last_slot >= 0, "Internal hash table error, last entry is missing from the index");
+		index->slots[last_slot] = (u32)entry_index;
+		
+		memcpy(entry, last_entry, entry_size);
+	}
+}
+
+void _hash_table_index_clear(Hash_Table_Index *index) {
+	index->deleted_count = 0;
+	if (index->control) memset(index->control, HASH_TABLE_CONTROL_EMPTY, index->slot_count);
+}
+
+void _hash_table_index_destroy(Hash_Table_Index *index, Allocator allocator) {
+	if (index->control) dealloc(allocator, index->control);
+	*index = ZERO(Hash_Table_Index);
+}
+
+// Grows entries to hold at least required_count entries, in powers of two
+void _hash_table_reserve_entries(void **entries, u64 *capacity_count, u64 entry_size, u64 required_count, Allocator allocator) {
+	assert(required_count <= UINT32_MAX, "Hash table can't hold more than %u entries", UINT32_MAX);
+
+	if (*capacity_count >= required_count) return;
+	
+	u64 new_count = get_next_power_of_two(required_count);
+	
+	void *new_entries = alloc(allocator, new_count*entry_size);
+	if (*entries) {
+		memcpy(new_entries, *entries, *capacity_count*entry_size);
+		dealloc(allocator, *entries);
+	}
+	
+	*entries = new_entries;
+	*capacity_count = new_count;
+}
+
+// Shrinks entries and the index to what count entries need
+void _hash_table_shrink_to_fit(Hash_Table_Index *index, void **entries, u64 *capacity_count, u64 entry_size, u64 count, Allocator allocator) {
+	u64 new_count = get_next_power_of_two(max(count, 8));
+	
+	if (new_count < *capacity_count) {
+		void *new_entries = alloc(allocator, new_count*entry_size);
+		memcpy(new_entries, *entries, count*entry_size);
+		dealloc(allocator, *entries);
+		
+		*entries = new_entries;
+		*capacity_count = new_count;
+	}
+	
+	u64 slot_count = _hash_table_slot_count_for(max(count, 8));
+	if (slot_count < index->slot_count || index->deleted_count > 0) {
+		_hash_table_index_rehash(index, slot_count, *entries, entry_size, count, allocator);
+	}
+}
+
+///
+// Hash_Table
 
-	capacity_count = min(capacity_count, 8);
+inline u8 *
+_hash_table_get_entry(Hash_Table *t, u64 index) {
+	return (u8*)t->entries + index*t->_entry_size;
+}
+
+// Slot of the entry with the given key, -1 if there is none
+s64 _hash_table_find_slot(Hash_Table *t, u64 hash, void *k) {
+
+	if (t->count == 0) return -1;
+	
+	Hash_Table_Index *index = &t->_index;
+	
+	u8 control = _hash_table_control_byte(hash);
+	
+	u64 group_mask = index->slot_count/HASH_TABLE_GROUP_SIZE - 1;
+	u64 group = hash & group_mask;
+	
+	for (u64 step = 1; ; step += 1) {
+		u8 *group_control = index->control + group*HASH_TABLE_GROUP_SIZE;
+		
+		u32 match = _hash_table_match_group(group_control, control);
+		while (match) {
+			u64 slot = group*HASH_TABLE_GROUP_SIZE + count_trailing_zeros_32(match);
+			u8 *entry = _hash_table_get_entry(t, index->slots[slot]);
+			
+			if (*(u64*)entry == hash) {
+				if (!t->key_equals || t->key_equals(entry+t->_key_offset, k, t->_key_size)) {
+					return (s64)slot;
+				}
+			}
+			
+			match &= match-1;
+		}
+		
+		// An empty slot means the probe sequence ends here
+		if (_hash_table_match_group(group_control, HASH_TABLE_CONTROL_EMPTY)) return -1;
+		
+		group = (group + step) & group_mask;
+	}
+}
+
+void _hash_table_free_key_blocks(Hash_Table_Key_Block *block, Allocator allocator) {
+	while (block) {
+		Hash_Table_Key_Block *next = block->next;
+		dealloc(allocator, block);
+		block = next;
+	}
+}
+
+// Copies string key into the key blocks
+string _hash_table_store_key(Hash_Table *t, string key) {
+	if (key.count == 0) return ZERO(string);
+	
+	Hash_Table_Key_Block *block = t->_key_blocks;
+	if (!block || block->used + key.count > block->size) {
+		u64 size = max(key.count, HASH_TABLE_KEY_BLOCK_SIZE);
+		block = alloc(t->allocator, sizeof(Hash_Table_Key_Block) + size);
+		block->next = t->_key_blocks;
+		block->used = 0;
+		block->size = size;
+		t->_key_blocks = block;
+	}
+	
+	string stored;
+	stored.data = (u8*)(block+1) + block->used;
+	stored.count = key.count;
+	memcpy(stored.data, key.data, key.count);
+	
+	block->used += key.count;
+	t->_key_bytes_live += key.count;
+	
+	return stored;
+}
+
+// Copies all live keys into new blocks and frees the old ones
+void _hash_table_compact_keys(Hash_Table *t) {
+	Hash_Table_Key_Block *old_blocks = t->_key_blocks;
+	
+	t->_key_blocks = 0;
+	t->_key_bytes_live = 0;
+	t->_key_bytes_dead = 0;
+	
+	for (u64 i = 0; i < t->count; i += 1) {
+		string *key = (string*)(_hash_table_get_entry(t, i) + t->_key_offset);
+		*key = _hash_table_store_key(t, *key);
+	}
+	
+	_hash_table_free_key_blocks(old_blocks, t->allocator);
+}
+
+Hash_Table make_hash_table_reserve_raw(u64 key_size, u64 value_size, Hash_Table_Key_Mode key_mode, u64 capacity_count, Allocator allocator) {
+
+	capacity_count = max(capacity_count, 8);
 
 	Hash_Table t = ZERO(Hash_Table);
 	
 	t._key_size = key_size;
 	t._value_size = value_size;
+	t._key_mode = key_mode;
 	t.allocator = allocator;
 	
-	u64 entry_size = value_size+sizeof(u64);
-	t.entries = alloc(t.allocator, entry_size*capacity_count);
-	memset(t.entries, 0, entry_size*capacity_count);
-	t.capacity_count = capacity_count;
+	u64 stored_key_size = key_mode == HASH_TABLE_KEY_HASH_ONLY ? 0 : key_size;
+	
+	t._key_offset   = sizeof(u64);
+	t._value_offset = t._key_offset + align_next(stored_key_size, 8);
+	t._entry_size   = t._value_offset + align_next(value_size, 8);
+	
+	switch (key_mode) {
+		case HASH_TABLE_KEY_BYTES:     t.key_equals = hash_table_key_equals_bytes;  break;
+		case HASH_TABLE_KEY_STRING:    t.key_equals = hash_table_key_equals_string; break;
+		case HASH_TABLE_KEY_HASH_ONLY: t.key_equals = 0;                            break;
+	}
+	
+	if (key_mode == HASH_TABLE_KEY_STRING) {
+		assert(key_size == sizeof(string), "HASH_TABLE_KEY_STRING needs string keys");
+	}
+	
+	hash_table_reserve(&t, capacity_count);
 	
 	return t;
 }
-inline Hash_Table make_hash_table_raw(u64 key_size, u64 value_size, Allocator allocator) {
-	return make_hash_table_reserve_raw(key_size, value_size, 128, allocator);
+inline Hash_Table make_hash_table_raw(u64 key_size, u64 value_size, Hash_Table_Key_Mode key_mode, Allocator allocator) {
+	return make_hash_table_reserve_raw(key_size, value_size, key_mode, 128, allocator);
 }
 
-void hash_table_reset(Hash_Table *t) {
+void hash_table_clear(Hash_Table *t) {
+	_hash_table_free_key_blocks(t->_key_blocks, t->allocator);
+	t->_key_blocks = 0;
+	t->_key_bytes_live = 0;
+	t->_key_bytes_dead = 0;
 	t->count = 0;
+	_hash_table_index_clear(&t->_index);
+}
+inline void hash_table_reset(Hash_Table *t) {
+	hash_table_clear(t);
 }
 void hash_table_destroy(Hash_Table *t) {
+	_hash_table_free_key_blocks(t->_key_blocks, t->allocator);
+	t->_key_blocks = 0;
+	t->_key_bytes_live = 0;
+	t->_key_bytes_dead = 0;
+	
 	dealloc(t->allocator, t->entries);
+	_hash_table_index_destroy(&t->_index, t->allocator);
 	
 	t->entries = 0;
 	t->count = 0;
@@ -128,27 +569,16 @@ void hash_table_destroy(Hash_Table *t) {
 }
 
 void hash_table_reserve(Hash_Table *t, u64 required_count) {
-	u64 entry_size = t->_value_size+sizeof(u64);
-	
-	u64 required_size = required_count*entry_size;
-	
-	u64 current_size = t->capacity_count*entry_size;
-	
-	if (current_size >= required_size) return;
-	
-	u64 new_count = get_next_power_of_two(required_count);
-	u64 new_size = new_count*entry_size;
-	
-	void *new_entries = alloc(t->allocator, new_size);
-	memcpy(new_entries, t->entries, current_size);
-	
-	dealloc(t->allocator, t->entries);
-	
-	t->entries = new_entries;
-	t->capacity_count = new_count;
+	_hash_table_reserve_entries(&t->entries, &t->capacity_count, t->_entry_size, required_count, t->allocator);
+	_hash_table_index_reserve(&t->_index, required_count, t->entries, t->_entry_size, t->count, t->allocator);
 }
 
-// This can add multiple entries of same hash, beware!
+void hash_table_shrink_to_fit(Hash_Table *t) {
+	if (t->_key_bytes_dead > 0) _hash_table_compact_keys(t);
+	_hash_table_shrink_to_fit(&t->_index, &t->entries, &t->capacity_count, t->_entry_size, t->count, t->allocator);
+}
+
+// This can add multiple entries of same key, beware!
 void hash_table_add_raw(Hash_Table *t, u64 hash, void *k, void *v, u64 key_size, u64 value_size) {
 
 	assert(t->_key_size == key_size, "Key type size does not match hash table initted key type size");
@@ -156,63 +586,203 @@ void hash_table_add_raw(Hash_Table *t, u64 hash, void *k, void *v, u64 key_size,
 
 	hash_table_reserve(t, t->count+1);
 	
-	u64 entry_size = t->_value_size+sizeof(u64);
+	u8 *entry = _hash_table_get_entry(t, t->count);
 	
-	u64 index = entry_size*t->count;
-	t->count += 1;
+	memcpy(entry, &hash, sizeof(u64));
+	memcpy(entry+t->_value_offset, v, value_size);
 	
-	u64 hash_offset = 0;
-	u64 value_offset = hash_offset + sizeof(u64);
+	switch (t->_key_mode) {
+		case HASH_TABLE_KEY_BYTES: {
+			memcpy(entry+t->_key_offset, k, key_size);
+			break;
+		}
+		case HASH_TABLE_KEY_STRING: {
+			string stored = _hash_table_store_key(t, *(string*)k);
+			memcpy(entry+t->_key_offset, &stored, sizeof(string));
+			break;
+		}
+		case HASH_TABLE_KEY_HASH_ONLY: break;
+	}
 	
-	memcpy((u8*)t->entries+index+hash_offset,  &hash, sizeof(u64));
-	memcpy((u8*)t->entries+index+value_offset, v,     value_size);
+	_hash_table_index_insert(&t->_index, hash, t->count);
+	
+	t->count += 1;
 }
 
-void *hash_table_find_raw(Hash_Table *t, u64 hash) {
+void *hash_table_find_raw(Hash_Table *t, u64 hash, void *k, u64 key_size) {
 
-	// #Speed #Incomplete
-	// Do quadratic probe 'triangular numbers'
+	if (t->count == 0) return 0;
+	
+	assert(t->_key_size == key_size, "Key type size does not match hash table initted key type size");
+	
+	s64 slot = _hash_table_find_slot(t, hash, k);
+	if (slot < 0) return 0;
+	
+	return _hash_table_get_entry(t, t->_index.slots[slot])+t->_value_offset;
+}
 
-	u64 entry_size = t->_value_size+sizeof(u64);
-	u64 hash_offset = 0;
-	u64 value_offset = hash_offset + sizeof(u64);
+// Returns true if key existed
+bool hash_table_remove_raw(Hash_Table *t, u64 hash, void *k, u64 key_size) {
 	
-	for (u64 i = 0; i < t->count; i += 1) {
-		u64 existing_hash = *(u64*)((u8*)t->entries+i*entry_size+hash_offset);
-		if (existing_hash == hash) {
-			void *value = ((u8*)t->entries+i*entry_size+value_offset);
-			return value;
-		}
+	if (t->count == 0) return false;
+	
+	assert(t->_key_size == key_size, "Key type size does not match hash table initted key type size");
+	
+	s64 slot = _hash_table_find_slot(t, hash, k);
+	if (slot < 0) return false;
+	
+	if (t->_key_mode == HASH_TABLE_KEY_STRING) {
+		u8 *entry = _hash_table_get_entry(t, t->_index.slots[slot]);
+		string *key = (string*)(entry+t->_key_offset);
+		t->_key_bytes_live -= key->count;
+		t->_key_bytes_dead += key->count;
 	}
-	return 0;
+	
+	_hash_table_index_remove(&t->_index, (u64)slot, t->entries, t->_entry_size, t->count);
+	
+	t->count -= 1;
+	
+	if (t->_key_bytes_dead > t->_key_bytes_live && t->_key_bytes_dead > HASH_TABLE_KEY_BLOCK_SIZE) {
+		_hash_table_compact_keys(t);
+	}
+	
+	return true;
 }
 
-void *hash_table_get_nth_value(Hash_Table *t, u64 n) {
+// Null if the table is hash only
+void *hash_table_get_nth_key(Hash_Table *t, u64 n) {
 	assert(n < t->count, "Hash table n is out of range");
 	
-	u64 entry_size = t->_value_size+sizeof(u64);
-	u64 hash_offset = 0;
-	u64 value_offset = hash_offset + sizeof(u64);
+	if (t->_key_mode == HASH_TABLE_KEY_HASH_ONLY) return 0;
 	
-	return (u8*)t->entries+entry_size*n+value_offset;
+	return _hash_table_get_entry(t, n)+t->_key_offset;
 }
 
-bool hash_table_contains_raw(Hash_Table *t, u64 hash) {
-	return hash_table_find_raw(t, hash) != 0;
+void *hash_table_get_nth_value(Hash_Table *t, u64 n) {
+	assert(n < t->count, "Hash table n is out of range");
+	
+	return _hash_table_get_entry(t, n)+t->_value_offset;
+}
+
+bool hash_table_contains_raw(Hash_Table *t, u64 hash, void *k, u64 key_size) {
+	return hash_table_find_raw(t, hash, k, key_size) != 0;
 }
 
 // Returns true if key was newly added or false if it already existed
 bool hash_table_set_raw(Hash_Table *t, u64 hash, void *k, void *v, u64 key_size, u64 value_size) {
-	bool newly_added = true;
-	
-	if (hash_table_contains_raw(t, hash)) newly_added = false;
+	void *existing = hash_table_find_raw(t, hash, k, key_size);
 	
-	if (newly_added) {
-		hash_table_add_raw(t, hash, k, v, key_size, value_size);
-	} else {
-		memcpy(hash_table_find_raw(t, hash), v, value_size);
+	if (existing) {
+		memcpy(existing, v, value_size);
+		return false;
 	}
 	
-	return newly_added;
+	hash_table_add_raw(t, hash, k, v, key_size, value_size);
+	
+	return true;
 }
 
+///
+// Typed maps
+
+#define hash_map_equals(a, b) ((a) == (b))
+
+#define DEFINE_HASH_MAP(Name, Key_Type, Value_Type, hash_proc, equals_proc) \
+	typedef struct Name##_Entry { \
+		u64 hash; \
+		Key_Type key; \
+		Value_Type value; \
+	} Name##_Entry; \
+	\
+	typedef struct Name { \
+		Name##_Entry *entries; \
+		u64 count; \
+		u64 capacity_count; \
+		Hash_Table_Index _index; \
+		Allocator allocator; \
+	} Name; \
+	\
+	void Name##_reserve(Name *m, u64 required_count) { \
+		_hash_table_reserve_entries((void**)&m->entries, &m->capacity_count, sizeof(Name##_Entry), required_count, m->allocator); \
+		_hash_table_index_reserve(&m->_index, required_count, m->entries, sizeof(Name##_Entry), m->count, m->allocator); \
+	} \
+	void Name##_init(Name *m, Allocator allocator) { \
+		*m = ZERO(Name); \
+		m->allocator = allocator; \
+		Name##_reserve(m, 8); \
+	} \
+	void Name##_clear(Name *m) { \
+		m->count = 0; \
+		_hash_table_index_clear(&m->_index); \
+	} \
+	void Name##_destroy(Name *m) { \
+		if (m->entries) dealloc(m->allocator, m->entries); \
+		_hash_table_index_destroy(&m->_index, m->allocator); \
+		m->entries = 0; \
+		m->count = 0; \
+		m->capacity_count = 0; \
+	} \
+	void Name##_shrink_to_fit(Name *m) { \
+		_hash_table_shrink_to_fit(&m->_index, (void**)&m->entries, &m->capacity_count, sizeof(Name##_Entry), m->count, m->allocator); \
+	} \
+	inline s64 _##Name##_find_slot(Name *m, u64 hash, Key_Type key) { \
+		if (m->count == 0) return -1; \
+		u8 control = _hash_table_control_byte(hash); \
+		u64 group_mask = m->_index.slot_count/HASH_TABLE_GROUP_SIZE - 1; \
+		u64 group = hash & group_mask; \
+		for (u64 step = 1; ; step += 1) { \
+			u8 *group_control = m->_index.control + group*HASH_TABLE_GROUP_SIZE; \
+			u32 match = _hash_table_match_group(group_control, control); \
+			while (match) { \
+				u64 slot = group*HASH_TABLE_GROUP_SIZE + count_trailing_zeros_32(match); \
+				Name##_Entry *entry = &m->entries[m->_index.slots[slot]]; \
+				if (entry->hash == hash && equals_proc(entry->key, key)) return (s64)slot; \
+				match &= match-1; \
+			} \
+			if (_hash_table_match_group(group_control, HASH_TABLE_CONTROL_EMPTY)) return -1; \
+			group = (group + step) & group_mask; \
+		} \
+	} \
+	inline Value_Type *Name##_find(Name *m, Key_Type key) { \
+		s64 slot = _##Name##_find_slot(m, hash_proc(key), key); \
+		if (slot < 0) return 0; \
+		return &m->entries[m->_index.slots[slot]].value; \
+	} \
+	inline bool Name##_contains(Name *m, Key_Type key) { \
+		return _##Name##_find_slot(m, hash_proc(key), key) >= 0; \
+	} \
+	inline Value_Type *_##Name##_add_hashed(Name *m, u64 hash, Key_Type key, Value_Type value) { \
+		if (m->count+1 > m->capacity_count || m->count+1+m->_index.deleted_count >= m->_index.slot_count - m->_index.slot_count/8) { \
+			Name##_reserve(m, m->count+1); \
+		} \
+		Name##_Entry *entry = &m->entries[m->count]; \
+		entry->hash = hash; \
+		entry->key = key; \
+		entry->value = value; \
+		_hash_table_index_insert(&m->_index, hash, m->count); \
+		m->count += 1; \
+		return &entry->value; \
+	} \
+	/* This can add multiple entries of same key, beware! */ \
+	inline Value_Type *Name##_add(Name *m, Key_Type key, Value_Type value) { \
+		return _##Name##_add_hashed(m, hash_proc(key), key, value); \
+	} \
+	/* Returns true if key was newly added or false if it already existed */ \
+	inline bool Name##_set(Name *m, Key_Type key, Value_Type value) { \
+		u64 hash = hash_proc(key); \
+		s64 slot = _##Name##_find_slot(m, hash, key); \
+		if (slot >= 0) { \
+			m->entries[m->_index.slots[slot]].value = value; \
+			return false; \
+		} \
+		_##Name##_add_hashed(m, hash, key, value); \
+		return true; \
+	} \
+	/* Returns true if key existed. Moves the last entry into the removed entry's place. */ \
+	bool Name##_remove(Name *m, Key_Type key) { \
+		s64 slot = _##Name##_find_slot(m, hash_proc(key), key); \
+		if (slot < 0) return false; \
+		_hash_table_index_remove(&m->_index, (u64)slot, m->entries, sizeof(Name##_Entry), m->count); \
+		m->count -= 1; \
+		return true; \
+	}
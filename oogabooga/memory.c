@@ -29,6 +29,7 @@ void* initialization_allocator_proc(u64 size, void *p, Allocator_Message message
 			return 0;
 		}
 		case ALLOCATOR_REALLOCATE: {
+			// Can't grow in place, reallocate() does alloc+copy
 			return 0;
 		}
 	}
@@ -87,11 +88,13 @@ typedef alignat(16) struct Heap_Allocation_Metadata {
 ogb_instance Heap_Block *heap_head;
 ogb_instance bool heap_initted;
 ogb_instance Spinlock heap_lock;
+ogb_instance u64 heap_live_bytes; // Including metadata
 
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
 Heap_Block *heap_head;
 bool heap_initted = false;
 Spinlock heap_lock;
+u64 heap_live_bytes = 0;
 #endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
 	
 
@@ -246,7 +249,16 @@ void heap_init() {
 	assert(sizeof(Heap_Allocation_Metadata) % HEAP_ALIGNMENT == 0);
 	heap_initted = true;
 	heap_head = make_heap_block(0, DEFAULT_HEAP_BLOCK_SIZE);
+#if ENABLE_PROFILING
+	spinlock_init_named(&heap_lock, "heap_lock");
+#else
 	spinlock_init(&heap_lock);
+#endif
+}
+
+// heap_alloc adds the metadata and rounds up to HEAP_ALIGNMENT, which has to stay under MAX_HEAP_BLOCK_SIZE
+u64 get_heap_max_allocation_size() {
+	return MAX_HEAP_BLOCK_SIZE - sizeof(Heap_Allocation_Metadata) - HEAP_ALIGNMENT*2;
 }
 
 void *heap_alloc(u64 size) {
@@ -388,14 +400,101 @@ void *heap_alloc(u64 size) {
 	sanity_check_block(meta->block);
 #endif
 	
+	heap_live_bytes += size;
+	u64 live_bytes = heap_live_bytes;
+	
 	// #Sync #Speed oof
 	spinlock_release(&heap_lock);
 	
+	tm_gauge("heap live bytes", live_bytes);
+	
 	
 	void *p = ((u8*)meta)+sizeof(Heap_Allocation_Metadata);
 	assert((u64)p % HEAP_ALIGNMENT == 0, "Internal heap error. Result pointer is not aligned to HEAP_ALIGNMENT");
 	return p;
 }
+// Grows the allocation at p to size by taking from the free node right after it, if there is
+// one and it's big enough. Returns false if it couldn't, and then p is untouched.
+// Shrinking always succeeds, but keeps the memory.
+bool heap_try_resize_in_place(void *p, u64 size) {
+
+	if (!heap_initted) heap_init();
+
+	size += sizeof(Heap_Allocation_Metadata);
+	size = (size+HEAP_ALIGNMENT) & ~(HEAP_ALIGNMENT-1);
+
+	spinlock_acquire_or_wait(&heap_lock);
+
+	Heap_Allocation_Metadata *meta = (Heap_Allocation_Metadata*)((u8*)p-sizeof(Heap_Allocation_Metadata));
+	check_meta(meta);
+
+	if (size <= meta->size) {
+		spinlock_release(&heap_lock);
+		return true;
+	}
+
+	u64 extra = size - meta->size;
+	Heap_Block *block = meta->block;
+	u8 *tail = (u8*)meta + meta->size;
+
+	// Free nodes are sorted by address
+	Heap_Free_Node *previous = 0;
+	Heap_Free_Node *node = block->free_head;
+	while (node && (u8*)node < tail) {
+		previous = node;
+		node = node->next;
+	}
+
+	if ((u8*)node != tail || node->size < extra) {
+		spinlock_release(&heap_lock);
+		return false;
+	}
+
+	// #Copypaste
+	void *free_tail = (u8*)node + node->size;
+	void *first_page = (void*)align_previous(node, os.page_size);
+	void *last_page_end = (void*)align_previous(free_tail, os.page_size);
+	if ((u8*)last_page_end > (u8*)first_page) {
+		os_unlock_program_memory_pages(first_page, (u64)last_page_end-(u64)first_page);
+	}
+
+	Heap_Free_Node *replacement = node->next;
+	if (node->size != extra) {
+		Heap_Free_Node *new_free_node = (Heap_Free_Node*)((u8*)node + extra);
+		new_free_node->size = node->size - extra;
+		new_free_node->next = node->next;
+		replacement = new_free_node;
+
+		// #Copypaste
+		void *free_tail = (u8*)new_free_node + new_free_node->size;
+		void *next_page = (void*)align_next(new_free_node, os.page_size);
+		void *last_page_end = (void*)align_previous(free_tail, os.page_size);
+		if ((u8*)last_page_end > (u8*)next_page) {
+			os_lock_program_memory_pages(next_page, (u64)last_page_end-(u64)next_page);
+		}
+	}
+
+	if (previous) previous->next = replacement;
+	else block->free_head = replacement;
+
+	meta->size = size;
+#if CONFIGURATION == DEBUG
+	block->total_allocated += extra;
+#endif
+
+#if VERY_DEBUG
+	sanity_check_block(block);
+#endif
+
+	heap_live_bytes += extra;
+	u64 live_bytes = heap_live_bytes;
+
+	spinlock_release(&heap_lock);
+
+	tm_gauge("heap live bytes", live_bytes);
+
+	return true;
+}
 void heap_dealloc(void *p) {
 	// #Sync #Speed oof
 	
@@ -527,30 +626,52 @@ void heap_dealloc(void *p) {
 #if VERY_DEBUG
 	sanity_check_block(block);
 #endif
+	
+	heap_live_bytes -= size;
+	u64 live_bytes = heap_live_bytes;
+	
 	// #Sync #Speed oof
 	spinlock_release(&heap_lock);
+	
+	tm_gauge("heap live bytes", live_bytes);
 }
 
 void* heap_allocator_proc(u64 size, void *p, Allocator_Message message, void* data) {
+	tm_allocation_begin();
 	switch (message) {
 		case ALLOCATOR_ALLOCATE: {
-			return heap_alloc(size);
-			break;
+			void *result = heap_alloc(size);
+			tm_allocation_end(PROFILE_EVENT_ALLOCATE, PROFILE_ALLOCATOR_HEAP, size);
+			return result;
 		}
 		case ALLOCATOR_DEALLOCATE: {
+#if ENABLE_PROFILING
+			u64 old_size = 0;
+			if (_tm_allocation_start_cycles) {
+				old_size = ((Heap_Allocation_Metadata*)(((u64)p)-sizeof(Heap_Allocation_Metadata)))->size - sizeof(Heap_Allocation_Metadata);
+			}
+#endif
 			heap_dealloc(p);
+			tm_allocation_end(PROFILE_EVENT_DEALLOCATE, PROFILE_ALLOCATOR_HEAP, old_size);
 			return 0;
 		}
 		case ALLOCATOR_REALLOCATE: {
 			if (!p) {
-				return heap_alloc(size);
+				void *result = heap_alloc(size);
+				tm_allocation_end(PROFILE_EVENT_ALLOCATE, PROFILE_ALLOCATOR_HEAP, size);
+				return result;
 			}
 			assert(is_pointer_valid(p), "Invalid pointer passed to heap allocator reallocate");
+			if (heap_try_resize_in_place(p, size)) {
+				tm_allocation_end(PROFILE_EVENT_REALLOCATE, PROFILE_ALLOCATOR_HEAP, size);
+				return p;
+			}
 			Heap_Allocation_Metadata *meta = (Heap_Allocation_Metadata*)(((u64)p)-sizeof(Heap_Allocation_Metadata));
 			check_meta(meta);
 			void *new = heap_alloc(size);
-			memcpy(new, p, min(size, meta->size));
+			memcpy(new, p, min(size, meta->size-sizeof(Heap_Allocation_Metadata)));
 			heap_dealloc(p);
+			tm_allocation_end(PROFILE_EVENT_REALLOCATE, PROFILE_ALLOCATOR_HEAP, size);
 			return new;
 		}
 	}
@@ -619,7 +740,7 @@ void* temp_allocator_proc(u64 size, void *p, Allocator_Message message, void* da
 			return 0;
 		}
 		case ALLOCATOR_REALLOCATE: {
-			panic("Temporary allocator cannot 'reallocate'");
+			// Can't grow in place, reallocate() does talloc+copy
 			return 0;
 		}
 	}
@@ -642,6 +763,8 @@ void* talloc(u64 size) {
 	
 	assert(size < TEMPORARY_STORAGE_SIZE, "Bruddah this is too large for temp allocator");
 	
+	tm_allocation_begin();
+	
 	void* p = temporary_storage_pointer;
 	
 	temporary_storage_pointer = (u8*)temporary_storage_pointer + size;
@@ -655,10 +778,14 @@ void* talloc(u64 size) {
 		return talloc(size);;
 	}
 	
+	tm_allocation_end(PROFILE_EVENT_ALLOCATE, PROFILE_ALLOCATOR_TEMPORARY, size);
+	
 	return p;
 }
 
 void reset_temporary_storage() {
+	tm_gauge("temporary storage used", (u8*)temporary_storage_pointer - (u8*)temporary_storage);
+	
 	temporary_storage_pointer = temporary_storage;	
 	has_warned_temporary_storage_overflow = false;
 }
@@ -698,13 +825,16 @@ void* arena_allocator_proc(u64 size, void *p, Allocator_Message message, void* d
 	Arena *arena = (Arena*)data;
 	switch (message) {
 		case ALLOCATOR_ALLOCATE: {
-			return arena_push(arena, size);
+			tm_allocation_begin();
+			void *result = arena_push(arena, size);
+			tm_allocation_end(PROFILE_EVENT_ALLOCATE, PROFILE_ALLOCATOR_ARENA, size);
+			return result;
 		}
 		case ALLOCATOR_DEALLOCATE: {
 			return 0;
 		}
 		case ALLOCATOR_REALLOCATE: {
-			panic("Arena allocator cannot 'reallocate'");
+			// Can't grow in place, reallocate() does arena_push+copy
 			return 0;
 		}
 	}
@@ -110,6 +110,15 @@
 			
 				#define RUN_TESTS 1
 				
+		- RUN_BENCHMARKS
+			Run ooga booga micro benchmarks and write benchmark_results.json.
+		
+			0: Disable
+			1: Enable
+			
+			Note:
+				See benchmarks.c for comparing against a baseline
+				
 		- ENABLE_PROFILING
 			Enable time profiling which will be dumped to google_trace.json.
 		
@@ -126,9 +135,30 @@
 					tm_scope_var
 					tm_scope_accum
 					
+		- FRAME_TIMING_LOG_SUMMARY_ON_EXIT
+			Log frame time percentiles and hitch count when the program exits.
+		
+			0: Disable
+			1: Enable
+			
+			Note:
+				See frame_timing.c
+				
+		- ENABLE_LOCK_STATS
+			Count acquisitions, contention, wait and hold times of named locks
+			(spinlock_init_named, mutex_init_named). Locks get bigger and every release checks
+			for stats, so this is off unless ENABLE_PROFILING is on.
+		
+			0: Disable
+			1: Enable
+			
+			Note:
+				See Lock_Stats in concurrency.c
+					
 		- OOGABOOGA_HEADLESS
             Run oogabooga in headless mode, i.e. no window, no graphics, no audio.
             Useful if you only need the oogabooga standard library for something like a game server.
+            Draw frames can still be built and fonts measured, but nothing is rendered.
             
             0: Disable
             1: Enable
@@ -223,6 +253,10 @@ typedef u8 bool;
     #define INITIAL_PROGRAM_MEMORY_SIZE MB(5)
 #endif
 
+#ifndef ENABLE_LOCK_STATS
+	#define ENABLE_LOCK_STATS ENABLE_PROFILING
+#endif
+
 #if ENABLE_SIMD && !defined(SIMD_ENABLE_SSE2)
 	#if COMPILER_CAN_DO_SSE2
 		#define SIMD_ENABLE_SSE2 1
@@ -312,6 +346,7 @@ typedef u8 bool;
 
 #include "hash_table.c"
 #include "growing_array.c"
+#include "slot_map.c"
 
 #include "os_interface.c"
 
@@ -327,20 +362,26 @@ typedef u8 bool;
 /////
 
 #include "concurrency.c"
+#include "concurrent_hash_table.c"
+#include "string_intern.c"
+#include "parallel_sort.c"
 
 #include "profiling.c"
+#include "frame_timing.c"
 #include "random.c"
 #include "color.c"
 #include "memory.c"
 #include "input.c"
 
-#ifndef OOGABOOGA_HEADLESS
+// Drawing is compiled in headless too so draw frames can be built and sorted without a
+// graphics device, i.e. for benchmarks. There's just nothing to render them.
+#include "gfx_interface.c"
 
-    #include "gfx_interface.c"
+#include "font.c"
 
-    #include "font.c"
+#include "drawing.c"
 
-    #include "drawing.c"
+#ifndef OOGABOOGA_HEADLESS
 
     #include "audio.c"
 #endif
@@ -362,7 +403,9 @@ typedef u8 bool;
     	#error "Current OS is not supported"
     #endif
 
-    #ifndef OOGABOOGA_HEADLESS
+    #ifdef OOGABOOGA_HEADLESS
+        #include "gfx_impl_headless.c"
+    #else
         // #Portability
         #if GFX_RENDERER == GFX_RENDERER_D3D11
             #include "gfx_impl_d3d11.c"
@@ -378,6 +421,7 @@ typedef u8 bool;
 #endif // NOT OOGABOOGA_LINK_EXTERNAL_INSTANCE
 
 #include "tests.c"
+#include "benchmarks.c"
 
 #define malloc please_use_alloc_for_memory_allocations_instead_of_malloc
 #define free please_use_dealloc_for_memory_deallocations_instead_of_free
@@ -414,10 +458,12 @@ void oogabooga_init(u64 program_memory_size) {
 	os_init(program_memory_size);
 	heap_init();
 	temporary_storage_init(TEMPORARY_STORAGE_SIZE);
+#if ENABLE_PROFILING
+	profiler_start_trace_writer();
+#endif
 	log_info("Ooga booga version is %d.%02d.%03d", OGB_VERSION_MAJOR, OGB_VERSION_MINOR, OGB_VERSION_PATCH);
-#ifndef OOGABOOGA_HEADLESS
 	gfx_init();
-#else
+#ifdef OOGABOOGA_HEADLESS
     log_info("Headless mode on");
 #endif
 
@@ -465,11 +511,18 @@ int main(int argc, char **argv) {
 		oogabooga_run_tests();
 	#endif
 	
+	#if RUN_BENCHMARKS
+		oogabooga_run_benchmarks();
+	#endif
+	
 	int code = ENTRY_PROC(argc, argv);
 	
+	_frame_timing_log_exit_summaries();
+	
 #if ENABLE_PROFILING
 	
 	dump_profile_result();
+	lock_stats_log_report();
 	
 #endif
 	
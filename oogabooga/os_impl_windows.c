@@ -671,6 +671,8 @@ DWORD WINAPI win32_thread_invoker(LPVOID param) {
 	
 	t->proc(t);
 	
+	_profiler_release_thread_buffer();
+	
 	heap_dealloc(temporary_storage);
 	
 	return 0;
@@ -849,6 +851,13 @@ os_get_elapsed_seconds() {
 	return (float64)(counter.QuadPart-win32_counter_at_start.QuadPart) / (float64)freq.QuadPart;
 }
 
+u64
+os_get_thread_cycles() {
+	ULONG64 cycles = 0;
+	QueryThreadCycleTime(GetCurrentThread(), &cycles);
+	return (u64)cycles;
+}
+
 
 ///
 ///
@@ -1868,7 +1877,8 @@ win32_audio_thread(Thread *t) {
 	    	started = true;
     	}
     	
-    	while (num_frames_to_write == 0) tm_scope("Chill") {
+    	// No break in here, that would leave the tm_scope without ending it
+    	while (num_frames_to_write == 0 && !win32_audio_deactivated) tm_scope("Chill") {
     		// We yield & sleep until we have any work to do
     		os_yield_thread();
     		os_sleep(1);
@@ -1876,10 +1886,9 @@ win32_audio_thread(Thread *t) {
 	    	hr = IAudioClient_GetCurrentPadding(win32_audio_client, &num_frames_available);
 			if (FAILED(hr)) {
 				win32_audio_deactivated = true;
-				break;
-			}
-	    	num_frames_to_write = buffer_frame_count - num_frames_available;
-	    	
+			} else {
+	    		num_frames_to_write = buffer_frame_count - num_frames_available;
+	    	}
     	}
     	if (win32_audio_deactivated) continue;
 		
@@ -1973,6 +1982,9 @@ void set_specific_gamepad_vibration(u64 gamepad_index, float32 left, float32 rig
 
 void os_update() {
 
+	profiler_new_frame();
+	frame_timing_new_frame();
+
 	// Only show window after first call to os_update
 	if (!has_os_update_been_called_at_all) {
 		ShowWindow(window._os_handle, SW_SHOW);
@@ -216,6 +216,11 @@ DEPRECATED(os_get_current_time_in_seconds(), "Use os_get_elapsed_seconds() inste
 float64 ogb_instance
 os_get_elapsed_seconds();
 
+// Cycles the calling thread has spent running, i.e. not counting time it was waiting or
+// descheduled. Only meaningful as a difference between two calls on the same thread.
+u64 ogb_instance
+os_get_thread_cycles();
+
 
 ///
 ///
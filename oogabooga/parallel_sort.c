@@ -0,0 +1,230 @@
+
+// Multi-threaded LSD radix sort.
+// The keys are split into one partition per thread. Each pass, every thread counts the digits
+// in its partition, then works out where its keys go from everyone's counts (all smaller
+// digits, plus the same digit in earlier partitions), and then scatters its keys there. Since
+// each thread's keys land after the earlier threads' keys with the same digit, the sort is
+// stable like the serial one.
+// Threads wait for each other on a Spin_Barrier between counting and scattering and between
+// passes. The calling thread does one partition itself, the others are started for the sort.
+
+/*
+
+	Example Usage:
+
+
+	// Keys and an index per key, sorted together
+	u32 *keys    = ...;
+	u32 *indices = ...; // 0, 1, 2, ... before sorting
+	u32 *help_keys    = alloc(get_heap_allocator(), count*sizeof(u32));
+	u32 *help_indices = alloc(get_heap_allocator(), count*sizeof(u32));
+
+	// Sort by the low 21 bits of the keys on 4 threads
+	radix_sort_u32_parallel(keys, indices, help_keys, help_indices, count, 21, 4);
+
+	// 0 threads means one per logical processor
+	radix_sort_u64_parallel(keys64, payloads64, help_keys64, help_payloads64, count, 64, 0);
+
+	// Payloads are optional, to just sort the keys
+	radix_sort_u32_parallel(keys, 0, help_keys, 0, count, 32, 0);
+
+
+	Notes:
+		- Keys are unsigned, and only the low number_of_bits bits are sorted by.
+		- The sorted keys (and payloads) end up in keys (and payloads). The help buffers need to
+		  be the same size and are overwritten.
+		- Sorts with fewer than RADIX_SORT_PARALLEL_MIN_COUNT keys, or on 1 thread, just run on
+		  the calling thread, since starting threads would cost more than it saves.
+		- Threads are started for every sort and yield while they wait on each other, so this
+		  is for big sorts. Something like a frame's worth of quads.
+
+*/
+
+#define RADIX_SORT_PARALLEL_RADIX 256
+#define RADIX_SORT_PARALLEL_BITS_PER_PASS 8
+#define RADIX_SORT_PARALLEL_MAX_THREADS 32
+#ifndef RADIX_SORT_PARALLEL_MIN_COUNT
+	#define RADIX_SORT_PARALLEL_MIN_COUNT (64*1024)
+#endif
+
+typedef struct Radix_Sort_Parallel_Job {
+	void *keys;
+	void *payloads;      // Null if there are none
+	void *help_keys;
+	void *help_payloads;
+	u64 key_size;        // 4 or 8, payloads are the same size
+	u64 count;
+	u64 number_of_bits;
+	u64 thread_count;
+
+	// Digit counts of each partition for the current pass, thread_count rows
+	u32 (*counts)[RADIX_SORT_PARALLEL_RADIX];
+
+	Spin_Barrier barrier;
+} Radix_Sort_Parallel_Job;
+
+typedef struct Radix_Sort_Parallel_Worker {
+	Radix_Sort_Parallel_Job *job;
+	u64 thread_index;
+} Radix_Sort_Parallel_Worker;
+
+void _radix_sort_parallel_count(Radix_Sort_Parallel_Job *job, void *keys, u64 begin, u64 end, u64 shift, u64 digit_mask, u32 *counts) {
+	memset(counts, 0, RADIX_SORT_PARALLEL_RADIX*sizeof(u32));
+	if (job->key_size == 4) {
+		u32 *k = (u32*)keys;
+		for (u64 i = begin; i < end; i += 1) counts[(k[i] >> shift) & digit_mask] += 1;
+	} else {
+		u64 *k = (u64*)keys;
+		for (u64 i = begin; i < end; i += 1) counts[(k[i] >> shift) & digit_mask] += 1;
+	}
+}
+
+void _radix_sort_parallel_scatter(Radix_Sort_Parallel_Job *job, void *src_keys, void *src_payloads, void *dst_keys, void *dst_payloads, u64 begin, u64 end, u64 shift, u64 digit_mask, u64 *offsets) {
+	if (job->key_size == 4) {
+		u32 *sk = (u32*)src_keys, *dk = (u32*)dst_keys;
+		u32 *sp = (u32*)src_payloads, *dp = (u32*)dst_payloads;
+		if (sp) {
+			for (u64 i = begin; i < end; i += 1) {
+				u64 dst = offsets[(sk[i] >> shift) & digit_mask]++;
+				dk[dst] = sk[i];
+				dp[dst] = sp[i];
+			}
+		} else {
+			for (u64 i = begin; i < end; i += 1) dk[offsets[(sk[i] >> shift) & digit_mask]++] = sk[i];
+		}
+	} else {
+		u64 *sk = (u64*)src_keys, *dk = (u64*)dst_keys;
+		u64 *sp = (u64*)src_payloads, *dp = (u64*)dst_payloads;
+		if (sp) {
+			for (u64 i = begin; i < end; i += 1) {
+				u64 dst = offsets[(sk[i] >> shift) & digit_mask]++;
+				dk[dst] = sk[i];
+				dp[dst] = sp[i];
+			}
+		} else {
+			for (u64 i = begin; i < end; i += 1) dk[offsets[(sk[i] >> shift) & digit_mask]++] = sk[i];
+		}
+	}
+}
+
+void _radix_sort_parallel_work(Radix_Sort_Parallel_Job *job, u64 thread_index) {
+	u64 begin = job->count*thread_index/job->thread_count;
+	u64 end   = job->count*(thread_index+1)/job->thread_count;
+
+	u64 pass_count = (job->number_of_bits + RADIX_SORT_PARALLEL_BITS_PER_PASS - 1)/RADIX_SORT_PARALLEL_BITS_PER_PASS;
+
+	// Every thread skips the same passes, so they all agree on which buffer the keys are in
+	bool in_help = false;
+
+	for (u64 pass = 0; pass < pass_count; pass += 1) {
+		u64 shift = pass*RADIX_SORT_PARALLEL_BITS_PER_PASS;
+		// The last pass can have less than 8 bits left to sort by
+		u64 digit_mask = RADIX_SORT_PARALLEL_RADIX-1;
+		if (job->number_of_bits-shift < RADIX_SORT_PARALLEL_BITS_PER_PASS) {
+			digit_mask = (1ull << (job->number_of_bits-shift))-1;
+		}
+
+		void *src_keys     = in_help ? job->help_keys     : job->keys;
+		void *src_payloads = in_help ? job->help_payloads : job->payloads;
+		void *dst_keys     = in_help ? job->keys          : job->help_keys;
+		void *dst_payloads = in_help ? job->payloads      : job->help_payloads;
+
+		_radix_sort_parallel_count(job, src_keys, begin, end, shift, digit_mask, job->counts[thread_index]);
+
+		spin_barrier_wait(&job->barrier);
+
+		// Where this partition's keys with each digit start in dst
+		u64 offsets[RADIX_SORT_PARALLEL_RADIX];
+		u64 offset = 0;
+		bool skip_pass = false;
+		for (u64 digit = 0; digit < RADIX_SORT_PARALLEL_RADIX; digit += 1) {
+			u64 digit_total = 0;
+			for (u64 t = 0; t < job->thread_count; t += 1) {
+				if (t == thread_index) offsets[digit] = offset + digit_total;
+				digit_total += job->counts[t][digit];
+			}
+			// Every key has this digit, so this pass wouldn't move anything
+			if (digit_total == job->count) skip_pass = true;
+			offset += digit_total;
+		}
+
+		if (!skip_pass) {
+			_radix_sort_parallel_scatter(job, src_keys, src_payloads, dst_keys, dst_payloads, begin, end, shift, digit_mask, offsets);
+			in_help = !in_help;
+		}
+
+		// Everyone needs to be done with the counts and with writing dst before the next pass
+		spin_barrier_wait(&job->barrier);
+	}
+
+	if (in_help) {
+		memcpy((u8*)job->keys + begin*job->key_size, (u8*)job->help_keys + begin*job->key_size, (end-begin)*job->key_size);
+		if (job->payloads) {
+			memcpy((u8*)job->payloads + begin*job->key_size, (u8*)job->help_payloads + begin*job->key_size, (end-begin)*job->key_size);
+		}
+	}
+}
+
+void _radix_sort_parallel_thread_proc(Thread *t) {
+	Radix_Sort_Parallel_Worker *worker = (Radix_Sort_Parallel_Worker*)t->data;
+	_radix_sort_parallel_work(worker->job, worker->thread_index);
+}
+
+void _radix_sort_parallel(void *keys, void *payloads, void *help_keys, void *help_payloads, u64 key_size, u64 count, u64 number_of_bits, u64 thread_count) {
+	assert(number_of_bits >= 1 && number_of_bits <= key_size*8, "Can't radix sort %llu bit keys by %llu bits", key_size*8, number_of_bits);
+	assert(count <= UINT32_MAX, "Parallel radix sort can sort at most %u keys", UINT32_MAX);
+	assert(!payloads || help_payloads, "Parallel radix sort needs help_payloads when there are payloads");
+
+	if (thread_count == 0) thread_count = os_get_number_of_logical_processors();
+	thread_count = clamp(thread_count, 1, RADIX_SORT_PARALLEL_MAX_THREADS);
+	if (count < RADIX_SORT_PARALLEL_MIN_COUNT) thread_count = 1;
+
+	Radix_Sort_Parallel_Job job_storage = {0};
+	Radix_Sort_Parallel_Job *job = &job_storage;
+	
+	// A 1kb row of counts per thread, which only fits on the stack for the serial sort
+	u32 serial_counts[1][RADIX_SORT_PARALLEL_RADIX];
+	if (thread_count == 1) {
+		job->counts = serial_counts;
+	} else {
+		// #Memory #Heapalloc
+		job->counts = alloc(get_heap_allocator(), thread_count*sizeof(job->counts[0]));
+	}
+	
+	job->keys = keys;
+	job->payloads = payloads;
+	job->help_keys = help_keys;
+	job->help_payloads = payloads ? help_payloads : 0;
+	job->key_size = key_size;
+	job->count = count;
+	job->number_of_bits = number_of_bits;
+	job->thread_count = thread_count;
+	spin_barrier_init(&job->barrier, thread_count);
+
+	Thread threads[RADIX_SORT_PARALLEL_MAX_THREADS];
+	Radix_Sort_Parallel_Worker workers[RADIX_SORT_PARALLEL_MAX_THREADS];
+	for (u64 i = 1; i < thread_count; i += 1) {
+		workers[i].job = job;
+		workers[i].thread_index = i;
+		os_thread_init(&threads[i], _radix_sort_parallel_thread_proc);
+		threads[i].data = &workers[i];
+		os_thread_start(&threads[i]);
+	}
+
+	_radix_sort_parallel_work(job, 0);
+
+	for (u64 i = 1; i < thread_count; i += 1) {
+		os_thread_join(&threads[i]);
+		os_thread_destroy(&threads[i]);
+	}
+
+	if (thread_count > 1) dealloc(get_heap_allocator(), job->counts);
+}
+
+// payloads and help_payloads can be null. thread_count 0 is one per logical processor.
+void radix_sort_u32_parallel(u32 *keys, u32 *payloads, u32 *help_keys, u32 *help_payloads, u64 count, u64 number_of_bits, u64 thread_count) {
+	_radix_sort_parallel(keys, payloads, help_keys, help_payloads, sizeof(u32), count, number_of_bits, thread_count);
+}
+void radix_sort_u64_parallel(u64 *keys, u64 *payloads, u64 *help_keys, u64 *help_payloads, u64 count, u64 number_of_bits, u64 thread_count) {
+	_radix_sort_parallel(keys, payloads, help_keys, help_payloads, sizeof(u64), count, number_of_bits, thread_count);
+}
@@ -1,54 +1,974 @@
 
+/*
+	Time profiling, enabled with ENABLE_PROFILING.
+
+	tm_scope("Name") { ... }
+		Records a scope event into the calling thread's event buffer. That's two rdtsc's and a
+		32 byte store into a thread local ring buffer. No locks, no formatting.
+
+	profiler_start_trace_writer()
+		Opens google_trace.json and starts a background thread which drains the event buffers
+		and appends the events as chrome trace json every PROFILER_WRITE_INTERVAL_MS.
+		This is called in oogabooga_init when ENABLE_PROFILING is set.
+	
+	dump_profile_result()
+		Writes whatever is left, closes the json array and the file.
+		This is called on exit when ENABLE_PROFILING is set.
+		
+	profiler_capture_start()
+	profiler_capture_stop()
+	profiler_capture_frames(frame_count)
+		Only record events within a capture window. profiler_capture_frames(300) captures the
+		next 300 frames, counted by os_update(). With PROFILER_CAPTURE_ON_START 0 nothing is
+		recorded until a capture is started.
+
+	Scope names are interned by their address, the string itself is not read until the trace
+	is written. So names need to live until then, which they do if you use string literals.
+
+	Each thread gets a ring buffer of PROFILER_EVENTS_PER_THREAD events the first time it
+	records an event. Buffers of exited threads are reused by new threads.
+	Memory use is fixed: PROFILER_EVENTS_PER_THREAD*sizeof(Profile_Event) per profiled thread,
+	512KB by default, plus PROFILER_WRITE_BUFFER_SIZE for the writer. If a thread fills its buffer faster than
+	the writer drains it, new events are dropped and counted.
+	If the program crashes the trace is just missing its closing bracket, which the chrome
+	trace viewer and perfetto both accept.
+	
+	Live statistics:
+	
+	While profiler_collecting_stats is true (PROFILER_COLLECT_STATS, default 1) every tm_scope
+	is also aggregated into a call tree per thread, independently of the trace capture.
+	Nodes are keyed by their name and parent, so the same scope called from two places shows
+	up twice.
+	Leaving a tm_scope with break, return or goto skips its end, so don't. If it happens
+	anyway, the scope is dropped from the stack when its enclosing scope ends or when the
+	same tm_scope begins again, so later scopes don't nest under it for good.
+	
+	profiler_get_stats(thread_id, out, max_count)
+		Fills out with the stats of the last finished frame of a thread's call tree, in depth
+		first order. Returns the number of scopes written. Reading another thread's stats is
+		not synchronized, so the numbers might be off by a call if that thread is mid update.
+	
+	profiler_get_profiled_thread_ids(out, max_count)
+		Thread ids that have stats to query.
+	
+	draw_profiler_stats() in drawing.c draws the table on screen.
+	
+	Counters and gauges:
+	
+	tm_gauge("heap live bytes", value)
+		Samples a value, shows up as a counter track per thread in the trace.
+	tm_counter("quads", n)
+		Adds n to a per thread, per frame total. The total of a frame is written as a sample
+		at the start of the next frame the counter is used in, so a counter that isn't touched
+		for a while keeps showing its last total.
+
+	Allocations:
+	
+	While profiler_recording_allocations is true (PROFILER_RECORD_ALLOCATIONS, default 0) the
+	heap allocator, arena allocators and talloc record an event per allocation and per heap
+	free, with the size, allocator, duration and a tag. They show up as "heap alloc" etc.
+	slices inside the scope that allocated, next to the "heap live bytes" track. The
+	"allocations" and "allocated bytes" counters are the per frame totals.
+	The tag is the innermost tm_scope of the thread (needs profiler_collecting_stats), or
+	whatever was set with tm_allocation_tag:
+	
+		tm_allocation_tag("text wrapping") {
+			...
+		}
+
+	Thread cycles:
+	
+	With PROFILER_THREAD_CYCLES 1 every tm_scope also reads os_get_thread_cycles() at entry
+	and exit: the cycles the thread actually ran, as opposed to the rdtsc wall time. A scope
+	with far fewer thread cycles than wall cycles was waiting or descheduled.
+	It shows up as thread_cycles in the trace event args and Profile_Scope_Stats, and as a
+	column in draw_profiler_stats(). This adds ~2 syscalls per scope so it's off by default.
+	This is the only per-thread counter. Instruction, cache miss and branch miss counters need
+	kernel mode access on windows (no perf_event_open equivalent) so they are not provided.
+	
+	Lock waits:
+	
+	Contended waits on named locks (spinlock_init_named, mutex_init_named in concurrency.c)
+	longer than LOCK_STATS_TRACE_WAIT_MICROSECONDS show up as "wait <name>" slices. With
+	ENABLE_PROFILING heap_lock, the profiler lock and audio player sample locks are named, and
+	lock_stats_log_report() is called on exit.
+
+	rdtsc is calibrated against os_get_elapsed_seconds() once in profiler_init(), so timestamps
+	in the trace are on the same timeline as os_get_elapsed_seconds().
+*/
+
+#ifndef PROFILER_EVENTS_PER_THREAD
+	#define PROFILER_EVENTS_PER_THREAD (1024*16)
+#endif
+#ifndef PROFILER_WRITE_BUFFER_SIZE
+	#define PROFILER_WRITE_BUFFER_SIZE (1024*256)
+#endif
+#ifndef PROFILER_WRITE_INTERVAL_MS
+	#define PROFILER_WRITE_INTERVAL_MS 10
+#endif
+#ifndef PROFILER_CAPTURE_ON_START
+	#define PROFILER_CAPTURE_ON_START 1
+#endif
+#ifndef PROFILER_COLLECT_STATS
+	#define PROFILER_COLLECT_STATS 1
+#endif
+#ifndef PROFILER_MAX_STAT_NODES
+	#define PROFILER_MAX_STAT_NODES 512
+#endif
+#ifndef PROFILER_MAX_SCOPE_DEPTH
+	#define PROFILER_MAX_SCOPE_DEPTH 64
+#endif
+#ifndef PROFILER_THREAD_CYCLES
+	#define PROFILER_THREAD_CYCLES 0
+#endif
+#ifndef PROFILER_RECORD_ALLOCATIONS
+	#define PROFILER_RECORD_ALLOCATIONS 0
+#endif
+#ifndef PROFILER_MAX_COUNTERS
+	#define PROFILER_MAX_COUNTERS 64
+#endif
+// Weight of the last frame in Profile_Scope_Stats.average_seconds
+#ifndef PROFILER_STATS_AVERAGE_WEIGHT
+	#define PROFILER_STATS_AVERAGE_WEIGHT 0.05
+#endif
+
+typedef enum Profile_Event_Kind {
+	PROFILE_EVENT_SCOPE,
+	PROFILE_EVENT_VALUE, // Counter or gauge sample at start_cycles
+	PROFILE_EVENT_ALLOCATE,
+	PROFILE_EVENT_DEALLOCATE,
+	PROFILE_EVENT_REALLOCATE, // size is the new size. Not counted as an allocation, the block was already live.
+	PROFILE_EVENT_LOCK_WAIT, // Named lock, see Lock_Stats in concurrency.c
+	PROFILE_EVENT_SCOPE_THREAD_CYCLES, // Always right after its PROFILE_EVENT_SCOPE
+} Profile_Event_Kind;
+
+typedef enum Profile_Allocator_Kind {
+	PROFILE_ALLOCATOR_HEAP,
+	PROFILE_ALLOCATOR_TEMPORARY,
+	PROFILE_ALLOCATOR_ARENA,
+	
+	PROFILE_ALLOCATOR_KIND_COUNT
+} Profile_Allocator_Kind;
+
+typedef struct Profile_Event {
+	u64 start_cycles;
+	union {
+		u64 end_cycles; // PROFILE_EVENT_SCOPE
+		f64 value;      // PROFILE_EVENT_VALUE
+		u64 size;       // PROFILE_EVENT_ALLOCATE, PROFILE_EVENT_DEALLOCATE, PROFILE_EVENT_REALLOCATE
+		u64 thread_cycles; // PROFILE_EVENT_SCOPE_THREAD_CYCLES
+	};
+	const char *name; // Tag for allocation events, might be 0
+	u32 duration_cycles; // Allocation events, saturated
+	u16 kind; // Profile_Event_Kind
+	u16 allocator; // Profile_Allocator_Kind
+} Profile_Event;
+
+typedef struct Profile_Stat_Node {
+	const char *name;
+	u32 parent;
+	u32 first_child;
+	u32 last_child;
+	u32 next_sibling;
+	u32 depth;
+	
+	// Accumulating for frame_index
+	u64 frame_index;
+	u64 frame_call_count;
+	u64 frame_total_cycles;
+	u64 frame_child_cycles;
+	u64 frame_min_cycles;
+	u64 frame_max_cycles;
+	u64 frame_thread_cycles;
+	
+	// Last finished frame with any calls
+	u64 completed_frame_index;
+	u64 call_count;
+	u64 total_cycles;
+	u64 self_cycles;
+	u64 min_cycles;
+	u64 max_cycles;
+	u64 thread_cycles;
+	
+	f64 average_cycles;
+} Profile_Stat_Node;
+
+typedef struct Profiler_Thread_Stats {
+	// nodes[0] is the root, it has no name and is never timed
+	Profile_Stat_Node nodes[PROFILER_MAX_STAT_NODES];
+	u32 node_count;
+	u32 stack[PROFILER_MAX_SCOPE_DEPTH];
+	// Address of the tm_scope's loop variable, to find scopes which were left without ending
+	const void *stack_keys[PROFILER_MAX_SCOPE_DEPTH];
+	u32 stack_count;
+} Profiler_Thread_Stats;
+
+typedef struct Profile_Scope_Stats {
+	const char *name;
+	u32 depth; // 1 for top level scopes
+	
+	// Last finished frame
+	u64 call_count;
+	f64 total_seconds;
+	f64 self_seconds;
+	f64 min_seconds; // Shortest single call
+	f64 max_seconds; // Longest single call
+	u64 thread_cycles; // PROFILER_THREAD_CYCLES only, total os_get_thread_cycles()
+	
+	// Exponential moving average of total_seconds over the frames the scope was called in
+	f64 average_seconds;
+} Profile_Scope_Stats;
+
+typedef struct Profiler_Counter {
+	const char *name;
+	u64 frame_index;
+	f64 frame_total;
+} Profiler_Counter;
+
+typedef struct Profiler_Thread_Buffer Profiler_Thread_Buffer;
+typedef struct Profiler_Thread_Buffer {
+	Profile_Event *events;
+	volatile u64 write_count;
+	volatile u64 read_count;
+	volatile u64 dropped_count;
+	volatile bool in_use;
+	u64 thread_id;
+	Profiler_Thread_Stats *stats;
+	Profiler_Counter counters[PROFILER_MAX_COUNTERS];
+	u32 counter_count;
+	Profiler_Thread_Buffer *next;
+} Profiler_Thread_Buffer;
 
 // #Global
-ogb_instance String_Builder _profile_output;
 ogb_instance bool profiler_initted;
 ogb_instance Spinlock _profiler_lock;
+ogb_instance Profiler_Thread_Buffer *_profiler_thread_buffers;
+ogb_instance f64 profiler_cycles_per_second;
+ogb_instance u64 _profiler_anchor_cycles;
+ogb_instance f64 _profiler_anchor_seconds;
+ogb_instance volatile bool profiler_capturing;
+ogb_instance volatile bool profiler_collecting_stats;
+ogb_instance volatile bool profiler_recording_allocations;
+ogb_instance u64 profiler_frame_index;
+ogb_instance u64 _profiler_frame_start_cycles;
+ogb_instance u64 _profiler_capture_end_frame;
+
+typedef struct Profiler_Trace_Writer {
+	File file;
+	String_Builder sb;
+	Thread thread;
+	volatile bool running;
+	u64 dropped_count;
+} Profiler_Trace_Writer;
+ogb_instance Profiler_Trace_Writer _profiler_writer;
 
 #if !OOGABOOGA_LINK_EXTERNAL_INSTANCE
-String_Builder _profile_output = {0};
 bool profiler_initted = false;
 Spinlock _profiler_lock;
+Profiler_Thread_Buffer *_profiler_thread_buffers = 0;
+f64 profiler_cycles_per_second = 0;
+u64 _profiler_anchor_cycles = 0;
+f64 _profiler_anchor_seconds = 0;
+volatile bool profiler_capturing = PROFILER_CAPTURE_ON_START;
+volatile bool profiler_collecting_stats = PROFILER_COLLECT_STATS;
+volatile bool profiler_recording_allocations = PROFILER_RECORD_ALLOCATIONS;
+u64 profiler_frame_index = 0;
+u64 _profiler_frame_start_cycles = 0;
+u64 _profiler_capture_end_frame = 0;
+Profiler_Trace_Writer _profiler_writer = {0};
 #endif
 
-void dump_profile_result() {
-	File file = os_file_open("google_trace.json", O_CREATE | O_WRITE);
+thread_local Profiler_Thread_Buffer *_profiler_thread_buffer = 0;
+thread_local bool _profiler_acquiring_thread_buffer = false;
+thread_local const char *_profiler_allocation_tag = 0;
+
+void profiler_init() {
+	if (profiler_initted) return;
+
+	local_persist volatile bool initting = false;
+	if (!compare_and_swap_bool(&initting, true, false)) {
+		while (!profiler_initted) os_yield_thread();
+		return;
+	}
+
+#if ENABLE_PROFILING
+	spinlock_init_named(&_profiler_lock, "profiler lock");
+#else
+	spinlock_init(&_profiler_lock);
+#endif
+
+	// Calibrate rdtsc once. 10ms is plenty to get the error well below what's visible in a trace.
+	f64 start_seconds = os_get_elapsed_seconds();
+	u64 start_cycles  = rdtsc();
+	f64 end_seconds = start_seconds;
+	while (end_seconds - start_seconds < 0.01) end_seconds = os_get_elapsed_seconds();
+	u64 end_cycles = rdtsc();
+
+	profiler_cycles_per_second = (f64)(end_cycles-start_cycles) / (end_seconds-start_seconds);
+	_profiler_anchor_cycles  = end_cycles;
+	_profiler_anchor_seconds = end_seconds;
+
+	MEMORY_BARRIER;
+	profiler_initted = true;
+}
+
+inline f64
+profiler_cycles_to_seconds(s64 cycles) {
+	return (f64)cycles / profiler_cycles_per_second;
+}
+inline f64
+profiler_cycles_to_timestamp(u64 cycles) {
+	return _profiler_anchor_seconds + profiler_cycles_to_seconds((s64)(cycles-_profiler_anchor_cycles));
+}
+
+// Slow path, first event on a thread.
+// Returns 0 when called recursively, i.e. from instrumented code in the allocator used here.
+Profiler_Thread_Buffer *_profiler_acquire_thread_buffer() {
+	// Nothing is recorded before profiler_init(), os timing might not be initialized yet
+	if (!profiler_initted) return 0;
+	if (_profiler_acquiring_thread_buffer) return 0;
+	_profiler_acquiring_thread_buffer = true;
+
+	spinlock_acquire_or_wait(&_profiler_lock);
+
+	// Don't reuse a buffer before its events are written, they're attributed to buffer->thread_id
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffers;
+	while (buffer && (buffer->in_use || buffer->read_count != buffer->write_count)) buffer = buffer->next;
+
+	if (!buffer) {
+		buffer = alloc(get_heap_allocator(), sizeof(Profiler_Thread_Buffer));
+		buffer->events = alloc_uninitialized(get_heap_allocator(), sizeof(Profile_Event)*PROFILER_EVENTS_PER_THREAD);
+		buffer->next = _profiler_thread_buffers;
+		_profiler_thread_buffers = buffer;
+	}
+	buffer->in_use = true;
+	buffer->thread_id = context.thread_id;
 	
-	os_file_write_string(file, STR("["));
-	os_file_write_string(file, _profile_output.result);
-	os_file_write_string(file, STR("{}]"));
+	// Call tree and counters belong to the thread, not the buffer
+	if (buffer->stats) buffer->stats->node_count = 0;
+	buffer->counter_count = 0;
+
+	spinlock_release(&_profiler_lock);
+
+	_profiler_thread_buffer = buffer;
+	_profiler_acquiring_thread_buffer = false;
+	return buffer;
+}
+// Called when a thread exits so its buffer can be reused by the next thread.
+// Events already recorded stay in the buffer until dumped.
+void _profiler_release_thread_buffer() {
+	if (!_profiler_thread_buffer) return;
+	_profiler_thread_buffer->in_use = false;
+	_profiler_thread_buffer = 0;
+}
+
+inline void
+_profiler_record_span(Profile_Event_Kind kind, Profiler_Thread_Buffer *buffer, const char *name, u64 start_cycles, u64 end_cycles) {
+	u64 n = buffer->write_count;
+	if (n - buffer->read_count >= PROFILER_EVENTS_PER_THREAD) {
+		// Writer can't keep up, drop the event rather than overwriting what it's reading
+		buffer->dropped_count += 1;
+		return;
+	}
+	Profile_Event *e = &buffer->events[n % PROFILER_EVENTS_PER_THREAD];
+	e->start_cycles = start_cycles;
+	e->end_cycles   = end_cycles;
+	e->name         = name;
+	e->kind         = (u16)kind;
+
+	MEMORY_BARRIER;
+	buffer->write_count = n+1;
+}
+
+inline void
+_profiler_record_scope(const char *name, u64 start_cycles, u64 end_cycles) {
+	if (!profiler_capturing) return;
 	
-	os_file_close(file);
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) buffer = _profiler_acquire_thread_buffer();
+	if (!buffer) return;
 	
-	log_verbose("Wrote profiling result to google_trace.json");
+	_profiler_record_span(PROFILE_EVENT_SCOPE, buffer, name, start_cycles, end_cycles);
 }
-void _profiler_report_time(string name, f64 count, f64 start) {
-	if (!profiler_initted) {
-		spinlock_init(&_profiler_lock);
-		profiler_initted = true;
+
+void _profiler_record_lock_wait(const char *name, u64 start_cycles, u64 end_cycles) {
+	if (!profiler_capturing || !profiler_initted) return;
+	
+	// Acquiring a buffer takes _profiler_lock and allocates, which might be the lock we just
+	// acquired, so only threads that already have a buffer record waits.
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) return;
+	
+	if (profiler_cycles_to_seconds(end_cycles-start_cycles)*1000000.0 < LOCK_STATS_TRACE_WAIT_MICROSECONDS) return;
+	
+	_profiler_record_span(PROFILE_EVENT_LOCK_WAIT, buffer, name, start_cycles, end_cycles);
+}
+
+inline void
+_profiler_record_value(const char *name, f64 value, u64 cycles) {
+	if (!profiler_capturing) return;
+	
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) buffer = _profiler_acquire_thread_buffer();
+	if (!buffer) return;
+
+	u64 n = buffer->write_count;
+	if (n - buffer->read_count >= PROFILER_EVENTS_PER_THREAD) {
+		buffer->dropped_count += 1;
+		return;
+	}
+	Profile_Event *e = &buffer->events[n % PROFILER_EVENTS_PER_THREAD];
+	e->start_cycles = cycles;
+	e->value        = value;
+	e->name         = name;
+	e->kind         = PROFILE_EVENT_VALUE;
+
+	MEMORY_BARRIER;
+	buffer->write_count = n+1;
+}
+
+void _profiler_counter_add(const char *name, f64 value) {
+	if (!profiler_capturing) return;
+	
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) buffer = _profiler_acquire_thread_buffer();
+	if (!buffer) return;
+	
+	Profiler_Counter *counter = 0;
+	for (u32 i = 0; i < buffer->counter_count; i += 1) {
+		if (buffer->counters[i].name == name) {
+			counter = &buffer->counters[i];
+			break;
+		}
+	}
+	if (!counter) {
+		if (buffer->counter_count >= PROFILER_MAX_COUNTERS) return;
+		counter = &buffer->counters[buffer->counter_count];
+		buffer->counter_count += 1;
+		counter->name        = name;
+		counter->frame_index = profiler_frame_index;
+		counter->frame_total = 0;
+	}
+	
+	if (counter->frame_index != profiler_frame_index) {
+		_profiler_record_value(name, counter->frame_total, _profiler_frame_start_cycles);
+		counter->frame_index = profiler_frame_index;
+		counter->frame_total = 0;
+	}
+	
+	counter->frame_total += value;
+}
+
+Profiler_Thread_Stats *_profiler_init_thread_stats(Profiler_Thread_Buffer *buffer) {
+	if (!buffer->stats) {
+		buffer->stats = alloc(get_heap_allocator(), sizeof(Profiler_Thread_Stats));
+	}
+	Profiler_Thread_Stats *stats = buffer->stats;
+	memset(&stats->nodes[0], 0, sizeof(Profile_Stat_Node));
+	stats->node_count = 1;
+	stats->stack[0] = 0;
+	stats->stack_keys[0] = 0;
+	stats->stack_count = 1;
+	return stats;
+}
+
+inline void
+_profiler_stat_node_roll_frame(Profile_Stat_Node *node) {
+	if (node->frame_index == profiler_frame_index) return;
+	
+	if (node->frame_call_count > 0) {
+		node->completed_frame_index = node->frame_index;
+		node->call_count   = node->frame_call_count;
+		node->total_cycles = node->frame_total_cycles;
+		node->self_cycles  = node->frame_total_cycles - min(node->frame_child_cycles, node->frame_total_cycles);
+		node->min_cycles   = node->frame_min_cycles;
+		node->max_cycles   = node->frame_max_cycles;
+		node->thread_cycles = node->frame_thread_cycles;
+		
+		if (node->average_cycles == 0) node->average_cycles = (f64)node->total_cycles;
+		else node->average_cycles += ((f64)node->total_cycles - node->average_cycles) * PROFILER_STATS_AVERAGE_WEIGHT;
+	}
+	
+	node->frame_index        = profiler_frame_index;
+	node->frame_call_count   = 0;
+	node->frame_total_cycles = 0;
+	node->frame_child_cycles = 0;
+	node->frame_min_cycles   = UINT64_MAX;
+	node->frame_max_cycles   = 0;
+	node->frame_thread_cycles = 0;
+}
+
+// Returns the stack depth with the scope pushed, which it's popped back from, or 0 if it
+// wasn't pushed.
+// key is unique to the tm_scope (and the call's stack frame). If it's still on the stack,
+// that scope was left without ending and it's dropped along with everything above it.
+u64 _profiler_stats_push(const char *name, const void *key) {
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) buffer = _profiler_acquire_thread_buffer();
+	if (!buffer) return 0;
+	
+	Profiler_Thread_Stats *stats = buffer->stats;
+	if (!stats || stats->node_count == 0) stats = _profiler_init_thread_stats(buffer);
+	
+	for (u32 i = stats->stack_count-1; i >= 1; i -= 1) {
+		if (stats->stack_keys[i] == key) {
+			stats->stack_count = i;
+			break;
+		}
+	}
+	
+	if (stats->stack_count >= PROFILER_MAX_SCOPE_DEPTH) return 0;
+	
+	u32 parent_index = stats->stack[stats->stack_count-1];
+	Profile_Stat_Node *parent = &stats->nodes[parent_index];
+	
+	u32 index = parent->first_child;
+	while (index && stats->nodes[index].name != name) index = stats->nodes[index].next_sibling;
+	
+	if (!index) {
+		if (stats->node_count >= PROFILER_MAX_STAT_NODES) return 0;
+		
+		index = stats->node_count;
+		stats->node_count += 1;
 		
-		string_builder_init_reserve(&_profile_output, 1024*1000, get_heap_allocator());	
+		Profile_Stat_Node *node = &stats->nodes[index];
+		memset(node, 0, sizeof(Profile_Stat_Node));
+		node->name   = name;
+		node->parent = parent_index;
+		node->depth  = parent->depth+1;
+		node->frame_index = profiler_frame_index;
+		node->frame_min_cycles = UINT64_MAX;
 		
+		if (parent->last_child) stats->nodes[parent->last_child].next_sibling = index;
+		else                    parent->first_child = index;
+		parent->last_child = index;
+	}
+	
+	stats->stack[stats->stack_count] = index;
+	stats->stack_keys[stats->stack_count] = key;
+	stats->stack_count += 1;
+	
+	return stats->stack_count;
+}
+
+// Returns 0 if the scope was already dropped from the stack
+inline Profile_Stat_Node *
+_profiler_stats_pop(u64 depth, u64 start_cycles, u64 end_cycles) {
+	Profiler_Thread_Stats *stats = _profiler_thread_buffer->stats;
+	
+	if (stats->stack_count < depth) return 0;
+	
+	// Anything above us was left without ending
+	stats->stack_count = (u32)depth-1;
+	Profile_Stat_Node *node = &stats->nodes[stats->stack[stats->stack_count]];
+	
+	u64 cycles = end_cycles-start_cycles;
+	
+	_profiler_stat_node_roll_frame(node);
+	node->frame_call_count   += 1;
+	node->frame_total_cycles += cycles;
+	node->frame_min_cycles    = min(node->frame_min_cycles, cycles);
+	node->frame_max_cycles    = max(node->frame_max_cycles, cycles);
+	
+	if (node->parent) {
+		Profile_Stat_Node *parent = &stats->nodes[node->parent];
+		_profiler_stat_node_roll_frame(parent);
+		parent->frame_child_cycles += cycles;
+	}
+	
+	return node;
+}
+
+// Innermost scope of the calling thread, or the tm_allocation_tag
+const char *_profiler_get_allocation_tag(Profiler_Thread_Buffer *buffer) {
+	if (_profiler_allocation_tag) return _profiler_allocation_tag;
+	
+	Profiler_Thread_Stats *stats = buffer->stats;
+	if (!profiler_collecting_stats || !stats || stats->node_count == 0 || stats->stack_count <= 1) return 0;
+	
+	return stats->nodes[stats->stack[stats->stack_count-1]].name;
+}
+
+void _profiler_record_allocation(Profile_Event_Kind kind, Profile_Allocator_Kind allocator, u64 size, u64 start_cycles, u64 end_cycles) {
+	if (!profiler_capturing) return;
+	
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) buffer = _profiler_acquire_thread_buffer();
+	if (!buffer) return;
+	
+	if (kind == PROFILE_EVENT_ALLOCATE) {
+		_profiler_counter_add("allocations", 1);
+		_profiler_counter_add("allocated bytes", (f64)size);
+	} else if (kind == PROFILE_EVENT_REALLOCATE) {
+		_profiler_counter_add("reallocations", 1);
+	}
+
+	u64 n = buffer->write_count;
+	if (n - buffer->read_count >= PROFILER_EVENTS_PER_THREAD) {
+		buffer->dropped_count += 1;
+		return;
+	}
+	u64 duration_cycles = end_cycles-start_cycles;
+	
+	Profile_Event *e = &buffer->events[n % PROFILER_EVENTS_PER_THREAD];
+	e->start_cycles    = start_cycles;
+	e->size            = size;
+	e->name            = _profiler_get_allocation_tag(buffer);
+	e->duration_cycles = (u32)min(duration_cycles, 0xFFFFFFFFULL);
+	e->kind            = (u16)kind;
+	e->allocator       = (u16)allocator;
+
+	MEMORY_BARRIER;
+	buffer->write_count = n+1;
+}
+
+// Returns the depth to pass to _profiler_scope_end, see _profiler_stats_push
+inline u64
+_profiler_scope_begin(const char *name, const void *key) {
+	if (!profiler_collecting_stats) return 0;
+	return _profiler_stats_push(name, key);
+}
+inline void
+_profiler_scope_end(const char *name, u64 start_cycles, u64 end_cycles, u64 depth) {
+	if (depth) _profiler_stats_pop(depth, start_cycles, end_cycles);
+	_profiler_record_scope(name, start_cycles, end_cycles);
+}
+
+void _profiler_record_scope_with_thread_cycles(const char *name, u64 start_cycles, u64 end_cycles, u64 thread_cycles) {
+	if (!profiler_capturing) return;
+	
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffer;
+	if (!buffer) buffer = _profiler_acquire_thread_buffer();
+	if (!buffer) return;
+	
+	// Both events are published at once so the writer never sees one without the other
+	u64 n = buffer->write_count;
+	if (n+2 - buffer->read_count > PROFILER_EVENTS_PER_THREAD) {
+		buffer->dropped_count += 2;
+		return;
 	}
+	Profile_Event *e = &buffer->events[n % PROFILER_EVENTS_PER_THREAD];
+	e->start_cycles = start_cycles;
+	e->end_cycles   = end_cycles;
+	e->name         = name;
+	e->kind         = PROFILE_EVENT_SCOPE;
+	
+	Profile_Event *cycles_event = &buffer->events[(n+1) % PROFILER_EVENTS_PER_THREAD];
+	cycles_event->start_cycles  = start_cycles;
+	cycles_event->thread_cycles = thread_cycles;
+	cycles_event->name          = name;
+	cycles_event->kind          = PROFILE_EVENT_SCOPE_THREAD_CYCLES;
+
+	MEMORY_BARRIER;
+	buffer->write_count = n+2;
+}
+void _profiler_scope_end_with_thread_cycles(const char *name, u64 start_cycles, u64 end_cycles, u64 depth, u64 thread_cycles) {
+	Profile_Stat_Node *node = depth ? _profiler_stats_pop(depth, start_cycles, end_cycles) : 0;
+	if (node) node->frame_thread_cycles += thread_cycles;
+	_profiler_record_scope_with_thread_cycles(name, start_cycles, end_cycles, thread_cycles);
+}
+
+u64 profiler_get_profiled_thread_ids(u64 *out, u64 max_count) {
+	if (!profiler_initted) return 0;
 	
+	u64 count = 0;
 	spinlock_acquire_or_wait(&_profiler_lock);
+	for (Profiler_Thread_Buffer *buffer = _profiler_thread_buffers; buffer && count < max_count; buffer = buffer->next) {
+		if (buffer->in_use && buffer->stats && buffer->stats->node_count > 1) {
+			out[count] = buffer->thread_id;
+			count += 1;
+		}
+	}
+	spinlock_release(&_profiler_lock);
+	
+	return count;
+}
+
+u64 _profiler_get_thread_stats(Profiler_Thread_Stats *stats, Profile_Scope_Stats *out, u64 max_count) {
+	u64 last_frame = profiler_frame_index-1;
+	u64 count = 0;
 	
-	string fmt = STR("{\"cat\":\"function\",\"dur\":%.3f,\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f},");
-    string_builder_print(
-        &_profile_output,
-        fmt,
-        (float64)(count * 1000000),  
-        name,                  
-        get_context().thread_id,
-        start * 1000000              
-    );
+	// Depth first walk
+	u32 index = stats->nodes[0].first_child;
+	while (index && count < max_count) {
+		Profile_Stat_Node *node = &stats->nodes[index];
+		Profile_Scope_Stats *s = &out[count];
+		count += 1;
+		
+		*s = ZERO(Profile_Scope_Stats);
+		s->name  = node->name;
+		s->depth = node->depth;
+		s->average_seconds = profiler_cycles_to_seconds((s64)node->average_cycles);
+		
+		if (node->frame_index == last_frame && node->frame_call_count > 0) {
+			// Frame finished but the node wasn't touched since, so it's not rolled yet
+			u64 self_cycles = node->frame_total_cycles - min(node->frame_child_cycles, node->frame_total_cycles);
+			s->call_count    = node->frame_call_count;
+			s->total_seconds = profiler_cycles_to_seconds(node->frame_total_cycles);
+			s->self_seconds  = profiler_cycles_to_seconds(self_cycles);
+			s->min_seconds   = profiler_cycles_to_seconds(node->frame_min_cycles);
+			s->max_seconds   = profiler_cycles_to_seconds(node->frame_max_cycles);
+			s->thread_cycles = node->frame_thread_cycles;
+		} else if (node->completed_frame_index == last_frame && node->call_count > 0) {
+			s->call_count    = node->call_count;
+			s->total_seconds = profiler_cycles_to_seconds(node->total_cycles);
+			s->self_seconds  = profiler_cycles_to_seconds(node->self_cycles);
+			s->min_seconds   = profiler_cycles_to_seconds(node->min_cycles);
+			s->max_seconds   = profiler_cycles_to_seconds(node->max_cycles);
+			s->thread_cycles = node->thread_cycles;
+		}
+		
+		if (node->first_child) {
+			index = node->first_child;
+		} else {
+			while (index && !stats->nodes[index].next_sibling) index = stats->nodes[index].parent;
+			if (index) index = stats->nodes[index].next_sibling;
+		}
+	}
+	
+	return count;
+}
+
+u64 profiler_get_stats(u64 thread_id, Profile_Scope_Stats *out, u64 max_count) {
+	if (!profiler_initted) return 0;
+	
+	spinlock_acquire_or_wait(&_profiler_lock);
+	Profiler_Thread_Buffer *buffer = _profiler_thread_buffers;
+	while (buffer && !(buffer->in_use && buffer->thread_id == thread_id)) buffer = buffer->next;
 	spinlock_release(&_profiler_lock);
+	
+	if (!buffer || !buffer->stats || buffer->stats->node_count <= 1) return 0;
+	
+	return _profiler_get_thread_stats(buffer->stats, out, max_count);
+}
+
+// cycles_event is the PROFILE_EVENT_SCOPE_THREAD_CYCLES following a scope event, or 0
+void _profiler_print_event_json(String_Builder *sb, Profile_Event *e, Profile_Event *cycles_event, u32 thread_id) {
+	switch (e->kind) {
+		case PROFILE_EVENT_SCOPE: {
+			if (cycles_event) {
+				string_builder_print(sb,
+					"{\"cat\":\"function\",\"dur\":%.3f,\"name\":\"%cs\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"thread_cycles\":%llu}},\n",
+					profiler_cycles_to_seconds((s64)(e->end_cycles-e->start_cycles))*1000000.0,
+					e->name,
+					thread_id,
+					profiler_cycles_to_timestamp(e->start_cycles)*1000000.0,
+					cycles_event->thread_cycles
+				);
+				break;
+			}
+			string_builder_print(sb,
+				"{\"cat\":\"function\",\"dur\":%.3f,\"name\":\"%cs\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f},\n",
+				profiler_cycles_to_seconds((s64)(e->end_cycles-e->start_cycles))*1000000.0,
+				e->name,
+				thread_id,
+				profiler_cycles_to_timestamp(e->start_cycles)*1000000.0
+			);
+			break;
+		}
+		case PROFILE_EVENT_LOCK_WAIT: {
+			string_builder_print(sb,
+				"{\"cat\":\"lock\",\"dur\":%.3f,\"name\":\"wait %cs\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f},\n",
+				profiler_cycles_to_seconds((s64)(e->end_cycles-e->start_cycles))*1000000.0,
+				e->name,
+				thread_id,
+				profiler_cycles_to_timestamp(e->start_cycles)*1000000.0
+			);
+			break;
+		}
+		case PROFILE_EVENT_VALUE: {
+			string_builder_print(sb,
+				"{\"name\":\"%cs\",\"ph\":\"C\",\"id\":%u,\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.3f}},\n",
+				e->name,
+				thread_id,
+				thread_id,
+				profiler_cycles_to_timestamp(e->start_cycles)*1000000.0,
+				e->value
+			);
+			break;
+		}
+		case PROFILE_EVENT_ALLOCATE:
+		case PROFILE_EVENT_DEALLOCATE:
+		case PROFILE_EVENT_REALLOCATE: {
+			local_persist const char *allocate_names[PROFILE_ALLOCATOR_KIND_COUNT]   = { "heap alloc", "talloc", "arena alloc" };
+			local_persist const char *deallocate_names[PROFILE_ALLOCATOR_KIND_COUNT] = { "heap free", "temporary free", "arena free" };
+			local_persist const char *reallocate_names[PROFILE_ALLOCATOR_KIND_COUNT] = { "heap realloc", "temporary realloc", "arena realloc" };
+			const char **names = e->kind == PROFILE_EVENT_ALLOCATE ? allocate_names : e->kind == PROFILE_EVENT_DEALLOCATE ? deallocate_names : reallocate_names;
+			string_builder_print(sb,
+				"{\"cat\":\"memory\",\"dur\":%.3f,\"name\":\"%cs\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"size\":%llu,\"tag\":\"%cs\"}},\n",
+				profiler_cycles_to_seconds((s64)e->duration_cycles)*1000000.0,
+				e->allocator < PROFILE_ALLOCATOR_KIND_COUNT ? names[e->allocator] : "alloc",
+				thread_id,
+				profiler_cycles_to_timestamp(e->start_cycles)*1000000.0,
+				e->size,
+				e->name ? e->name : ""
+			);
+			break;
+		}
+		default: break;
+	}
+}
+
+// Drains all thread buffers into the trace file. Only called by whoever owns _profiler_writer.
+void _profiler_write_pending_events() {
+	Profiler_Trace_Writer *w = &_profiler_writer;
+	
+	// The longest line we print is well below this
+	const u64 flush_threshold = w->sb.buffer_capacity - 1024;
+	
+	// Events are formatted under _profiler_lock, but the lock is released while writing so
+	// threads acquiring a buffer don't wait on the disk. When the string builder fills up we stop
+	// where we are, write it out and go again.
+	bool done = false;
+	while (!done) {
+		done = true;
+		
+		spinlock_acquire_or_wait(&_profiler_lock);
+		for (Profiler_Thread_Buffer *buffer = _profiler_thread_buffers; buffer && done; buffer = buffer->next) {
+			u64 write_count = buffer->write_count;
+			MEMORY_BARRIER;
+			
+			u64 i = buffer->read_count;
+			for (; i < write_count; i += 1) {
+				if (w->sb.count >= flush_threshold) {
+					done = false;
+					break;
+				}
+				
+				Profile_Event *e = &buffer->events[i % PROFILER_EVENTS_PER_THREAD];
+				Profile_Event *cycles_event = 0;
+				if (e->kind == PROFILE_EVENT_SCOPE && i+1 < write_count) {
+					Profile_Event *next = &buffer->events[(i+1) % PROFILER_EVENTS_PER_THREAD];
+					if (next->kind == PROFILE_EVENT_SCOPE_THREAD_CYCLES) {
+						cycles_event = next;
+						i += 1;
+					}
+				}
+				_profiler_print_event_json(&w->sb, e, cycles_event, (u32)buffer->thread_id);
+			}
+			
+			MEMORY_BARRIER;
+			buffer->read_count = i;
+		}
+		spinlock_release(&_profiler_lock);
+		
+		if (w->sb.count > 0) {
+			os_file_write_string(w->file, w->sb.result);
+			w->sb.count = 0;
+		}
+	}
 }
+
+void _profiler_writer_thread_proc(Thread *t) {
+	// Never record anything on this thread, it holds _profiler_lock while formatting events
+	_profiler_acquiring_thread_buffer = true;
+	
+	while (_profiler_writer.running) {
+		os_sleep(PROFILER_WRITE_INTERVAL_MS);
+		_profiler_write_pending_events();
+	}
+}
+
+void profiler_start_trace_writer() {
+	if (_profiler_writer.running) return;
+	
+	profiler_init();
+	
+	Profiler_Trace_Writer *w = &_profiler_writer;
+	
+	w->file = os_file_open("google_trace.json", O_CREATE | O_WRITE);
+	if (w->file == OS_INVALID_FILE) {
+		log_error("Could not open google_trace.json for writing, profiling events will not be written");
+		return;
+	}
+	os_file_write_string(w->file, STR("["));
+	
+	string_builder_init_reserve(&w->sb, PROFILER_WRITE_BUFFER_SIZE, get_heap_allocator());
+	
+	w->running = true;
+	os_thread_init(&w->thread, _profiler_writer_thread_proc);
+	os_thread_start(&w->thread);
+}
+
+void dump_profile_result() {
+	if (!profiler_initted) return;
+	
+	// In case profiling was used without the writer running, we still want the file
+	if (!_profiler_writer.running) profiler_start_trace_writer();
+	if (!_profiler_writer.running) return;
+	
+	Profiler_Trace_Writer *w = &_profiler_writer;
+	
+	w->running = false;
+	os_thread_join(&w->thread);
+	os_thread_destroy(&w->thread);
+	
+	_profiler_write_pending_events();
+
+	os_file_write_string(w->file, STR("{}]"));
+	os_file_close(w->file);
+
+	string_builder_deinit(&w->sb);
+	
+	u64 dropped_count = 0;
+	for (Profiler_Thread_Buffer *buffer = _profiler_thread_buffers; buffer; buffer = buffer->next) {
+		dropped_count += buffer->dropped_count;
+	}
+
+	if (dropped_count > 0) {
+		log_warning("Profiler buffers were full, %llu events were dropped. You can increase PROFILER_EVENTS_PER_THREAD or decrease PROFILER_WRITE_INTERVAL_MS.", dropped_count);
+	}
+	log_verbose("Wrote profiling result to google_trace.json");
+}
+
+void profiler_capture_start() {
+	_profiler_capture_end_frame = 0;
+	profiler_capturing = true;
+}
+void profiler_capture_stop() {
+	_profiler_capture_end_frame = 0;
+	profiler_capturing = false;
+}
+void profiler_capture_frames(u64 frame_count) {
+	_profiler_capture_end_frame = profiler_frame_index + frame_count;
+	profiler_capturing = true;
+}
+
+// Called by os_update() at the start of each frame
+void profiler_new_frame() {
+	profiler_frame_index += 1;
+	_profiler_frame_start_cycles = rdtsc();
+	
+	if (_profiler_capture_end_frame != 0 && profiler_frame_index >= _profiler_capture_end_frame) {
+		profiler_capture_stop();
+	}
+}
+
+// Not conditional on ENABLE_PROFILING so it can be used in tests
+#if PROFILER_THREAD_CYCLES
+#define _profiler_scope(name) \
+    for (u64 _tm_depth = _profiler_scope_begin(name, &_tm_depth), _tm_start_thread_cycles = os_get_thread_cycles(), _tm_start_cycles = rdtsc(), _tm_done = 0; \
+         !_tm_done; \
+         _tm_done = 1, _profiler_scope_end_with_thread_cycles(name, _tm_start_cycles, rdtsc(), _tm_depth, os_get_thread_cycles()-_tm_start_thread_cycles))
+#else
+#define _profiler_scope(name) \
+    for (u64 _tm_depth = _profiler_scope_begin(name, &_tm_depth), _tm_start_cycles = rdtsc(), _tm_done = 0; \
+         !_tm_done; \
+         _tm_done = 1, _profiler_scope_end(name, _tm_start_cycles, rdtsc(), _tm_depth))
+#endif
+
 #if ENABLE_PROFILING
-#define tm_scope(name) \
-    for (f64 start_time = os_get_elapsed_seconds(), end_time = start_time, elapsed_time = 0; \
-         elapsed_time == 0; \
-         elapsed_time = (end_time = os_get_elapsed_seconds()) - start_time, _profiler_report_time(STR(name), elapsed_time, start_time))
+#define tm_scope(name) _profiler_scope(name)
+#define tm_counter(name, value) _profiler_counter_add(name, (f64)(value))
+#define tm_gauge(name, value) _profiler_record_value(name, (f64)(value), rdtsc())
+// Used in the allocators, tm_allocation_begin() declares the start time for tm_allocation_end()
+#define tm_allocation_begin() u64 _tm_allocation_start_cycles = profiler_recording_allocations ? rdtsc() : 0
+#define tm_allocation_end(kind, allocator, size) \
+    do { if (_tm_allocation_start_cycles) _profiler_record_allocation(kind, allocator, size, _tm_allocation_start_cycles, rdtsc()); } while(0)
+#define tm_allocation_tag(tag) \
+    for (const char *_tm_previous_tag = _profiler_allocation_tag, *_tm_done = (_profiler_allocation_tag = (tag), (const char*)0); \
+         !_tm_done; \
+         _tm_done = (const char*)1, _profiler_allocation_tag = _tm_previous_tag)
 #define tm_scope_var(name, var) \
     for (f64 start_time = os_get_elapsed_seconds(), end_time = start_time, elapsed_time = 0; \
          elapsed_time == 0; \
@@ -59,6 +979,11 @@ void _profiler_report_time(string name, f64 count, f64 start) {
          elapsed_time = (end_time = os_get_elapsed_seconds()) - start_time, var+=elapsed_time)
 #else
 	#define tm_scope(...)
+	#define tm_counter(...)
+	#define tm_gauge(...)
+	#define tm_allocation_begin()
+	#define tm_allocation_end(...)
+	#define tm_allocation_tag(...)
 	#define tm_scope_var(...)
 	#define tm_scope_accum(...)
-#endif
\ No newline at end of file
+#endif
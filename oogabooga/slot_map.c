@@ -0,0 +1,364 @@
+
+// Slot map.
+// Values are kept densely packed in one array so iterating them is a linear walk, and each value
+// is given a Slot_Map_Handle which stays valid until that value is removed, no matter what else
+// is added or removed. Adding, removing and looking up by handle are all O(1).
+// Handles index into an array of slots, which point to where the value currently is in the dense
+// array. Each slot has a generation which is bumped when its value is removed, so a handle to a
+// removed value stops matching even after the slot is reused.
+
+/*
+
+	Example Usage:
+
+
+	Slot_Map things = make_slot_map(Thing, get_heap_allocator());
+
+	Thing thing = ...;
+	Slot_Map_Handle h = slot_map_add(&things, &thing); // 'thing' is copied
+
+	// Or fill it in directly
+	Slot_Map_Handle h2;
+	Thing *new_thing = slot_map_add_empty(&things, &h2);
+
+	// Null if the value was removed
+	Thing *t = slot_map_get(&things, h);
+
+	bool exists = slot_map_contains(&things, h);
+
+	// Returns false if the value was already removed.
+	// Moves the last value into the removed one's place.
+	bool removed = slot_map_remove(&things, h);
+
+	// Keeps the order values were added in, but moves every value after the removed one
+	bool removed = slot_map_remove_ordered(&things, h);
+
+	for (u64 i = 0; i < things.count; i += 1) {
+		Thing *t = (Thing*)things.values + i; // Or slot_map_get_nth(&things, i)
+		Slot_Map_Handle h = things.handles[i];
+	}
+
+	// Remove all values. Every handle is invalidated, but memory is kept.
+	slot_map_clear(&things);
+
+	slot_map_reserve(&things, 1024);
+
+	slot_map_destroy(&things);
+
+
+	Typed slot maps:
+
+		DEFINE_SLOT_MAP(Thing_Map, Thing);
+
+		Makes inline functions which copy whole Things instead of using memcpy with the value
+		size. The map has the same fields, but values is a Thing*.
+
+		Thing_Map things;
+		Thing_Map_init(&things, get_heap_allocator());
+
+		Slot_Map_Handle h = Thing_Map_add(&things, thing); // thing doesn't need to be an lvalue
+		Thing *new_thing  = Thing_Map_add_empty(&things, &h);
+		Thing *t          = Thing_Map_get(&things, h);
+		bool exists       = Thing_Map_contains(&things, h);
+		bool removed      = Thing_Map_remove(&things, h);
+		removed           = Thing_Map_remove_ordered(&things, h);
+
+		for (u64 i = 0; i < things.count; i += 1) {
+			Thing *t = &things.values[i];
+		}
+
+		Thing_Map_reserve(&things, 1024);
+		Thing_Map_clear(&things);
+		Thing_Map_destroy(&things);
+
+
+	Notes:
+		- A zero initialized Slot_Map_Handle is never valid.
+		- Pointers to values are invalidated by adding (if it grows) and by removing (the last
+		  value, or every value after the removed one for slot_map_remove_ordered). Keep handles,
+		  not pointers.
+		- To remove while iterating, iterate backwards. slot_map_remove moves the last value into
+		  the removed value's place, which has then already been visited.
+		- Generations are 32 bits, so a handle could match again after its slot has been reused
+		  about 2 billion times.
+
+*/
+
+typedef struct Slot_Map_Handle {
+	u32 index;      // Slot index, not where the value is in values
+	u32 generation;
+} Slot_Map_Handle;
+
+// The generation is odd while the slot has a value and even while it's free, so handles (which
+// always have odd generations) never match a free slot, and a zeroed handle never matches
+// anything. Free slots are linked by dense_index.
+typedef struct Slot_Map_Slot {
+	u32 dense_index;
+	u32 generation;
+} Slot_Map_Slot;
+
+#define SLOT_MAP_NO_FREE_SLOT UINT32_MAX
+
+typedef struct Slot_Map {
+	void *values;             // count values, densely packed
+	Slot_Map_Handle *handles; // Handle of each value in values
+	u64 count;
+
+	// values, handles and _slots are all allocated for this many. There are never more slots
+	// than the most values there have been at once, so that's enough for slots too.
+	u64 capacity_count;
+
+	Slot_Map_Slot *_slots;
+	u64 _slot_count;
+	u32 _first_free_slot;
+
+	u64 _value_size;
+
+	Allocator allocator;
+} Slot_Map;
+
+// The parts of the slot map which don't depend on the value type, so they're shared with the
+// maps made with DEFINE_SLOT_MAP.
+
+void _slot_map_reserve(void **values, Slot_Map_Handle **handles, Slot_Map_Slot **slots, u64 *capacity_count, u64 value_size, u64 required_count, Allocator allocator) {
+	if (*capacity_count >= required_count) return;
+
+	assert(required_count <= UINT32_MAX, "Slot map can't hold more than %u values", UINT32_MAX);
+
+	u64 new_capacity = max(*capacity_count*2, 8);
+	new_capacity = max(new_capacity, required_count);
+	new_capacity = min(new_capacity, (u64)UINT32_MAX);
+
+	u64 old_capacity = *capacity_count;
+	*values  = reallocate(allocator, *values,  old_capacity*value_size,              new_capacity*value_size);
+	*handles = reallocate(allocator, *handles, old_capacity*sizeof(Slot_Map_Handle), new_capacity*sizeof(Slot_Map_Handle));
+	*slots   = reallocate(allocator, *slots,   old_capacity*sizeof(Slot_Map_Slot),   new_capacity*sizeof(Slot_Map_Slot));
+
+	*capacity_count = new_capacity;
+}
+
+// Takes a slot for a value which will be at dense_index and returns its handle
+inline Slot_Map_Handle
+_slot_map_take_slot(Slot_Map_Slot *slots, u64 *slot_count, u32 *first_free_slot, u64 dense_index) {
+	u32 index;
+	if (*first_free_slot != SLOT_MAP_NO_FREE_SLOT) {
+		index = *first_free_slot;
+		*first_free_slot = slots[index].dense_index;
+	} else {
+		index = (u32)*slot_count;
+		*slot_count += 1;
+		slots[index].generation = 0;
+	}
+
+	Slot_Map_Slot *slot = &slots[index];
+	slot->generation += 1;
+	slot->dense_index = (u32)dense_index;
+
+	return (Slot_Map_Handle){ index, slot->generation };
+}
+
+inline void
+_slot_map_free_slot(Slot_Map_Slot *slots, u32 *first_free_slot, u32 index) {
+	slots[index].generation += 1;
+	slots[index].dense_index = *first_free_slot;
+	*first_free_slot = index;
+}
+
+// Dense index of the value for h, -1 if it was removed
+inline s64
+_slot_map_find(Slot_Map_Slot *slots, u64 slot_count, Slot_Map_Handle h) {
+	if (h.index >= slot_count) return -1;
+	Slot_Map_Slot slot = slots[h.index];
+	if (slot.generation != h.generation) return -1;
+	return slot.dense_index;
+}
+
+void _slot_map_clear(Slot_Map_Handle *handles, u64 *count, Slot_Map_Slot *slots, u32 *first_free_slot) {
+	for (u64 i = 0; i < *count; i += 1) {
+		_slot_map_free_slot(slots, first_free_slot, handles[i].index);
+	}
+	*count = 0;
+}
+
+// Removes the value at dense_index by moving the last value into its place
+inline void
+_slot_map_remove_at(void *values, Slot_Map_Handle *handles, u64 *count, Slot_Map_Slot *slots, u32 *first_free_slot, u64 value_size, u64 dense_index) {
+	_slot_map_free_slot(slots, first_free_slot, handles[dense_index].index);
+
+	u64 last = *count - 1;
+	if (dense_index != last) {
+		memcpy((u8*)values + dense_index*value_size, (u8*)values + last*value_size, value_size);
+		handles[dense_index] = handles[last];
+		slots[handles[dense_index].index].dense_index = (u32)dense_index;
+	}
+
+	*count -= 1;
+}
+
+// Removes the value at dense_index by moving every value after it one step back
+void _slot_map_remove_ordered_at(void *values, Slot_Map_Handle *handles, u64 *count, Slot_Map_Slot *slots, u32 *first_free_slot, u64 value_size, u64 dense_index) {
+	_slot_map_free_slot(slots, first_free_slot, handles[dense_index].index);
+
+	u64 after = *count - dense_index - 1;
+	memmove((u8*)values + dense_index*value_size, (u8*)values + (dense_index+1)*value_size, after*value_size);
+	memmove(handles + dense_index, handles + dense_index + 1, after*sizeof(Slot_Map_Handle));
+
+	*count -= 1;
+
+	for (u64 i = dense_index; i < *count; i += 1) {
+		slots[handles[i].index].dense_index = (u32)i;
+	}
+}
+
+void _slot_map_destroy(void **values, Slot_Map_Handle **handles, Slot_Map_Slot **slots, Allocator allocator) {
+	if (*values)  dealloc(allocator, *values);
+	if (*handles) dealloc(allocator, *handles);
+	if (*slots)   dealloc(allocator, *slots);
+	*values  = 0;
+	*handles = 0;
+	*slots   = 0;
+}
+
+// API:
+#define make_slot_map(Value_Type, allocator) make_slot_map_raw(sizeof(Value_Type), allocator)
+
+Slot_Map make_slot_map_raw(u64 value_size, Allocator allocator) {
+	Slot_Map map = ZERO(Slot_Map);
+	map._value_size = value_size;
+	map._first_free_slot = SLOT_MAP_NO_FREE_SLOT;
+	map.allocator = allocator;
+	return map;
+}
+
+void slot_map_reserve(Slot_Map *map, u64 required_count) {
+	_slot_map_reserve(&map->values, &map->handles, &map->_slots, &map->capacity_count, map->_value_size, required_count, map->allocator);
+}
+
+void slot_map_destroy(Slot_Map *map) {
+	_slot_map_destroy(&map->values, &map->handles, &map->_slots, map->allocator);
+	map->count = 0;
+	map->capacity_count = 0;
+	map->_slot_count = 0;
+	map->_first_free_slot = SLOT_MAP_NO_FREE_SLOT;
+}
+
+void slot_map_clear(Slot_Map *map) {
+	_slot_map_clear(map->handles, &map->count, map->_slots, &map->_first_free_slot);
+}
+
+void *slot_map_add_empty(Slot_Map *map, Slot_Map_Handle *handle_out) {
+	slot_map_reserve(map, map->count+1);
+
+	Slot_Map_Handle h = _slot_map_take_slot(map->_slots, &map->_slot_count, &map->_first_free_slot, map->count);
+	map->handles[map->count] = h;
+
+	void *value = (u8*)map->values + map->count*map->_value_size;
+	map->count += 1;
+
+	if (handle_out) *handle_out = h;
+	return value;
+}
+Slot_Map_Handle slot_map_add(Slot_Map *map, void *value) {
+	Slot_Map_Handle h;
+	void *new_value = slot_map_add_empty(map, &h);
+	memcpy(new_value, value, map->_value_size);
+	return h;
+}
+
+inline void *
+slot_map_get(Slot_Map *map, Slot_Map_Handle h) {
+	s64 dense_index = _slot_map_find(map->_slots, map->_slot_count, h);
+	if (dense_index < 0) return 0;
+	return (u8*)map->values + dense_index*map->_value_size;
+}
+inline bool
+slot_map_contains(Slot_Map *map, Slot_Map_Handle h) {
+	return _slot_map_find(map->_slots, map->_slot_count, h) >= 0;
+}
+inline void *
+slot_map_get_nth(Slot_Map *map, u64 n) {
+	assert(n < map->count, "Slot map index out of range");
+	return (u8*)map->values + n*map->_value_size;
+}
+
+bool slot_map_remove(Slot_Map *map, Slot_Map_Handle h) {
+	s64 dense_index = _slot_map_find(map->_slots, map->_slot_count, h);
+	if (dense_index < 0) return false;
+	_slot_map_remove_at(map->values, map->handles, &map->count, map->_slots, &map->_first_free_slot, map->_value_size, dense_index);
+	return true;
+}
+bool slot_map_remove_ordered(Slot_Map *map, Slot_Map_Handle h) {
+	s64 dense_index = _slot_map_find(map->_slots, map->_slot_count, h);
+	if (dense_index < 0) return false;
+	_slot_map_remove_ordered_at(map->values, map->handles, &map->count, map->_slots, &map->_first_free_slot, map->_value_size, dense_index);
+	return true;
+}
+
+#define DEFINE_SLOT_MAP(Name, Type) \
+	typedef struct Name { \
+		Type *values; \
+		Slot_Map_Handle *handles; \
+		u64 count; \
+		u64 capacity_count; \
+		Slot_Map_Slot *_slots; \
+		u64 _slot_count; \
+		u32 _first_free_slot; \
+		Allocator allocator; \
+	} Name; \
+	\
+	void Name##_reserve(Name *m, u64 required_count) { \
+		_slot_map_reserve((void**)&m->values, &m->handles, &m->_slots, &m->capacity_count, sizeof(Type), required_count, m->allocator); \
+	} \
+	void Name##_init(Name *m, Allocator allocator) { \
+		*m = ZERO(Name); \
+		m->_first_free_slot = SLOT_MAP_NO_FREE_SLOT; \
+		m->allocator = allocator; \
+	} \
+	void Name##_destroy(Name *m) { \
+		_slot_map_destroy((void**)&m->values, &m->handles, &m->_slots, m->allocator); \
+		Name##_init(m, m->allocator); \
+	} \
+	void Name##_clear(Name *m) { \
+		_slot_map_clear(m->handles, &m->count, m->_slots, &m->_first_free_slot); \
+	} \
+	inline Type *Name##_add_empty(Name *m, Slot_Map_Handle *handle_out) { \
+		if (m->count == m->capacity_count) Name##_reserve(m, m->count+1); \
+		Slot_Map_Handle h = _slot_map_take_slot(m->_slots, &m->_slot_count, &m->_first_free_slot, m->count); \
+		m->handles[m->count] = h; \
+		Type *value = &m->values[m->count]; \
+		m->count += 1; \
+		if (handle_out) *handle_out = h; \
+		return value; \
+	} \
+	inline Slot_Map_Handle Name##_add(Name *m, Type value) { \
+		Slot_Map_Handle h; \
+		*Name##_add_empty(m, &h) = value; \
+		return h; \
+	} \
+	inline Type *Name##_get(Name *m, Slot_Map_Handle h) { \
+		s64 dense_index = _slot_map_find(m->_slots, m->_slot_count, h); \
+		if (dense_index < 0) return 0; \
+		return &m->values[dense_index]; \
+	} \
+	inline bool Name##_contains(Name *m, Slot_Map_Handle h) { \
+		return _slot_map_find(m->_slots, m->_slot_count, h) >= 0; \
+	} \
+	inline bool Name##_remove(Name *m, Slot_Map_Handle h) { \
+		s64 dense_index = _slot_map_find(m->_slots, m->_slot_count, h); \
+		if (dense_index < 0) return false; \
+		_slot_map_free_slot(m->_slots, &m->_first_free_slot, h.index); \
+		u64 last = m->count - 1; \
+		if ((u64)dense_index != last) { \
+			m->values[dense_index] = m->values[last]; \
+			m->handles[dense_index] = m->handles[last]; \
+			m->_slots[m->handles[dense_index].index].dense_index = (u32)dense_index; \
+		} \
+		m->count -= 1; \
+		return true; \
+	} \
+	bool Name##_remove_ordered(Name *m, Slot_Map_Handle h) { \
+		s64 dense_index = _slot_map_find(m->_slots, m->_slot_count, h); \
+		if (dense_index < 0) return false; \
+		_slot_map_remove_ordered_at(m->values, m->handles, &m->count, m->_slots, &m->_first_free_slot, sizeof(Type), dense_index); \
+		return true; \
+	}
@@ -98,12 +98,326 @@ string_view(string s, u64 start_index, u64 count) {
 	return result;
 }
 
+///
+// Searching
+// These compare a block of bytes at a time with SSE2 (16) or AVX2 (32) and fall back to plain
+// loops for the bytes at the end, or everywhere when SIMD is disabled.
+// Substring search only checks the positions where both the first and the last byte of sub
+// match, which filters out nearly everything in real text. Without SIMD, long subs use
+// Boyer-Moore-Horspool instead, which can skip up to sub.count bytes at a time (with SIMD, the
+// filter was faster even for long subs).
+// Both can compare most of sub at nearly every position in repetitive text ("aaa...b...aaa" in
+// "aaaa..."), so once that happens more than a few times per sub.count bytes of s, the rest is
+// searched with the two-way algorithm, which is linear in s.count + sub.count.
+
+#if SIMD_ENABLE_AVX2
+	#define STRING_SIMD_BLOCK_SIZE 32
+#elif SIMD_ENABLE_SSE2
+	#define STRING_SIMD_BLOCK_SIZE 16
+#else
+	#define STRING_SIMD_BLOCK_SIZE 0
+#endif
+
+#define STRING_FIND_HORSPOOL_MIN_COUNT 32
+// Positions that can be compared in full without a match, per sub.count bytes of s, before
+// switching to two-way
+#define STRING_FIND_FALSE_CANDIDATES_PER_SUB 4
+// find_any_of compares each block to every byte in the set up to this many, and looks up a table
+// per byte for bigger sets
+#define STRING_FIND_ANY_OF_SIMD_MAX_SET_COUNT 8
+
+#if STRING_SIMD_BLOCK_SIZE
+// Bit i is set if p[i] == c, for STRING_SIMD_BLOCK_SIZE bytes
+inline u32 
+_string_match_block(const u8 *p, u8 c) {
+#if SIMD_ENABLE_AVX2
+	__m256i block = _mm256_loadu_si256((const __m256i*)p);
+	return (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8((char)c)));
+#else
+	__m128i block = _mm_loadu_si128((const __m128i*)p);
+	return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8((char)c)));
+#endif
+}
+inline u32 
+_string_highest_bit(u32 mask) {
+	return 63 - count_leading_zeros_64((u64)mask);
+}
+#endif
+
+// Returns first index of c in s. Returns -1 if c isn't in s.
+s64 
+string_find_char(string s, u8 c) {
+	u64 i = 0;
+#if STRING_SIMD_BLOCK_SIZE
+	for (; i + STRING_SIMD_BLOCK_SIZE <= s.count; i += STRING_SIMD_BLOCK_SIZE) {
+		u32 match = _string_match_block(s.data + i, c);
+		if (match) return (s64)(i + count_trailing_zeros_32(match));
+	}
+#endif
+	for (; i < s.count; i++) {
+		if (s.data[i] == c) return (s64)i;
+	}
+	return -1;
+}
+
+// Returns last index of c in s. Returns -1 if c isn't in s.
+s64 
+string_find_char_from_right(string s, u8 c) {
+	u64 end = s.count;
+#if STRING_SIMD_BLOCK_SIZE
+	for (; end >= STRING_SIMD_BLOCK_SIZE; end -= STRING_SIMD_BLOCK_SIZE) {
+		u32 match = _string_match_block(s.data + end - STRING_SIMD_BLOCK_SIZE, c);
+		if (match) return (s64)(end - STRING_SIMD_BLOCK_SIZE + _string_highest_bit(match));
+	}
+#endif
+	for (; end > 0; end--) {
+		if (s.data[end-1] == c) return (s64)(end-1);
+	}
+	return -1;
+}
+
+// Returns how many times c is in s
+u64 
+string_count_char(string s, u8 c) {
+	u64 count = 0;
+	u64 i = 0;
+#if SIMD_ENABLE_AVX2
+	// Each matching byte is -1, so subtracting the compare counts per byte. A byte can count to
+	// 255 before it wraps, then the bytes are summed with sad.
+	__m256i needle = _mm256_set1_epi8((char)c);
+	while (i + 32 <= s.count) {
+		__m256i counts = _mm256_setzero_si256();
+		for (u64 n = 0; n < 255 && i + 32 <= s.count; n += 1, i += 32) {
+			__m256i block = _mm256_loadu_si256((const __m256i*)(s.data + i));
+			counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(block, needle));
+		}
+		__m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+		__m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+		count += (u64)_mm_cvtsi128_si32(sum) + (u64)_mm_extract_epi16(sum, 4);
+	}
+#elif SIMD_ENABLE_SSE2
+	// Each matching byte is -1, so subtracting the compare counts per byte. A byte can count to
+	// 255 before it wraps, then the bytes are summed with sad.
+	__m128i needle = _mm_set1_epi8((char)c);
+	while (i + 16 <= s.count) {
+		__m128i counts = _mm_setzero_si128();
+		for (u64 n = 0; n < 255 && i + 16 <= s.count; n += 1, i += 16) {
+			__m128i block = _mm_loadu_si128((const __m128i*)(s.data + i));
+			counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(block, needle));
+		}
+		__m128i sum = _mm_sad_epu8(counts, _mm_setzero_si128());
+		count += (u64)_mm_cvtsi128_si32(sum) + (u64)_mm_extract_epi16(sum, 4);
+	}
+#endif
+	for (; i < s.count; i++) {
+		count += s.data[i] == c;
+	}
+	return count;
+}
+
+// Returns first index in s of any of the bytes in set. Returns -1 if none of them are in s.
+s64 
+string_find_any_of(string s, string set) {
+	if (set.count == 0) return -1;
+	if (set.count == 1) return string_find_char(s, set.data[0]);
+	
+	u64 i = 0;
+#if STRING_SIMD_BLOCK_SIZE
+	if (set.count <= STRING_FIND_ANY_OF_SIMD_MAX_SET_COUNT) {
+		for (; i + STRING_SIMD_BLOCK_SIZE <= s.count; i += STRING_SIMD_BLOCK_SIZE) {
+			u32 match = 0;
+			for (u64 j = 0; j < set.count; j++) {
+				match |= _string_match_block(s.data + i, set.data[j]);
+			}
+			if (match) return (s64)(i + count_trailing_zeros_32(match));
+		}
+	}
+#endif
+	
+	bool in_set[256] = {0};
+	for (u64 j = 0; j < set.count; j++) in_set[set.data[j]] = true;
+	for (; i < s.count; i++) {
+		if (in_set[s.data[i]]) return (s64)i;
+	}
+	return -1;
+}
+
+inline u64 
+_string_find_false_candidate_budget(string s, string sub) {
+	return STRING_FIND_FALSE_CANDIDATES_PER_SUB*(s.count/sub.count) + 16;
+}
+
+// Byte i of s, counting from the end if from_right
+inline u8 
+_string_byte(string s, u64 i, bool from_right) {
+	return from_right ? s.data[s.count-1-i] : s.data[i];
+}
+
+// Two-way string matching (Crochemore & Perrin). from_right searches reversed s for reversed sub.
+// sub.count > 0
+s64 
+_string_find_two_way(string s, string sub, bool from_right) {
+	u64 n = sub.count;
+	if (n > s.count) return -1;
+	
+	// Critical factorization of sub, from the larger of its maximal suffixes for the two
+	// byte orders. Starting at -1 (wrapping) means the empty suffix.
+	u64 suffix[2];
+	u64 periods[2];
+	for (u64 order = 0; order < 2; order++) {
+		u64 max_suffix = (u64)-1;
+		u64 j = 0, k = 1, p = 1;
+		while (j + k < n) {
+			u8 a = _string_byte(sub, j + k, from_right);
+			u8 b = _string_byte(sub, max_suffix + k, from_right);
+			if (order ? b < a : a < b) {
+				j += k;
+				k = 1;
+				p = j - max_suffix;
+			} else if (a == b) {
+				if (k != p) k++;
+				else {
+					j += p;
+					k = 1;
+				}
+			} else {
+				max_suffix = j++;
+				k = p = 1;
+			}
+		}
+		suffix[order] = max_suffix + 1;
+		periods[order] = p;
+	}
+	u64 order = suffix[1] >= suffix[0];
+	u64 split = suffix[order];
+	u64 period = periods[order];
+	
+	bool periodic = true;
+	for (u64 i = 0; i < split && periodic; i++) {
+		periodic = _string_byte(sub, i, from_right) == _string_byte(sub, i + period, from_right);
+	}
+	
+	u64 last_start = s.count - n;
+	u64 j = 0;
+	if (periodic) {
+		// Bytes of sub before this are known to match after shifting by the period
+		u64 memory = 0;
+		while (j <= last_start) {
+			u64 i = max(split, memory);
+			while (i < n && _string_byte(sub, i, from_right) == _string_byte(s, i + j, from_right)) i++;
+			if (i >= n) {
+				i = split;
+				while (i > memory && _string_byte(sub, i - 1, from_right) == _string_byte(s, i - 1 + j, from_right)) i--;
+				if (i <= memory) return from_right ? (s64)(s.count - n - j) : (s64)j;
+				j += period;
+				memory = n - period;
+			} else {
+				j += i - split + 1;
+				memory = 0;
+			}
+		}
+	} else {
+		period = max(split, n - split) + 1;
+		while (j <= last_start) {
+			u64 i = split;
+			while (i < n && _string_byte(sub, i, from_right) == _string_byte(s, i + j, from_right)) i++;
+			if (i >= n) {
+				i = split;
+				while (i > 0 && _string_byte(sub, i - 1, from_right) == _string_byte(s, i - 1 + j, from_right)) i--;
+				if (i == 0) return from_right ? (s64)(s.count - n - j) : (s64)j;
+				j += period;
+			} else {
+				j += i - split + 1;
+			}
+		}
+	}
+	
+	return -1;
+}
+
+// Two-way search in s after start (from left) or before start (from right), with indices in s
+s64 
+_string_find_two_way_past(string s, string sub, u64 start, bool from_right) {
+	if (from_right) {
+		string before = {start + sub.count - 1, s.data};
+		return _string_find_two_way(before, sub, true);
+	}
+	string after = {s.count - start - 1, s.data + start + 1};
+	s64 index = _string_find_two_way(after, sub, false);
+	return index < 0 ? -1 : index + (s64)start + 1;
+}
+
+// sub.count > 1 and sub.count <= s.count
+s64 
+_string_find_horspool(string s, string sub, bool from_right) {
+	u64 last_start = s.count - sub.count;
+	
+	// How far the window can move when the byte we look at (last byte of the window from the
+	// left, first byte from the right) is c, so that it lines up with the nearest c in sub
+	u64 shift[256];
+	for (u64 c = 0; c < 256; c++) shift[c] = sub.count;
+	u64 budget = _string_find_false_candidate_budget(s, sub);
+	
+	if (from_right) {
+		for (u64 k = sub.count-1; k > 0; k--) shift[sub.data[k]] = k;
+		
+		u64 i = last_start;
+		while (true) {
+			u8 c = s.data[i];
+			if (c == sub.data[0]) {
+				if (memcmp(s.data + i + 1, sub.data + 1, sub.count - 1) == 0) return (s64)i;
+				if (budget-- == 0) return _string_find_two_way_past(s, sub, i, true);
+			}
+			if (i < shift[c]) break;
+			i -= shift[c];
+		}
+	} else {
+		for (u64 k = 0; k < sub.count-1; k++) shift[sub.data[k]] = sub.count-1-k;
+		
+		u64 i = 0;
+		while (i <= last_start) {
+			u8 c = s.data[i + sub.count - 1];
+			if (c == sub.data[sub.count-1]) {
+				if (memcmp(s.data + i, sub.data, sub.count - 1) == 0) return (s64)i;
+				if (budget-- == 0) return _string_find_two_way_past(s, sub, i, false);
+			}
+			i += shift[c];
+		}
+	}
+	
+	return -1;
+}
+
 // Returns first index from left where "sub" matches in "s". Returns -1 if no match is found.
 s64 
 string_find_from_left(string s, string sub) {
-	for (s64 i = 0; i <= s.count-sub.count; i++) {
-		if (strings_match(string_view(s, i, sub.count), sub)) {
-			return i;
+	if (sub.count == 0) return 0;
+	if (sub.count > s.count) return -1;
+	if (sub.count == 1) return string_find_char(s, sub.data[0]);
+#if !STRING_SIMD_BLOCK_SIZE
+	if (sub.count >= STRING_FIND_HORSPOOL_MIN_COUNT) return _string_find_horspool(s, sub, false);
+#endif
+	
+	u8 first = sub.data[0];
+	u8 last = sub.data[sub.count-1];
+	u64 last_start = s.count - sub.count;
+	
+	u64 i = 0;
+#if STRING_SIMD_BLOCK_SIZE
+	u64 budget = _string_find_false_candidate_budget(s, sub);
+	for (; i + STRING_SIMD_BLOCK_SIZE - 1 <= last_start; i += STRING_SIMD_BLOCK_SIZE) {
+		u32 match = _string_match_block(s.data + i, first) & _string_match_block(s.data + i + sub.count - 1, last);
+		while (match) {
+			u64 start = i + count_trailing_zeros_32(match);
+			if (memcmp(s.data + start + 1, sub.data + 1, sub.count - 2) == 0) return (s64)start;
+			if (budget-- == 0) return _string_find_two_way_past(s, sub, start, false);
+			match &= match - 1;
+		}
+	}
+#endif
+	for (; i <= last_start; i++) {
+		if (s.data[i] == first && s.data[i + sub.count - 1] == last && memcmp(s.data + i + 1, sub.data + 1, sub.count - 2) == 0) {
+			return (s64)i;
 		}
 	}
 	
@@ -113,9 +427,36 @@ string_find_from_left(string s, string sub) {
 // Returns first index from right where "sub" matches in "s" Returns -1 if no match is found.
 s64 
 string_find_from_right(string s, string sub) {
-	for (s64 i = s.count-sub.count; i >= 0 ; i--) {
-		if (strings_match(string_view(s, i, sub.count), sub)) {
-			return i;
+	if (sub.count == 0) return (s64)s.count;
+	if (sub.count > s.count) return -1;
+	if (sub.count == 1) return string_find_char_from_right(s, sub.data[0]);
+#if !STRING_SIMD_BLOCK_SIZE
+	if (sub.count >= STRING_FIND_HORSPOOL_MIN_COUNT) return _string_find_horspool(s, sub, true);
+#endif
+	
+	u8 first = sub.data[0];
+	u8 last = sub.data[sub.count-1];
+	
+	// Starts before end are left to check
+	u64 end = s.count - sub.count + 1;
+#if STRING_SIMD_BLOCK_SIZE
+	u64 budget = _string_find_false_candidate_budget(s, sub);
+	for (; end >= STRING_SIMD_BLOCK_SIZE; end -= STRING_SIMD_BLOCK_SIZE) {
+		u64 i = end - STRING_SIMD_BLOCK_SIZE;
+		u32 match = _string_match_block(s.data + i, first) & _string_match_block(s.data + i + sub.count - 1, last);
+		while (match) {
+			u32 bit = _string_highest_bit(match);
+			u64 start = i + bit;
+			if (memcmp(s.data + start + 1, sub.data + 1, sub.count - 2) == 0) return (s64)start;
+			if (budget-- == 0) return _string_find_two_way_past(s, sub, start, true);
+			match &= ~(1u << bit);
+		}
+	}
+#endif
+	for (; end > 0; end--) {
+		u64 i = end - 1;
+		if (s.data[i] == first && s.data[i + sub.count - 1] == last && memcmp(s.data + i + 1, sub.data + 1, sub.count - 2) == 0) {
+			return (s64)i;
 		}
 	}
 	
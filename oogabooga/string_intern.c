@@ -0,0 +1,267 @@
+
+// String interning.
+// Each unique string is copied once into the interner's storage and given an Interned_String
+// id, so comparing two interned strings is comparing two integers. The hash of each string is
+// cached next to it so it never has to be hashed again either.
+// Storage only grows, so strings returned from the interner stay valid until it's destroyed.
+
+/*
+
+	Example Usage:
+
+
+	String_Interner names = make_string_interner(get_heap_allocator());
+
+	// Or, to share one interner between threads
+	String_Interner names = make_string_interner_thread_safe(get_heap_allocator());
+
+	// Same string gives the same id every time
+	Interned_String player = string_intern(&names, STR("player"));
+
+	if (entity->tag == player) {
+
+	}
+
+	// Without interning the string if it hasn't been
+	Interned_String id;
+	if (string_interner_find(&names, STR("enemy"), &id)) {
+
+	}
+
+	string text = string_interner_get_string(&names, player); // Null terminated
+	u64    hash = string_interner_get_hash(&names, player);   // Same as string_get_hash(text)
+
+	string_interner_destroy(&names);
+
+
+	Notes:
+		- Id 0 is the empty string, so a zero initialized Interned_String is the empty string.
+		- Ids are only meaningful to the interner which made them.
+		- In a thread safe interner, string_intern and string_interner_find lock, but getting
+		  the string or hash for an id doesn't. Finding an existing string only takes a read
+		  lock, so it only waits on threads adding new strings.
+		- Nothing is ever removed. Interning strings which are made at runtime and thrown away
+		  (like formatted text) will leak them into the interner.
+
+*/
+
+typedef u32 Interned_String;
+
+// Entries live in chunks which never move, so getting the string for an id doesn't need a
+// lock even while another thread is adding. Chunk n holds STRING_INTERNER_FIRST_CHUNK_SIZE<<n
+// entries, so 25 chunks is enough for every id a u32 can hold.
+#define STRING_INTERNER_FIRST_CHUNK_SIZE 256
+#define STRING_INTERNER_FIRST_CHUNK_SIZE_LOG2 8
+#define STRING_INTERNER_MAX_CHUNKS 25
+#define STRING_INTERNER_BLOCK_SIZE 65536
+
+typedef struct String_Interner_Entry {
+	u64 hash;
+	string text;
+} String_Interner_Entry;
+
+typedef struct String_Interner_Block {
+	struct String_Interner_Block *next;
+	u64 used;
+	u64 size;
+	// Data follows
+} String_Interner_Block;
+
+typedef struct String_Interner {
+	u64 count; // Number of interned strings, not counting the empty string
+
+	String_Interner_Entry *_chunks[STRING_INTERNER_MAX_CHUNKS];
+
+	// Slots hold entry indices, which are ids-1
+	Hash_Table_Index _index;
+
+	String_Interner_Block *_blocks;
+
+	bool thread_safe;
+	RW_Spinlock _lock;
+
+	Allocator allocator;
+} String_Interner;
+
+String_Interner make_string_interner(Allocator allocator) {
+	String_Interner interner = ZERO(String_Interner);
+	interner.allocator = allocator;
+	rw_spinlock_init(&interner._lock);
+	return interner;
+}
+String_Interner make_string_interner_thread_safe(Allocator allocator) {
+	String_Interner interner = make_string_interner(allocator);
+	interner.thread_safe = true;
+	return interner;
+}
+
+void string_interner_destroy(String_Interner *interner) {
+	for (u64 i = 0; i < STRING_INTERNER_MAX_CHUNKS; i += 1) {
+		if (interner->_chunks[i]) dealloc(interner->allocator, interner->_chunks[i]);
+	}
+
+	String_Interner_Block *block = interner->_blocks;
+	while (block) {
+		String_Interner_Block *next = block->next;
+		dealloc(interner->allocator, block);
+		block = next;
+	}
+
+	_hash_table_index_destroy(&interner->_index, interner->allocator);
+
+	*interner = ZERO(String_Interner);
+}
+
+inline String_Interner_Entry *
+_string_interner_get_entry(String_Interner *interner, u64 entry_index) {
+	u64 i = entry_index + STRING_INTERNER_FIRST_CHUNK_SIZE;
+	u64 top_bit = 63 - count_leading_zeros_64(i);
+	u64 chunk = top_bit - STRING_INTERNER_FIRST_CHUNK_SIZE_LOG2;
+	return &interner->_chunks[chunk][i - (1ull << top_bit)];
+}
+
+inline string
+string_interner_get_string(String_Interner *interner, Interned_String id) {
+	if (id == 0) return STR("");
+	return _string_interner_get_entry(interner, id-1)->text;
+}
+inline u64
+string_interner_get_hash(String_Interner *interner, Interned_String id) {
+	if (id == 0) return string_get_hash(ZERO(string));
+	return _string_interner_get_entry(interner, id-1)->hash;
+}
+
+// Id of s, 0 if it's not interned
+Interned_String _string_interner_find_locked(String_Interner *interner, string s, u64 hash) {
+
+	if (interner->count == 0) return 0;
+
+	Hash_Table_Index *index = &interner->_index;
+
+	u8 control = _hash_table_control_byte(hash);
+
+	u64 group_mask = index->slot_count/HASH_TABLE_GROUP_SIZE - 1;
+	u64 group = hash & group_mask;
+
+	for (u64 step = 1; ; step += 1) {
+		u8 *group_control = index->control + group*HASH_TABLE_GROUP_SIZE;
+
+		u32 match = _hash_table_match_group(group_control, control);
+		while (match) {
+			u64 slot = group*HASH_TABLE_GROUP_SIZE + count_trailing_zeros_32(match);
+			String_Interner_Entry *entry = _string_interner_get_entry(interner, index->slots[slot]);
+
+			if (entry->hash == hash && strings_match(entry->text, s)) {
+				return (Interned_String)(index->slots[slot] + 1);
+			}
+
+			match &= match-1;
+		}
+
+		if (_hash_table_match_group(group_control, HASH_TABLE_CONTROL_EMPTY)) return 0;
+
+		group = (group + step) & group_mask;
+	}
+}
+
+// Copies s into the blocks, with a null terminator
+string _string_interner_store(String_Interner *interner, string s) {
+	String_Interner_Block *block = interner->_blocks;
+	if (!block || block->used + s.count + 1 > block->size) {
+		u64 size = max(s.count + 1, STRING_INTERNER_BLOCK_SIZE);
+		block = alloc(interner->allocator, sizeof(String_Interner_Block) + size);
+		block->next = interner->_blocks;
+		block->used = 0;
+		block->size = size;
+		interner->_blocks = block;
+	}
+
+	string stored;
+	stored.data = (u8*)(block+1) + block->used;
+	stored.count = s.count;
+	memcpy(stored.data, s.data, s.count);
+	stored.data[s.count] = 0;
+
+	block->used += s.count + 1;
+
+	return stored;
+}
+
+Interned_String _string_interner_add_locked(String_Interner *interner, string s, u64 hash) {
+	assert(interner->count < UINT32_MAX-1, "String interner can't hold more than %u strings", UINT32_MAX-1);
+
+	u64 entry_index = interner->count;
+
+	// A new chunk starts when entry_index+STRING_INTERNER_FIRST_CHUNK_SIZE is a power of two
+	u64 i = entry_index + STRING_INTERNER_FIRST_CHUNK_SIZE;
+	if ((i & (i-1)) == 0) {
+		u64 chunk = 63 - count_leading_zeros_64(i) - STRING_INTERNER_FIRST_CHUNK_SIZE_LOG2;
+		interner->_chunks[chunk] = alloc(interner->allocator, i*sizeof(String_Interner_Entry));
+	}
+
+	String_Interner_Entry *entry = _string_interner_get_entry(interner, entry_index);
+	entry->hash = hash;
+	entry->text = _string_interner_store(interner, s);
+
+	// Grow the index past 7/8 load. Entries aren't contiguous, so we reinsert them ourselves
+	// rather than with _hash_table_index_reserve.
+	Hash_Table_Index *index = &interner->_index;
+	u64 max_load = index->slot_count - index->slot_count/8;
+	if (entry_index + 1 >= max_load) {
+		_hash_table_index_rehash(index, _hash_table_slot_count_for(entry_index + 1), 0, 0, 0, interner->allocator);
+		for (u64 j = 0; j < entry_index; j += 1) {
+			_hash_table_index_insert(index, _string_interner_get_entry(interner, j)->hash, j);
+		}
+	}
+	_hash_table_index_insert(index, hash, entry_index);
+
+	interner->count += 1;
+
+	return (Interned_String)(entry_index + 1);
+}
+
+// Returns true if s is interned, with its id in id_out. The empty string is always interned.
+bool string_interner_find(String_Interner *interner, string s, Interned_String *id_out) {
+	if (s.count == 0) {
+		if (id_out) *id_out = 0;
+		return true;
+	}
+
+	u64 hash = string_get_hash(s);
+
+	if (interner->thread_safe) rw_spinlock_acquire_read(&interner->_lock);
+	Interned_String id = _string_interner_find_locked(interner, s, hash);
+	if (interner->thread_safe) rw_spinlock_release_read(&interner->_lock);
+
+	if (id_out) *id_out = id;
+	return id != 0;
+}
+
+// Id of s, interning a copy of it if it's new
+Interned_String string_intern(String_Interner *interner, string s) {
+	if (s.count == 0) return 0;
+
+	u64 hash = string_get_hash(s);
+
+	if (!interner->thread_safe) {
+		Interned_String id = _string_interner_find_locked(interner, s, hash);
+		if (!id) id = _string_interner_add_locked(interner, s, hash);
+		return id;
+	}
+
+	// Most of the time it's already interned, so try with only a read lock first
+	rw_spinlock_acquire_read(&interner->_lock);
+	Interned_String id = _string_interner_find_locked(interner, s, hash);
+	rw_spinlock_release_read(&interner->_lock);
+	if (id) return id;
+
+	rw_spinlock_acquire_write(&interner->_lock);
+
+	// Someone may have added it between our find and getting the write lock
+	id = _string_interner_find_locked(interner, s, hash);
+	if (!id) id = _string_interner_add_locked(interner, s, hash);
+
+	rw_spinlock_release_write(&interner->_lock);
+
+	return id;
+}
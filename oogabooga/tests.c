@@ -450,6 +450,106 @@ void test_strings() {
     assert(strings_match(hello_balls, STR("Greetings, Balls!")), "Failed: string_replace");
 }
 
+s64 test_naive_find(string s, string sub, bool from_right) {
+    if (sub.count > s.count) return -1;
+    for (u64 n = 0; n <= s.count - sub.count; n += 1) {
+        u64 i = from_right ? s.count - sub.count - n : n;
+        if (memcmp(s.data + i, sub.data, sub.count) == 0) return (s64)i;
+    }
+    return -1;
+}
+void test_string_search() {
+    Allocator heap = get_heap_allocator();
+    
+    assert(string_find_from_left(STR("Hello, World!"), STR("o")) == 4, "Failed: string_find_from_left");
+    assert(string_find_from_right(STR("Hello, World!"), STR("o")) == 8, "Failed: string_find_from_right");
+    assert(string_find_from_left(STR("Hello, World!"), STR("World")) == 7, "Failed: string_find_from_left");
+    assert(string_find_from_left(STR("Hello"), STR("Hello, World!")) == -1, "Failed: string_find_from_left with sub longer than s");
+    assert(string_find_from_right(STR("Hello"), STR("Hello, World!")) == -1, "Failed: string_find_from_right with sub longer than s");
+    assert(string_find_from_left(STR("Hello"), STR("")) == 0, "Failed: string_find_from_left with empty sub");
+    assert(string_find_from_right(STR("Hello"), STR("")) == 5, "Failed: string_find_from_right with empty sub");
+    assert(string_find_char(STR("a,b;c"), ';') == 3, "Failed: string_find_char");
+    assert(string_find_char(null_string, ';') == -1, "Failed: string_find_char on empty string");
+    assert(string_count_char(STR("a,b,c,"), ',') == 3, "Failed: string_count_char");
+    assert(string_find_any_of(STR("key = value;"), STR(";=")) == 4, "Failed: string_find_any_of");
+    assert(string_find_any_of(STR("key = value;"), STR("")) == -1, "Failed: string_find_any_of with empty set");
+    
+    // Random strings over a small alphabet so there are lots of partial matches, at lengths
+    // around the SIMD block sizes and with subs on both sides of the Horspool cutoff.
+    // The low bits of get_random repeat quickly, so the letters come from the high bits.
+    const u64 max_count = 1000;
+    string s   = alloc_string(heap, max_count);
+    string sub = alloc_string(heap, STRING_FIND_HORSPOOL_MIN_COUNT + 16);
+    const char *big_set = "abcdefghij;";
+    for (u64 iteration = 0; iteration < 4000; iteration += 1) {
+        u64 alphabet = 2 + iteration % 3;
+        s.count   = get_random() % max_count;
+        sub.count = 1 + get_random() % (iteration % 4 == 0 ? STRING_FIND_HORSPOOL_MIN_COUNT + 16 : 8);
+        for (u64 i = 0; i < s.count; i += 1) s.data[i] = 'a' + (u8)((get_random() >> 32) % alphabet);
+        for (u64 i = 0; i < sub.count; i += 1) sub.data[i] = 'a' + (u8)((get_random() >> 32) % alphabet);
+        
+        // Plant the sub somewhere, half of the time
+        if (iteration % 2 == 0 && sub.count <= s.count) {
+            u64 at = get_random() % (s.count - sub.count + 1);
+            memcpy(s.data + at, sub.data, sub.count);
+        }
+        
+        assert(string_find_from_left(s, sub) == test_naive_find(s, sub, false), "Failed: string_find_from_left (%llu in %llu)", sub.count, s.count);
+        assert(string_find_from_right(s, sub) == test_naive_find(s, sub, true), "Failed: string_find_from_right (%llu in %llu)", sub.count, s.count);
+        // The fallback for too many false candidates, on its own
+        assert(_string_find_two_way(s, sub, false) == test_naive_find(s, sub, false), "Failed: two-way from left (%llu in %llu)", sub.count, s.count);
+        assert(_string_find_two_way(s, sub, true) == test_naive_find(s, sub, true), "Failed: two-way from right (%llu in %llu)", sub.count, s.count);
+        
+        u8 c = 'a' + (u8)((get_random() >> 32) % (alphabet + 1));
+        string one = {1, &c};
+        u64 expected_count = 0;
+        for (u64 i = 0; i < s.count; i += 1) expected_count += s.data[i] == c;
+        assert(string_find_char(s, c) == test_naive_find(s, one, false), "Failed: string_find_char");
+        assert(string_find_char_from_right(s, c) == test_naive_find(s, one, true), "Failed: string_find_char_from_right");
+        assert(string_count_char(s, c) == expected_count, "Failed: string_count_char");
+        
+        // One set small enough for the SIMD path and one that isn't
+        string set = {1 + get_random() % 3, &sub.data[0]};
+        if (set.count > sub.count) set.count = sub.count;
+        string sets[] = {set, STR(big_set)};
+        for (u64 k = 0; k < 2; k += 1) {
+            s64 expected = -1;
+            for (u64 i = 0; i < s.count && expected < 0; i += 1) {
+                for (u64 j = 0; j < sets[k].count; j += 1) {
+                    if (s.data[i] == sets[k].data[j]) expected = (s64)i;
+                }
+            }
+            assert(string_find_any_of(s, sets[k]) == expected, "Failed: string_find_any_of");
+        }
+    }
+    
+    // Many positions where the first and last bytes match but the middle doesn't. This is
+    // quadratic without the two-way fallback (the 1001 byte sub compared ~500 bytes at every
+    // position).
+    string repetitive = alloc_string(heap, 256*1024);
+    memset(repetitive.data, 'a', repetitive.count);
+    u64 b_index = repetitive.count - 1000;
+    repetitive.data[b_index] = 'b';
+    string needle = alloc_string(heap, 1001);
+    u64 needle_counts[] = {2, STRING_FIND_HORSPOOL_MIN_COUNT + 1, needle.count};
+    for (u64 k = 0; k < sizeof(needle_counts)/sizeof(needle_counts[0]); k += 1) {
+        u64 n = needle_counts[k];
+        string sub_n = {n, needle.data};
+        memset(sub_n.data, 'a', n);
+        sub_n.data[n/2] = 'b';
+        assert(string_find_from_left(repetitive, sub_n) == (s64)(b_index - n/2), "Failed: string_find_from_left on repetitive string");
+        assert(string_find_from_right(repetitive, sub_n) == (s64)(b_index - n/2), "Failed: string_find_from_right on repetitive string");
+        sub_n.data[n/2] = 'c';
+        assert(string_find_from_left(repetitive, sub_n) == -1, "Failed: string_find_from_left on repetitive string without a match");
+        assert(string_find_from_right(repetitive, sub_n) == -1, "Failed: string_find_from_right on repetitive string without a match");
+    }
+    
+    dealloc_string(heap, s);
+    dealloc_string(heap, sub);
+    dealloc_string(heap, repetitive);
+    dealloc_string(heap, needle);
+}
+
 void test_file_io() {
 
 #if TARGET_OS == WINDOWS && !OOGABOOGA_LINK_EXTERNAL_INSTANCE
@@ -594,6 +694,10 @@ bool floats_roughly_match(float a, float b) {
 bool floats_roughly_match64(float64 a, float64 b) {
 	return fabs(a - b) < 0.01;
 }
+// For values of any scale, tolerance is relative to the bigger one
+bool floats_relatively_match64(float64 a, float64 b, float64 tolerance) {
+	return fabs(a - b) <= tolerance*max(fabs(a), fabs(b));
+}
 void test_simd() {
 
 	
@@ -1307,6 +1411,85 @@ void test_intmath() {
     assert(v4i_result.x == 1 && v4i_result.y == 2 && v4i_result.z == 3 && v4i_result.w == 4, "v4i_divi incorrect");
 }
 
+void test_hash() {
+    Allocator heap = get_heap_allocator();
+    
+    // Hashing in one go and streaming in uneven pieces give the same hash, at every size
+    // around the short/long switch and a few blocks in
+    const u64 max_size = HASH_STRIPES_PER_BLOCK*HASH_STRIPE_SIZE*3 + 100;
+    u8 *data = alloc(heap, max_size);
+    for (u64 i = 0; i < max_size; i += 1) data[i] = (u8)get_random();
+    
+    for (u64 size = 0; size <= max_size; size += (size < 600 ? 1 : 37)) {
+        for (u64 seed = 0; seed < 0x20000; seed += 0x10000) {
+            u64 hash = hash_bytes_seeded(data, size, seed);
+            
+            Hash_Stream stream;
+            hash_stream_init(&stream, seed);
+            u64 offset = 0;
+            u64 piece = size % 7;
+            while (offset < size) {
+                u64 n = min(piece, size-offset);
+                hash_stream_update(&stream, data+offset, n);
+                offset += n;
+                piece = (piece*5 + 3) % 301;
+            }
+            assert(hash_stream_finish(&stream) == hash, "Failed: Streamed hash of %llu bytes with seed %llu", size, seed);
+            
+            if (size < 600) {
+                hash_stream_init(&stream, seed);
+                for (u64 i = 0; i < size; i += 1) hash_stream_update(&stream, data+i, 1);
+                assert(hash_stream_finish(&stream) == hash, "Failed: Byte by byte hash of %llu bytes", size);
+            }
+        }
+        
+        assert(hash_bytes(data, size) != hash_bytes_seeded(data, size, 1), "Failed: Seed should change hash of %llu bytes", size);
+    }
+    
+    string text = STR("Strings hash like their bytes");
+    assert(string_get_hash(text) == hash_bytes(text.data, text.count), "Failed: string_get_hash");
+    assert(string_get_hash_seeded(text, 7) == hash_bytes_seeded(text.data, text.count, 7), "Failed: string_get_hash_seeded");
+    
+    // Avalanche: flipping any one input bit should flip each output bit about half of the time
+    u64 sizes[] = { 3, 8, 16, 40, 200, 1000 };
+    for (u64 s = 0; s < sizeof(sizes)/sizeof(u64); s += 1) {
+        u64 size = sizes[s];
+        u64 bit_step = (size*8 + 255)/256;
+        u64 bits_tested = (size*8 + bit_step-1)/bit_step;
+        u64 samples = max(64, 16384/bits_tested);
+        
+        u64 output_flips[64] = {0};
+        u64 input_flips[256] = {0};
+        for (u64 sample = 0; sample < samples; sample += 1) {
+            for (u64 i = 0; i < size; i += 1) data[i] = (u8)get_random();
+            u64 hash = hash_bytes(data, size);
+            
+            for (u64 bit = 0; bit < size*8; bit += bit_step) {
+                data[bit/8] ^= 1 << (bit%8);
+                u64 flipped = hash ^ hash_bytes(data, size);
+                data[bit/8] ^= 1 << (bit%8);
+                
+                for (u64 o = 0; o < 64; o += 1) {
+                    u64 is_flipped = (flipped >> o) & 1;
+                    output_flips[o] += is_flipped;
+                    input_flips[bit/bit_step] += is_flipped;
+                }
+            }
+        }
+        
+        for (u64 o = 0; o < 64; o += 1) {
+            f64 rate = (f64)output_flips[o] / (f64)(samples*bits_tested);
+            assert(rate > 0.45 && rate < 0.55, "Failed: Output bit %llu flipped %.3f of the time for %llu bytes", o, rate, size);
+        }
+        for (u64 i = 0; i < bits_tested; i += 1) {
+            f64 rate = (f64)input_flips[i] / (f64)(samples*64);
+            assert(rate > 0.45 && rate < 0.55, "Failed: Input bit %llu flipped %.3f of the output for %llu bytes", i*bit_step, rate, size);
+        }
+    }
+    
+    dealloc(heap, data);
+}
+
 void test_hash_table() {
     Hash_Table table = make_hash_table(string, int, get_heap_allocator());
     
@@ -1342,6 +1525,206 @@ void test_hash_table() {
     assert(table.entries == NULL, "Failed: Hash table entries should be NULL after destroy");
     assert(table.count == 0, "Failed: Hash table count should be 0 after destroy");
     assert(table.capacity_count == 0, "Failed: Hash table capacity count should be 0 after destroy");
+
+    // Grow through many rehashes
+    const u64 count = 100000;
+    Hash_Table big = make_hash_table_reserve(u64, u64, 16, get_heap_allocator());
+    for (u64 i = 0; i < count; i += 1) {
+        u64 key = i*7919;
+        u64 value = i;
+        hash_table_add(&big, key, value);
+    }
+    assert(big.count == count, "Failed: Expected %llu entries, got %llu", count, big.count);
+    assert(big.count < big._index.slot_count - big._index.slot_count/8, "Failed: Hash table index is over 7/8 load");
+    for (u64 i = 0; i < count; i += 1) {
+        u64 key = i*7919;
+        u64 *value = hash_table_find(&big, key);
+        assert(value && *value == i, "Failed: Wrong value for key %llu", key);
+        assert(*(u64*)hash_table_get_nth_value(&big, i) == i, "Failed: Entries should stay in insertion order");
+    }
+    for (u64 i = 0; i < 1000; i += 1) {
+        u64 key = i*7919 + 1;
+        assert(!hash_table_contains(&big, key), "Failed: Key %llu should not exist", key);
+    }
+
+    hash_table_reset(&big);
+    for (u64 i = 0; i < 1000; i += 1) {
+        u64 key = i*7919;
+        assert(!hash_table_contains(&big, key), "Failed: Hash table should be empty after reset");
+    }
+    u64 key = 5;
+    u64 value = 6;
+    hash_table_set(&big, key, value);
+    assert(*(u64*)hash_table_find(&big, key) == 6, "Failed: Set after reset");
+
+    hash_table_destroy(&big);
+
+    // Keys with the same hash are told apart
+    Hash_Table colliding = make_hash_table(u64, int, get_heap_allocator());
+    u64 key_a = 1, key_b = 2;
+    int value_a = 10, value_b = 20;
+    hash_table_add_raw(&colliding, 1234, &key_a, &value_a, sizeof(u64), sizeof(int));
+    hash_table_add_raw(&colliding, 1234, &key_b, &value_b, sizeof(u64), sizeof(int));
+    assert(*(int*)hash_table_find_raw(&colliding, 1234, &key_a, sizeof(u64)) == 10, "Failed: Colliding key a");
+    assert(*(int*)hash_table_find_raw(&colliding, 1234, &key_b, sizeof(u64)) == 20, "Failed: Colliding key b");
+    u64 key_c = 3;
+    assert(!hash_table_contains_raw(&colliding, 1234, &key_c, sizeof(u64)), "Failed: Colliding key c should not exist");
+    assert(*(u64*)hash_table_get_nth_key(&colliding, 1) == 2, "Failed: nth key");
+    hash_table_destroy(&colliding);
+
+    // Hash only tables match on the hash alone
+    Hash_Table hash_only = make_hash_table_hash_only(u64, int, get_heap_allocator());
+    hash_table_add_raw(&hash_only, 1234, &key_a, &value_a, sizeof(u64), sizeof(int));
+    assert(*(int*)hash_table_find_raw(&hash_only, 1234, &key_b, sizeof(u64)) == 10, "Failed: Hash only table should match on hash");
+    assert(hash_table_get_nth_key(&hash_only, 0) == 0, "Failed: Hash only table has no keys");
+    assert(hash_only._entry_size == 16, "Failed: Hash only table shouldn't store keys");
+    hash_table_destroy(&hash_only);
+
+    // String keys are copied into the table
+    Hash_Table strings = make_hash_table(string, int, get_heap_allocator());
+    string temp_key = string_copy(STR("Temporary key"), get_heap_allocator());
+    int string_value = 5;
+    hash_table_add(&strings, temp_key, string_value);
+    temp_key.data[0] = 'X';
+    string lookup = STR("Temporary key");
+    assert(hash_table_find(&strings, lookup) && *(int*)hash_table_find(&strings, lookup) == 5, "Failed: String key should be copied");
+    assert(!hash_table_contains(&strings, temp_key), "Failed: Modified string key should not exist");
+    dealloc_string(get_heap_allocator(), temp_key);
+    hash_table_destroy(&strings);
+
+    // Interleaved adds and removes, checked against a plain array of what should be in the table
+    const u64 key_range = 50000;
+    const u64 churn_ops = 2000000;
+    s64 *expected = alloc(get_heap_allocator(), key_range*sizeof(s64));
+    for (u64 i = 0; i < key_range; i += 1) expected[i] = -1;
+    u64 expected_count = 0;
+    Hash_Table churn = make_hash_table(u64, s64, get_heap_allocator());
+    for (u64 i = 0; i < churn_ops; i += 1) {
+        u64 key = get_random() % key_range;
+        s64 value = (s64)i;
+        u64 op = get_random() % 3;
+        if (op == 0) {
+            bool removed = hash_table_remove(&churn, key);
+            assert(removed == (expected[key] >= 0), "Failed: Remove of key %llu returned %d", key, removed);
+            if (removed) expected_count -= 1;
+            expected[key] = -1;
+        } else if (op == 1) {
+            bool newly_added = hash_table_set(&churn, key, value);
+            assert(newly_added == (expected[key] < 0), "Failed: Set of key %llu returned %d", key, newly_added);
+            if (newly_added) expected_count += 1;
+            expected[key] = value;
+        } else {
+            s64 *found = hash_table_find(&churn, key);
+            assert((found != 0) == (expected[key] >= 0), "Failed: Find of key %llu", key);
+            if (found) assert(*found == expected[key], "Failed: Wrong value for key %llu", key);
+        }
+        assert(churn.count == expected_count, "Failed: Count %llu, expected %llu", churn.count, expected_count);
+    }
+    for (u64 key = 0; key < key_range; key += 1) {
+        s64 *found = hash_table_find(&churn, key);
+        assert((found != 0) == (expected[key] >= 0) && (!found || *found == expected[key]), "Failed: Final check of key %llu", key);
+    }
+    assert(churn._index.slot_count <= _hash_table_slot_count_for(key_range)*2, "Failed: Index grew to %llu slots from churn alone", churn._index.slot_count);
+
+    // Remove all but a few and shrink
+    for (u64 key = 16; key < key_range; key += 1) hash_table_remove(&churn, key);
+    hash_table_shrink_to_fit(&churn);
+    assert(churn.capacity_count <= 16 && churn._index.slot_count == HASH_TABLE_GROUP_SIZE && churn._index.deleted_count == 0, "Failed: shrink_to_fit");
+    for (u64 key = 0; key < 16; key += 1) {
+        s64 *found = hash_table_find(&churn, key);
+        assert((found != 0) == (expected[key] >= 0) && (!found || *found == expected[key]), "Failed: Key %llu after shrink", key);
+    }
+
+    hash_table_clear(&churn);
+    assert(churn.count == 0, "Failed: Count after clear");
+    u64 cleared_key = 3;
+    assert(!hash_table_contains(&churn, cleared_key), "Failed: Hash table should be empty after clear");
+    hash_table_destroy(&churn);
+    dealloc(get_heap_allocator(), expected);
+
+    // Removed string keys are compacted away
+    Hash_Table string_churn = make_hash_table(string, u64, get_heap_allocator());
+    for (u64 i = 0; i < 100000; i += 1) {
+        u64 key_number = i % 1000;
+        string key = (string){ sizeof(u64), (u8*)&key_number };
+        if (!hash_table_remove(&string_churn, key)) {
+            hash_table_set(&string_churn, key, i);
+            assert(*(u64*)hash_table_find(&string_churn, key) == i, "Failed: String key %llu", key_number);
+        }
+        assert(string_churn._key_bytes_dead <= max(string_churn._key_bytes_live, HASH_TABLE_KEY_BLOCK_SIZE), "Failed: Removed string keys should be compacted");
+        if (i == 99500) {
+            for (u64 n = 501; n < 1000; n += 1) {
+                string other = (string){ sizeof(u64), (u8*)&n };
+                assert(hash_table_contains(&string_churn, other), "Failed: String key %llu after compacting", n);
+            }
+        }
+    }
+    assert(string_churn.count == 0, "Failed: Every string key was added and removed 50 times, %llu left", string_churn.count);
+    hash_table_destroy(&string_churn);
+}
+
+typedef struct Test_Map_Value {
+    u64 a;
+    float32 b;
+} Test_Map_Value;
+DEFINE_HASH_MAP(Test_U64_Map, u64, s64, get_hash, hash_map_equals);
+DEFINE_HASH_MAP(Test_String_Map, string, Test_Map_Value, string_get_hash, strings_match);
+
+void test_hash_map() {
+    Test_String_Map strings;
+    Test_String_Map_init(&strings, get_heap_allocator());
+    
+    bool newly_added = Test_String_Map_set(&strings, STR("one"), (Test_Map_Value){1, 1.5});
+    assert(newly_added, "Failed: Key should be newly added");
+    newly_added = Test_String_Map_set(&strings, STR("one"), (Test_Map_Value){11, 11.5});
+    assert(!newly_added, "Failed: Key should not be newly added");
+    Test_String_Map_add(&strings, STR("two"), (Test_Map_Value){2, 2.5});
+    
+    Test_Map_Value *found = Test_String_Map_find(&strings, STR("one"));
+    assert(found && found->a == 11 && found->b == 11.5, "Failed: Wrong value for key one");
+    assert(Test_String_Map_contains(&strings, STR("two")), "Failed: Key two should exist");
+    assert(!Test_String_Map_contains(&strings, STR("three")), "Failed: Key three should not exist");
+    assert(strings.count == 2 && strings_match(strings.entries[1].key, STR("two")), "Failed: Entries");
+    
+    assert(Test_String_Map_remove(&strings, STR("one")), "Failed: Remove should find key one");
+    assert(!Test_String_Map_remove(&strings, STR("one")), "Failed: Key one was already removed");
+    assert(strings.count == 1 && Test_String_Map_find(&strings, STR("two"))->a == 2, "Failed: Key two after removing one");
+    Test_String_Map_destroy(&strings);
+    
+    // Same churn as for Hash_Table
+    const u64 key_range = 50000;
+    s64 *expected = alloc(get_heap_allocator(), key_range*sizeof(s64));
+    for (u64 i = 0; i < key_range; i += 1) expected[i] = -1;
+    Test_U64_Map map;
+    Test_U64_Map_init(&map, get_heap_allocator());
+    for (u64 i = 0; i < 1000000; i += 1) {
+        u64 key = get_random() % key_range;
+        u64 op = get_random() % 3;
+        if (op == 0) {
+            assert(Test_U64_Map_remove(&map, key) == (expected[key] >= 0), "Failed: Remove of key %llu", key);
+            expected[key] = -1;
+        } else if (op == 1) {
+            assert(Test_U64_Map_set(&map, key, (s64)i) == (expected[key] < 0), "Failed: Set of key %llu", key);
+            expected[key] = (s64)i;
+        } else {
+            s64 *value = Test_U64_Map_find(&map, key);
+            assert((value != 0) == (expected[key] >= 0) && (!value || *value == expected[key]), "Failed: Find of key %llu", key);
+        }
+    }
+    u64 expected_count = 0;
+    for (u64 key = 0; key < key_range; key += 1) {
+        if (expected[key] >= 0) expected_count += 1;
+        s64 *value = Test_U64_Map_find(&map, key);
+        assert((value != 0) == (expected[key] >= 0) && (!value || *value == expected[key]), "Failed: Final check of key %llu", key);
+    }
+    assert(map.count == expected_count, "Failed: Count %llu, expected %llu", map.count, expected_count);
+    
+    Test_U64_Map_clear(&map);
+    assert(map.count == 0 && !Test_U64_Map_contains(&map, 1), "Failed: Clear");
+    Test_U64_Map_shrink_to_fit(&map);
+    assert(map.capacity_count == 8 && map._index.slot_count == HASH_TABLE_GROUP_SIZE, "Failed: shrink_to_fit");
+    Test_U64_Map_destroy(&map);
+    dealloc(get_heap_allocator(), expected);
 }
 
 #define NUM_BINS 100
@@ -1429,6 +1812,326 @@ void test_mutex() {
     mutex_destroy(&data.mutex);
 }
 
+#define LOCK_STATS_TEST_TASK_COUNT 10000
+typedef struct Lock_Stats_Test_Shared_Data {
+    Spinlock spinlock;
+    Mutex mutex;
+    volatile u64 spinlock_counter;
+    volatile u64 mutex_counter;
+    volatile u64 started_count;
+} Lock_Stats_Test_Shared_Data;
+void lock_stats_test_proc(Thread* t) {
+    Lock_Stats_Test_Shared_Data* data = (Lock_Stats_Test_Shared_Data*)t->data;
+    
+    // Start hammering at roughly the same time
+    atomic_add_64(&data->started_count, 1);
+    while (data->started_count < 4) {}
+    
+    for (int i = 0; i < LOCK_STATS_TEST_TASK_COUNT; i++) {
+        spinlock_acquire_or_wait(&data->spinlock);
+        for (volatile int j = 0; j < 50; j++) {}
+        data->spinlock_counter += 1;
+        spinlock_release(&data->spinlock);
+        
+        if (i % 10 == 0) {
+            mutex_acquire_or_wait(&data->mutex);
+            data->mutex_counter += 1;
+            mutex_release(&data->mutex);
+        }
+    }
+}
+void lock_stats_test_acquire_proc(Thread* t) {
+    Spinlock *lock = (Spinlock*)t->data;
+    spinlock_acquire_or_wait(lock);
+    spinlock_release(lock);
+}
+void test_lock_stats() {
+#if !ENABLE_LOCK_STATS
+    // Names are ignored and locks don't grow
+    assert(sizeof(Spinlock) == sizeof(bool), "Failed: Spinlock should only be the lock byte without ENABLE_LOCK_STATS");
+    Spinlock named;
+    spinlock_init_named(&named, "Test spinlock");
+    spinlock_acquire_or_wait(&named);
+    spinlock_release(&named);
+    Lock_Stats *all[MAX_LOCK_STATS];
+    assert(lock_stats_get_all(all, MAX_LOCK_STATS) == 0, "Failed: no lock should have stats without ENABLE_LOCK_STATS");
+#else
+    Lock_Stats_Test_Shared_Data data = {0};
+    spinlock_init_named(&data.spinlock, "Test spinlock");
+    mutex_init_named(&data.mutex, "Test mutex");
+    
+    Lock_Stats *spinlock_stats = data.spinlock.stats;
+    Lock_Stats *mutex_stats = data.mutex.stats;
+    assert(spinlock_stats && mutex_stats && spinlock_stats != mutex_stats, "Failed: named locks have no stats");
+    lock_stats_reset();
+    
+    // Same name, same stats
+    Spinlock other;
+    spinlock_init_named(&other, "Test spinlock");
+    assert(other.stats == spinlock_stats, "Failed: locks with the same name should share stats");
+    
+    // Uncontended
+    spinlock_acquire_or_wait(&other);
+    spinlock_release(&other);
+    assert(spinlock_stats->acquisition_count == 1 && spinlock_stats->contended_count == 0, "Failed: uncontended acquire");
+    assert(spinlock_stats->total_wait_cycles == 0, "Failed: uncontended acquire should not wait");
+    
+    Spinlock unnamed;
+    spinlock_init(&unnamed);
+    assert(!unnamed.stats, "Failed: unnamed lock has stats");
+    
+    const u64 num_threads = 4;
+    Thread threads[4];
+    for (u64 i = 0; i < num_threads; i++) {
+        os_thread_init(&threads[i], lock_stats_test_proc);
+        threads[i].data = &data;
+        os_thread_start(&threads[i]);
+    }
+    for (u64 i = 0; i < num_threads; i++) {
+        os_thread_join(&threads[i]);
+        os_thread_destroy(&threads[i]);
+    }
+    
+    u64 expected_spinlock = num_threads*LOCK_STATS_TEST_TASK_COUNT;
+    u64 expected_mutex = num_threads*LOCK_STATS_TEST_TASK_COUNT/10;
+    assert(data.spinlock_counter == expected_spinlock, "Failed: spinlock did not synchronize");
+    assert(data.mutex_counter == expected_mutex, "Failed: mutex did not synchronize");
+    
+    assert(spinlock_stats->acquisition_count == expected_spinlock+1, "Failed: expected %llu acquisitions, got %llu", expected_spinlock+1, spinlock_stats->acquisition_count);
+    assert(mutex_stats->acquisition_count == expected_mutex, "Failed: expected %llu acquisitions, got %llu", expected_mutex, mutex_stats->acquisition_count);
+    assert(spinlock_stats->contended_count <= spinlock_stats->acquisition_count, "Failed: contended count");
+    
+    // Make sure there is contention, even on a single core.
+    spinlock_acquire_or_wait(&data.spinlock);
+    u64 contended_before = spinlock_stats->contended_count;
+    Thread thread;
+    os_thread_init(&thread, lock_stats_test_acquire_proc);
+    thread.data = &data.spinlock;
+    os_thread_start(&thread);
+    os_sleep(10);
+    spinlock_release(&data.spinlock);
+    os_thread_join(&thread);
+    os_thread_destroy(&thread);
+    assert(spinlock_stats->contended_count == contended_before+1, "Failed: acquiring a held lock should count as contended");
+    assert(spinlock_stats->total_wait_cycles >= spinlock_stats->max_wait_cycles && spinlock_stats->max_wait_cycles > 0, "Failed: wait cycles");
+    assert(spinlock_stats->total_hold_cycles >= spinlock_stats->max_hold_cycles && spinlock_stats->max_hold_cycles > 0, "Failed: hold cycles");
+    
+    Lock_Stats *all[MAX_LOCK_STATS];
+    u64 count = lock_stats_get_all(all, MAX_LOCK_STATS);
+    bool found = false;
+    for (u64 i = 0; i < count; i += 1) if (all[i] == spinlock_stats) found = true;
+    assert(found, "Failed: lock_stats_get_all is missing a named lock");
+    
+    lock_stats_reset();
+    assert(spinlock_stats->acquisition_count == 0 && spinlock_stats->max_wait_cycles == 0, "Failed: reset");
+    
+    mutex_destroy(&data.mutex);
+#endif
+}
+
+#define CONCURRENT_TEST_SHARED_KEYS 4096
+#define CONCURRENT_TEST_OWN_KEYS 2048
+typedef struct Concurrent_Test_Shared_Data {
+    Concurrent_Hash_Table table;
+    volatile u64 creations;
+    volatile u64 thread_count;
+    RW_Spinlock lock;
+    u64 written; // Only touched with lock write-acquired
+    bool any_writer;
+} Concurrent_Test_Shared_Data;
+void concurrent_test_create(void *key, void *value, void *user_data) {
+    Concurrent_Test_Shared_Data *data = (Concurrent_Test_Shared_Data*)user_data;
+    atomic_add_64(&data->creations, 1);
+    *(u64*)value = *(u64*)key * 3;
+}
+void concurrent_test_proc(Thread *t) {
+    Concurrent_Test_Shared_Data *data = (Concurrent_Test_Shared_Data*)t->data;
+    u64 thread_index = atomic_add_64(&data->thread_count, 1);
+    
+    for (u64 i = 0; i < CONCURRENT_TEST_SHARED_KEYS; i += 1) {
+        u64 value = 0;
+        concurrent_hash_table_get_or_add(&data->table, i, &value, concurrent_test_create, data);
+        assert(value == i*3, "Failed: get_or_add of key %llu got %llu", i, value);
+        
+        rw_spinlock_acquire_write(&data->lock);
+        assert(!data->any_writer, "Failed: More than one writer");
+        data->any_writer = true;
+        data->written += 1;
+        data->any_writer = false;
+        rw_spinlock_release_write(&data->lock);
+        
+        rw_spinlock_acquire_read(&data->lock);
+        assert(!data->any_writer, "Failed: Reading while someone is writing");
+        rw_spinlock_release_read(&data->lock);
+    }
+    
+    // Every thread adds its own keys and removes every other one again
+    for (u64 i = 0; i < CONCURRENT_TEST_OWN_KEYS; i += 1) {
+        u64 key = ((thread_index+1) << 32) | i;
+        assert(concurrent_hash_table_set(&data->table, key, i), "Failed: Own key %llu should be new", i);
+        u64 value = 0;
+        assert(concurrent_hash_table_find(&data->table, key, &value) && value == i, "Failed: Find own key %llu", i);
+        if (i % 2) assert(concurrent_hash_table_remove(&data->table, key), "Failed: Remove own key %llu", i);
+    }
+}
+void test_concurrent_hash_table() {
+    Concurrent_Hash_Table strings = make_concurrent_hash_table(string, u64, get_heap_allocator());
+    
+    string one = STR("one");
+    string two = STR("two");
+    u64 value = 1;
+    assert(concurrent_hash_table_set(&strings, one, value), "Failed: Key should be newly added");
+    value = 11;
+    assert(!concurrent_hash_table_set(&strings, one, value), "Failed: Key should not be newly added");
+    value = 0;
+    assert(concurrent_hash_table_find(&strings, one, &value) && value == 11, "Failed: Find key one");
+    assert(!concurrent_hash_table_contains(&strings, two), "Failed: Key two should not exist");
+    
+    Concurrent_Test_Shared_Data unused = {0};
+    u64 key_number = 2;
+    assert(!concurrent_hash_table_get_or_add(&strings, one, &value, concurrent_test_create, &unused), "Failed: get_or_add of existing key");
+    assert(value == 11 && unused.creations == 0, "Failed: get_or_add of existing key should not create");
+    
+    string number_key = (string){ sizeof(u64), (u8*)&key_number };
+    assert(concurrent_hash_table_get_or_add(&strings, number_key, &value, concurrent_test_create, &unused), "Failed: get_or_add of new key");
+    assert(unused.creations == 1 && concurrent_hash_table_count(&strings) == 2, "Failed: get_or_add should create");
+    
+    Hash_Table snapshot = concurrent_hash_table_snapshot(&strings, get_heap_allocator());
+    assert(snapshot.count == 2 && *(u64*)hash_table_find(&snapshot, one) == 11, "Failed: Snapshot");
+    hash_table_destroy(&snapshot);
+    
+    assert(concurrent_hash_table_remove(&strings, one) && !concurrent_hash_table_contains(&strings, one), "Failed: Remove");
+    concurrent_hash_table_clear(&strings);
+    assert(concurrent_hash_table_count(&strings) == 0, "Failed: Clear");
+    concurrent_hash_table_destroy(&strings);
+    
+    Concurrent_Test_Shared_Data data = {0};
+    data.table = make_concurrent_hash_table(u64, u64, get_heap_allocator());
+    rw_spinlock_init(&data.lock);
+    
+    const u64 num_threads = 4;
+    Thread threads[4];
+    for (u64 i = 0; i < num_threads; i++) {
+        os_thread_init(&threads[i], concurrent_test_proc);
+        threads[i].data = &data;
+        os_thread_start(&threads[i]);
+    }
+    for (u64 i = 0; i < num_threads; i++) {
+        os_thread_join(&threads[i]);
+        os_thread_destroy(&threads[i]);
+    }
+    
+    u64 expected_count = CONCURRENT_TEST_SHARED_KEYS + num_threads*CONCURRENT_TEST_OWN_KEYS/2;
+    assert(data.creations == CONCURRENT_TEST_SHARED_KEYS, "Failed: Each shared key should be created once, got %llu creations", data.creations);
+    assert(data.written == num_threads*CONCURRENT_TEST_SHARED_KEYS, "Failed: Writes under the write lock were lost");
+    assert(concurrent_hash_table_count(&data.table) == expected_count, "Failed: Count %llu, expected %llu", concurrent_hash_table_count(&data.table), expected_count);
+    
+    snapshot = concurrent_hash_table_snapshot(&data.table, get_heap_allocator());
+    assert(snapshot.count == expected_count, "Failed: Snapshot count");
+    for (u64 i = 0; i < CONCURRENT_TEST_SHARED_KEYS; i += 1) {
+        u64 *found = hash_table_find(&snapshot, i);
+        assert(found && *found == i*3, "Failed: Snapshot of shared key %llu", i);
+    }
+    hash_table_destroy(&snapshot);
+    
+    concurrent_hash_table_destroy(&data.table);
+}
+
+#define STRING_INTERN_TEST_KEYS 3000
+typedef struct String_Intern_Test_Data {
+    String_Interner interner;
+    volatile u64 thread_count;
+    Interned_String ids[4][STRING_INTERN_TEST_KEYS];
+} String_Intern_Test_Data;
+void string_intern_test_proc(Thread *t) {
+    String_Intern_Test_Data *data = (String_Intern_Test_Data*)t->data;
+    u64 thread_index = atomic_add_64(&data->thread_count, 1);
+    
+    // Each thread starts at a different key so they race to add different ones
+    for (u64 n = 0; n < STRING_INTERN_TEST_KEYS; n += 1) {
+        u64 i = (n + thread_index*STRING_INTERN_TEST_KEYS/4) % STRING_INTERN_TEST_KEYS;
+        u64 key = i + 1;
+        string key_string = (string){ sizeof(u64), (u8*)&key };
+        Interned_String id = string_intern(&data->interner, key_string);
+        
+        string text = string_interner_get_string(&data->interner, id);
+        assert(strings_match(text, key_string), "Failed: Interned string %llu from another thread", i);
+        data->ids[thread_index][i] = id;
+    }
+}
+void test_string_intern() {
+    String_Interner interner = make_string_interner(get_heap_allocator());
+    
+    Interned_String empty = string_intern(&interner, STR(""));
+    assert(empty == 0 && string_interner_get_string(&interner, 0).count == 0, "Failed: Empty string should be id 0");
+    assert(string_interner_get_string(&interner, 0).data && string_interner_get_string(&interner, 0).data[0] == 0, "Failed: Empty string should be null terminated");
+    
+    Interned_String id;
+    assert(string_interner_find(&interner, STR(""), &id) && id == 0, "Failed: Empty string should always be found");
+    assert(!string_interner_find(&interner, STR("player"), &id), "Failed: player should not be interned yet");
+    
+    string player_source = string_copy(STR("player"), get_heap_allocator());
+    Interned_String player = string_intern(&interner, player_source);
+    assert(player != 0, "Failed: Intern player");
+    assert(string_intern(&interner, STR("player")) == player, "Failed: Same string should give the same id");
+    assert(string_intern(&interner, STR("enemy")) != player, "Failed: Different strings should give different ids");
+    assert(string_interner_find(&interner, STR("player"), &id) && id == player, "Failed: Find player");
+    assert(string_interner_get_hash(&interner, player) == string_get_hash(STR("player")), "Failed: Cached hash");
+    
+    // Interned string is a copy, null terminated
+    string player_text = string_interner_get_string(&interner, player);
+    assert(player_text.data != player_source.data, "Failed: Interned string should be a copy");
+    dealloc_string(get_heap_allocator(), player_source);
+    assert(strings_match(player_text, STR("player")) && player_text.data[player_text.count] == 0, "Failed: Interned string text");
+    
+    // Past the first few chunks and a few rehashes, and a string bigger than a block
+    Interned_String ids[5000];
+    for (u64 i = 0; i < 5000; i += 1) {
+        ids[i] = string_intern(&interner, tprint("name_%d", (s32)i));
+    }
+    string big = alloc_string(get_heap_allocator(), STRING_INTERNER_BLOCK_SIZE*2);
+    memset(big.data, 'x', big.count);
+    Interned_String big_id = string_intern(&interner, big);
+    assert(strings_match(string_interner_get_string(&interner, big_id), big), "Failed: Big string");
+    dealloc_string(get_heap_allocator(), big);
+    
+    assert(interner.count == 5003, "Failed: Count %llu", interner.count);
+    for (u64 i = 0; i < 5000; i += 1) {
+        string name = tprint("name_%d", (s32)i);
+        assert(string_intern(&interner, name) == ids[i], "Failed: Id of name_%llu changed", i);
+        assert(strings_match(string_interner_get_string(&interner, ids[i]), name), "Failed: Text of name_%llu", i);
+        assert(string_interner_get_hash(&interner, ids[i]) == string_get_hash(name), "Failed: Hash of name_%llu", i);
+    }
+    assert(string_interner_find(&interner, STR("player"), &id) && id == player, "Failed: Find player after growing");
+    
+    string_interner_destroy(&interner);
+    
+    String_Intern_Test_Data *data = alloc(get_heap_allocator(), sizeof(String_Intern_Test_Data));
+    memset(data, 0, sizeof(String_Intern_Test_Data));
+    data->interner = make_string_interner_thread_safe(get_heap_allocator());
+    
+    Thread threads[4];
+    for (u64 i = 0; i < 4; i++) {
+        os_thread_init(&threads[i], string_intern_test_proc);
+        threads[i].data = data;
+        os_thread_start(&threads[i]);
+    }
+    for (u64 i = 0; i < 4; i++) {
+        os_thread_join(&threads[i]);
+        os_thread_destroy(&threads[i]);
+    }
+    
+    assert(data->interner.count == STRING_INTERN_TEST_KEYS, "Failed: Threads interned %llu strings, expected %llu", data->interner.count, (u64)STRING_INTERN_TEST_KEYS);
+    for (u64 i = 0; i < STRING_INTERN_TEST_KEYS; i += 1) {
+        for (u64 j = 1; j < 4; j += 1) {
+            assert(data->ids[j][i] == data->ids[0][i], "Failed: Threads got different ids for string %llu", i);
+        }
+    }
+    
+    string_interner_destroy(&data->interner);
+    dealloc(get_heap_allocator(), data);
+}
+
 #ifndef OOGABOOGA_HEADLESS
 int compare_draw_quads(const void *a, const void *b) {
     return ((Draw_Quad*)a)->z-((Draw_Quad*)b)->z;
@@ -1501,10 +2204,290 @@ void test_sort() {
 }
 #endif /* OOGABOOGA_HEADLESS */
 
+typedef struct Test_Sort_Item {
+    s32 z;
+    u32 order; // Where it was before sorting, to check that sorts are stable
+    u8 padding[56];
+} Test_Sort_Item;
+void test_radix_sort_keys() {
+    Allocator heap = get_heap_allocator();
+    
+    // Sizes around the 11/16 bit digit switch, with z in a small range (so passes get skipped),
+    // a 21 bit range like quads and a full 32 bit range
+    u64 counts[] = {0, 1, 2, 17, 1000, 65535, 65536, 100000};
+    u64 bit_counts[] = {4, 21, 32};
+    u64 max_count = 100000;
+    
+    Test_Sort_Item *items    = alloc(heap, max_count*sizeof(Test_Sort_Item));
+    Test_Sort_Item *expected = alloc(heap, max_count*sizeof(Test_Sort_Item));
+    Test_Sort_Item *by_key   = alloc(heap, max_count*sizeof(Test_Sort_Item));
+    u32 *indices = alloc(heap, max_count*sizeof(u32));
+    void *help = alloc(heap, get_radix_sort_by_key_help_buffer_size(max_count, sizeof(Test_Sort_Item)));
+    
+    for (u64 c = 0; c < sizeof(counts)/sizeof(counts[0]); c += 1) {
+        for (u64 b = 0; b < sizeof(bit_counts)/sizeof(bit_counts[0]); b += 1) {
+            u64 count = counts[c];
+            u64 bits = bit_counts[b];
+            s64 half_range = 1ll << (bits-1);
+            
+            for (u64 i = 0; i < count; i += 1) {
+                items[i] = ZERO(Test_Sort_Item);
+                items[i].z = (s32)((s64)(get_random() % (u64)(half_range*2)) - half_range);
+                items[i].order = (u32)i;
+            }
+            memcpy(by_key, items, count*sizeof(Test_Sort_Item));
+            
+            // radix_sort reads 8 bytes from z, which is fine since order comes right after it
+            Test_Sort_Item *radix_help = alloc(heap, max(count, 1)*sizeof(Test_Sort_Item));
+            memcpy(expected, items, count*sizeof(Test_Sort_Item));
+            radix_sort(expected, radix_help, count, sizeof(Test_Sort_Item), offsetof(Test_Sort_Item, z), bits);
+            dealloc(heap, radix_help);
+            
+            radix_sort_indices(items, indices, help, count, sizeof(Test_Sort_Item), offsetof(Test_Sort_Item, z), bits);
+            radix_sort_by_key(by_key, help, count, sizeof(Test_Sort_Item), offsetof(Test_Sort_Item, z), bits);
+            
+            for (u64 i = 0; i < count; i += 1) {
+                if (i > 0) {
+                    assert(expected[i-1].z < expected[i].z || (expected[i-1].z == expected[i].z && expected[i-1].order < expected[i].order), "Failed: radix_sort not sorted and stable at %llu", i);
+                }
+                assert(items[indices[i]].order == expected[i].order, "Failed: radix_sort_indices differs from radix_sort at %llu (%llu items, %llu bits)", i, count, bits);
+                assert(by_key[i].order == expected[i].order && by_key[i].z == expected[i].z, "Failed: radix_sort_by_key differs from radix_sort at %llu (%llu items, %llu bits)", i, count, bits);
+            }
+        }
+    }
+    
+    // Sorting raw keys, the index part comes along
+    u64 keys[] = { (5ull << 32) | 0, (1ull << 32) | 1, (0xFFFFFFFFull << 32) | 2, (1ull << 32) | 3, (0ull << 32) | 4 };
+    u64 *sorted = radix_sort_keys(keys, help, 5, 32);
+    u32 expected_indices[] = {4, 1, 3, 0, 2};
+    for (u64 i = 0; i < 5; i += 1) {
+        assert((u32)sorted[i] == expected_indices[i], "Failed: radix_sort_keys at %llu", i);
+    }
+
+    // Bits above number_of_bits are garbage and don't change the order. 21 bits is 11 and 10
+    // bit digits, 23 bits is 3 digits below 65536 items and 12 and 11 bit digits from there.
+    u64 *clean_keys   = alloc(heap, max_count*sizeof(u64));
+    u64 *garbage_keys = alloc(heap, max_count*sizeof(u64));
+    void *clean_help  = alloc(heap, get_radix_sort_keys_help_buffer_size(max_count));
+    u64 garbage_bit_counts[] = {4, 21, 23};
+    u64 garbage_counts[] = {1000, 100000};
+    for (u64 c = 0; c < sizeof(garbage_counts)/sizeof(garbage_counts[0]); c += 1) {
+        for (u64 b = 0; b < sizeof(garbage_bit_counts)/sizeof(garbage_bit_counts[0]); b += 1) {
+            u64 count = garbage_counts[c];
+            u64 bits = garbage_bit_counts[b];
+            u64 value_mask = (1ull << bits) - 1;
+            for (u64 i = 0; i < count; i += 1) {
+                u64 high = get_random() >> 32;
+                clean_keys[i]   = ((high & value_mask) << 32) | i;
+                garbage_keys[i] = (high << 32) | i;
+            }
+            u64 *clean_sorted   = radix_sort_keys(clean_keys, clean_help, count, bits);
+            u64 *garbage_sorted = radix_sort_keys(garbage_keys, help, count, bits);
+            for (u64 i = 0; i < count; i += 1) {
+                assert((u32)garbage_sorted[i] == (u32)clean_sorted[i], "Failed: radix_sort_keys with garbage above %llu bits at %llu (%llu items)", bits, i, count);
+            }
+        }
+    }
+    dealloc(heap, clean_keys);
+    dealloc(heap, garbage_keys);
+    dealloc(heap, clean_help);
+
+    dealloc(heap, items);
+    dealloc(heap, expected);
+    dealloc(heap, by_key);
+    dealloc(heap, indices);
+    dealloc(heap, help);
+}
+
+int compare_test_sort_items(const void *a, const void *b) {
+    s32 za = ((Test_Sort_Item*)a)->z;
+    s32 zb = ((Test_Sort_Item*)b)->z;
+    return za < zb ? -1 : (za > zb ? 1 : 0);
+}
+#define test_sort_item_less(a, b) ((a)->z < (b)->z)
+DEFINE_QUICK_SORT(test_quick_sort_items, Test_Sort_Item, test_sort_item_less);
+
+typedef struct Test_Float_Sort_Item {
+    f32 value;
+    u32 order;
+} Test_Float_Sort_Item;
+void test_comparison_sorts() {
+    Allocator heap = get_heap_allocator();
+    
+    // Around the insertion sort and ninther thresholds, and big enough to hit bad partitions
+    u64 counts[] = {0, 1, 2, 3, 23, 24, 25, 129, 1000, 50000};
+    u64 max_count = 50000;
+    
+    Test_Sort_Item *items  = alloc(heap, max_count*sizeof(Test_Sort_Item));
+    Test_Sort_Item *typed  = alloc(heap, max_count*sizeof(Test_Sort_Item));
+    Test_Sort_Item *stable = alloc(heap, max_count*sizeof(Test_Sort_Item));
+    Test_Sort_Item *help   = alloc(heap, max_count*sizeof(Test_Sort_Item));
+    
+    // Patterns that break naive quicksorts: sorted, reversed, all equal, few unique, organ
+    // pipe and sawtooth
+    const u64 pattern_count = 7;
+    for (u64 c = 0; c < sizeof(counts)/sizeof(counts[0]); c += 1) {
+        for (u64 pattern = 0; pattern < pattern_count; pattern += 1) {
+            u64 count = counts[c];
+            for (u64 i = 0; i < count; i += 1) {
+                items[i] = ZERO(Test_Sort_Item);
+                s32 z = 0;
+                switch (pattern) {
+                    case 0: z = (s32)get_random(); break;
+                    case 1: z = (s32)i; break;
+                    case 2: z = (s32)(count - i); break;
+                    case 3: z = 7; break;
+                    case 4: z = (s32)(get_random() % 4); break;
+                    case 5: z = (s32)(i < count/2 ? i : count - i); break;
+                    case 6: z = (s32)(i % 32); break;
+                }
+                items[i].z = z;
+                items[i].order = (u32)i;
+            }
+            memcpy(typed, items, count*sizeof(Test_Sort_Item));
+            memcpy(stable, items, count*sizeof(Test_Sort_Item));
+            
+            quick_sort(items, count, sizeof(Test_Sort_Item), compare_test_sort_items);
+            test_quick_sort_items(typed, count);
+            merge_sort_ping_pong(stable, help, count, sizeof(Test_Sort_Item), compare_test_sort_items);
+            
+            for (u64 i = 1; i < count; i += 1) {
+                assert(items[i-1].z <= items[i].z, "Failed: quick_sort not sorted at %llu (%llu items, pattern %llu)", i, count, pattern);
+                assert(typed[i-1].z <= typed[i].z, "Failed: DEFINE_QUICK_SORT not sorted at %llu (%llu items, pattern %llu)", i, count, pattern);
+                assert(stable[i-1].z < stable[i].z || (stable[i-1].z == stable[i].z && stable[i-1].order < stable[i].order), "Failed: merge_sort_ping_pong not sorted and stable at %llu (%llu items, pattern %llu)", i, count, pattern);
+            }
+            // Nothing lost or duplicated
+            u64 order_sum = 0;
+            u64 typed_order_sum = 0;
+            for (u64 i = 0; i < count; i += 1) {
+                order_sum += items[i].order;
+                typed_order_sum += typed[i].order;
+            }
+            u64 expected_sum = count > 0 ? count*(count-1)/2 : 0;
+            assert(order_sum == expected_sum && typed_order_sum == expected_sum, "Failed: quick sort lost items (%llu items, pattern %llu)", count, pattern);
+        }
+    }
+    
+    // f32 radix keys keep the order of the floats
+    f32 floats[] = {-INFINITY, -1000.5f, -1.0f, -0.0f, 0.0f, 1.0e-30f, 0.5f, 1.0f, 3.0e38f, INFINITY};
+    u64 float_count = sizeof(floats)/sizeof(floats[0]);
+    for (u64 i = 0; i < float_count; i += 1) {
+        u32 key = radix_sort_key_from_f32(floats[i]);
+        if (i > 0) assert(radix_sort_key_from_f32(floats[i-1]) < key, "Failed: f32 key out of order at %llu", i);
+        assert(bytes_match(&floats[i], &(f32){radix_sort_key_to_f32(key)}, sizeof(f32)), "Failed: f32 key doesn't convert back at %llu", i);
+    }
+    
+    u64 float_item_count = 10000;
+    Test_Float_Sort_Item *float_items = alloc(heap, float_item_count*sizeof(Test_Float_Sort_Item));
+    Test_Float_Sort_Item *float_by_key = alloc(heap, float_item_count*sizeof(Test_Float_Sort_Item));
+    u32 *float_indices = alloc(heap, float_item_count*sizeof(u32));
+    void *float_help = alloc(heap, get_radix_sort_by_key_help_buffer_size(float_item_count, sizeof(Test_Float_Sort_Item)));
+    for (u64 i = 0; i < float_item_count; i += 1) {
+        float_items[i].value = (f32)((s64)(get_random() % 2001) - 1000) * 0.25f;
+        float_items[i].order = (u32)i;
+    }
+    memcpy(float_by_key, float_items, float_item_count*sizeof(Test_Float_Sort_Item));
+    radix_sort_indices_f32(float_items, float_indices, float_help, float_item_count, sizeof(Test_Float_Sort_Item), offsetof(Test_Float_Sort_Item, value));
+    radix_sort_by_key_f32(float_by_key, float_help, float_item_count, sizeof(Test_Float_Sort_Item), offsetof(Test_Float_Sort_Item, value));
+    for (u64 i = 0; i < float_item_count; i += 1) {
+        assert(float_items[float_indices[i]].order == float_by_key[i].order, "Failed: radix_sort_indices_f32 differs from radix_sort_by_key_f32 at %llu", i);
+        if (i > 0) {
+            Test_Float_Sort_Item a = float_by_key[i-1];
+            Test_Float_Sort_Item b = float_by_key[i];
+            assert(a.value < b.value || (a.value == b.value && a.order < b.order), "Failed: radix_sort_by_key_f32 not sorted and stable at %llu", i);
+        }
+    }
+    
+    dealloc(heap, items);
+    dealloc(heap, typed);
+    dealloc(heap, stable);
+    dealloc(heap, help);
+    dealloc(heap, float_items);
+    dealloc(heap, float_by_key);
+    dealloc(heap, float_indices);
+    dealloc(heap, float_help);
+}
+
+typedef struct Radix_Sort_Parallel_Test_Item {
+    u64 sort_value;
+    u64 payload;
+} Radix_Sort_Parallel_Test_Item;
+void test_radix_sort_parallel() {
+    Allocator heap = get_heap_allocator();
+    
+    // Below and above RADIX_SORT_PARALLEL_MIN_COUNT, and not divisible by the thread counts
+    u64 counts[] = {0, 1, 1000, RADIX_SORT_PARALLEL_MIN_COUNT*3+7};
+    u64 thread_counts[] = {1, 3, 4, 0};
+    u64 max_count = RADIX_SORT_PARALLEL_MIN_COUNT*3+7;
+    
+    u64 *keys          = alloc(heap, max_count*sizeof(u64));
+    u64 *payloads      = alloc(heap, max_count*sizeof(u64));
+    u64 *help_keys     = alloc(heap, max_count*sizeof(u64));
+    u64 *help_payloads = alloc(heap, max_count*sizeof(u64));
+    
+    // Same keys sorted by the serial radix_sort
+    Radix_Sort_Parallel_Test_Item *expected      = alloc(heap, max_count*sizeof(Radix_Sort_Parallel_Test_Item));
+    Radix_Sort_Parallel_Test_Item *expected_help = alloc(heap, max_count*sizeof(Radix_Sort_Parallel_Test_Item));
+    
+    for (u64 c = 0; c < sizeof(counts)/sizeof(counts[0]); c += 1) {
+        for (u64 t = 0; t < sizeof(thread_counts)/sizeof(thread_counts[0]); t += 1) {
+            u64 count = counts[c];
+            u64 thread_count = thread_counts[t];
+            
+            // u32 keys with only 16 distinct values in 21 bits, so there are lots of ties and
+            // the passes for the middle bits are skipped. The bits above 21 are garbage which
+            // must not change the order, including the 3 bits in the last sorted byte.
+            u32 *keys32 = (u32*)keys;
+            u32 *payloads32 = (u32*)payloads;
+            for (u64 i = 0; i < count; i += 1) {
+                u32 sorted_bits = (u32)((get_random() % 16) << 12) | 0x7;
+                keys32[i] = sorted_bits | ((u32)get_random() & 0xFFE00000);
+                payloads32[i] = (u32)i;
+                expected[i].sort_value = sorted_bits;
+                expected[i].payload = i;
+            }
+            radix_sort_u32_parallel(keys32, payloads32, (u32*)help_keys, (u32*)help_payloads, count, 21, thread_count);
+            radix_sort(expected, expected_help, count, sizeof(Radix_Sort_Parallel_Test_Item), offsetof(Radix_Sort_Parallel_Test_Item, sort_value), 21);
+            for (u64 i = 0; i < count; i += 1) {
+                assert((keys32[i] & 0x1FFFFF) == expected[i].sort_value && payloads32[i] == expected[i].payload, "Failed: u32 keys don't match the serial radix sort at %llu (%llu keys, %llu threads)", i, count, thread_count);
+            }
+            
+            // u64 keys in the whole range
+            for (u64 i = 0; i < count; i += 1) {
+                keys[i] = get_random();
+                payloads[i] = keys[i] ^ 0x5555;
+            }
+            radix_sort_u64_parallel(keys, payloads, help_keys, help_payloads, count, 64, thread_count);
+            for (u64 i = 0; i < count; i += 1) {
+                if (i > 0) assert(keys[i-1] <= keys[i], "Failed: u64 keys not sorted at %llu (%llu keys, %llu threads)", i, count, thread_count);
+                assert(payloads[i] == (keys[i] ^ 0x5555), "Failed: u64 payload didn't follow its key at %llu", i);
+            }
+            
+            // Keys only
+            for (u64 i = 0; i < count; i += 1) keys32[i] = (u32)get_random();
+            radix_sort_u32_parallel(keys32, 0, (u32*)help_keys, 0, count, 32, thread_count);
+            for (u64 i = 1; i < count; i += 1) {
+                assert(keys32[i-1] <= keys32[i], "Failed: u32 keys without payloads not sorted at %llu", i);
+            }
+        }
+    }
+    
+    dealloc(heap, keys);
+    dealloc(heap, payloads);
+    dealloc(heap, help_keys);
+    dealloc(heap, help_payloads);
+    dealloc(heap, expected);
+    dealloc(heap, expected_help);
+}
+
 typedef struct Test_Thing {
     int foo;
     float bar;
 } Test_Thing;
+DEFINE_GROWING_ARRAY(Test_Thing_Array, Test_Thing);
+bool test_growing_array_is_multiple_of_3(void *item, void *user_data) {
+    return *(u64*)item % 3 == 0;
+}
 void test_growing_array() {
     Test_Thing *things = 0;
     
@@ -1565,6 +2548,217 @@ void test_growing_array() {
     assert(!bytes_match(&copy, thing, sizeof(Test_Thing)), "Failed: growing_array_unordered_remove_by_pointer");
     
     assert(growing_array_get_valid_count(things) == 99, "Failed: growing_array_get_valid_count");
+    
+    growing_array_deinit((void**)&things);
+    
+    // Growth policies, and growing through reallocate keeps the items
+    Allocator allocators[] = { get_heap_allocator(), get_temporary_allocator() };
+    for (u64 a = 0; a < 2; a += 1) {
+        u64 *numbers;
+        growing_array_init_reserve((void**)&numbers, sizeof(u64), 8, allocators[a]);
+        
+        growing_array_set_growth_factor((void**)&numbers, 1.5f);
+        for (u64 i = 0; i < 9; i += 1) growing_array_add((void**)&numbers, &i);
+        assert(growing_array_get_allocated_count(numbers) == 12, "Failed: Growth factor 1.5");
+        
+        growing_array_set_growth_chunk((void**)&numbers, 100);
+        for (u64 i = 9; i < 250; i += 1) growing_array_add((void**)&numbers, &i);
+        assert(growing_array_get_allocated_count(numbers) == 300, "Failed: Growth chunk 100");
+        
+        growing_array_reserve((void**)&numbers, 1000);
+        assert(growing_array_get_allocated_count(numbers) == 1000, "Failed: Growth chunk reserve");
+        
+        assert(growing_array_get_valid_count(numbers) == 250, "Failed: Valid count after growing");
+        for (u64 i = 0; i < 250; i += 1) {
+            assert(numbers[i] == i, "Failed: Items lost when growing, at %llu", i);
+        }
+        
+        growing_array_deinit((void**)&numbers);
+    }
+    
+    // Bulk operations, checked against what they should leave
+    u64 *numbers;
+    growing_array_init((void**)&numbers, sizeof(u64), get_heap_allocator());
+    for (u64 i = 0; i < 200; i += 1) growing_array_add((void**)&numbers, &i);
+    
+    u64 inserted[3] = { 1000, 1001, 1002 };
+    growing_array_insert_multiple((void**)&numbers, 10, inserted, 3);
+    u64 one_more = 2000;
+    growing_array_insert((void**)&numbers, 0, &one_more);
+    growing_array_insert((void**)&numbers, growing_array_get_valid_count(numbers), &one_more);
+    assert(growing_array_get_valid_count(numbers) == 205, "Failed: Insert count");
+    assert(numbers[0] == 2000 && numbers[1] == 0 && numbers[10] == 9, "Failed: Insert before range");
+    assert(numbers[11] == 1000 && numbers[13] == 1002 && numbers[14] == 10, "Failed: Insert multiple");
+    assert(numbers[203] == 199 && numbers[204] == 2000, "Failed: Insert at end");
+    
+    growing_array_ordered_remove_range((void**)&numbers, 11, 3);
+    growing_array_ordered_remove_by_index((void**)&numbers, 0);
+    growing_array_pop((void**)&numbers);
+    assert(growing_array_get_valid_count(numbers) == 200, "Failed: Remove range count");
+    for (u64 i = 0; i < 200; i += 1) {
+        assert(numbers[i] == i, "Failed: Remove range at %llu", i);
+    }
+    
+    u64 removed = growing_array_remove_if((void**)&numbers, test_growing_array_is_multiple_of_3, 0);
+    assert(removed == 67 && growing_array_get_valid_count(numbers) == 133, "Failed: remove_if count");
+    for (u64 i = 0; i < 133; i += 1) {
+        assert(numbers[i] == i + i/2 + 1, "Failed: remove_if at %llu", i);
+    }
+    
+    // Remove every other one, with bits set past the end that should be ignored
+    u64 mask[3] = { 0x5555555555555555ull, 0x5555555555555555ull, 0x15 | (~0ull << 5) };
+    removed = growing_array_remove_by_mask((void**)&numbers, mask);
+    assert(removed == 67 && growing_array_get_valid_count(numbers) == 66, "Failed: remove_by_mask count");
+    for (u64 i = 0; i < 66; i += 1) {
+        u64 source_index = i*2 + 1;
+        assert(numbers[i] == source_index + source_index/2 + 1, "Failed: remove_by_mask at %llu", i);
+    }
+    
+    u64 none[2] = { 0, 0 };
+    assert(growing_array_remove_by_mask((void**)&numbers, none) == 0 && growing_array_get_valid_count(numbers) == 66, "Failed: remove_by_mask with no bits");
+    
+    growing_array_deinit((void**)&numbers);
+    
+    // Typed array, mixed with the untyped functions on the same array
+    Test_Thing_Array_init(&things, get_heap_allocator());
+    for (u32 i = 0; i < 100; i += 1) {
+        Test_Thing *pushed = Test_Thing_Array_push(&things, (Test_Thing){ i, i * 2.0 });
+        assert(pushed == &things[i], "Failed: Typed push should return the new item");
+    }
+    Test_Thing *empty = Test_Thing_Array_push_empty(&things);
+    empty->foo = 1234;
+    assert(Test_Thing_Array_count(things) == 101 && growing_array_get_valid_count(things) == 101, "Failed: Typed count");
+    assert(Test_Thing_Array_last(things)->foo == 1234, "Failed: Typed last");
+    
+    Test_Thing_Array_pop(&things);
+    Test_Thing_Array_unordered_remove(&things, 10);
+    assert(things[10].foo == 99 && Test_Thing_Array_count(things) == 99, "Failed: Typed unordered remove");
+    
+    growing_array_ordered_remove_by_index((void**)&things, 0);
+    assert(things[0].foo == 1 && floats_roughly_match(things[0].bar, 2.0), "Failed: Untyped remove on typed array");
+    
+    Test_Thing_Array_clear(&things);
+    assert(Test_Thing_Array_count(things) == 0, "Failed: Typed clear");
+    Test_Thing_Array_deinit(&things);
+    assert(things == 0, "Failed: Typed deinit");
+    
+    // Shrinking on the heap always happens in place, growing keeps the contents either way
+    u8 *bytes = alloc(get_heap_allocator(), 1024);
+    for (u64 i = 0; i < 1024; i += 1) bytes[i] = (u8)i;
+    assert(reallocate(get_heap_allocator(), bytes, 1024, 512) == bytes, "Failed: Shrinking reallocate should not move");
+    bytes = reallocate(get_heap_allocator(), bytes, 512, 64*1024);
+    for (u64 i = 0; i < 512; i += 1) {
+        assert(bytes[i] == (u8)i, "Failed: reallocate lost contents at %llu", i);
+    }
+    dealloc(get_heap_allocator(), bytes);
+    
+    // The temporary allocator can't grow in place, reallocate copies only the old size
+    u8 *temp_bytes = talloc(16);
+    memset(temp_bytes, 0xAB, 16);
+    u8 *temp_grown = reallocate(get_temporary_allocator(), temp_bytes, 16, 64);
+    assert(temp_grown != temp_bytes, "Failed: Temporary reallocate should move");
+    for (u64 i = 0; i < 16; i += 1) {
+        assert(temp_grown[i] == 0xAB, "Failed: Temporary reallocate lost contents at %llu", i);
+    }
+}
+
+DEFINE_SLOT_MAP(Test_Thing_Map, Test_Thing);
+void test_slot_map() {
+    Slot_Map map = make_slot_map(u64, get_heap_allocator());
+    
+    assert(!slot_map_contains(&map, ZERO(Slot_Map_Handle)), "Failed: Zero handle should never be valid");
+    
+    u64 v = 10;
+    Slot_Map_Handle a = slot_map_add(&map, &v);
+    v = 20;
+    Slot_Map_Handle b = slot_map_add(&map, &v);
+    u64 *c_value;
+    Slot_Map_Handle c;
+    c_value = slot_map_add_empty(&map, &c);
+    *c_value = 30;
+    
+    assert(map.count == 3, "Failed: Count after adds");
+    assert(*(u64*)slot_map_get(&map, a) == 10 && *(u64*)slot_map_get(&map, b) == 20 && *(u64*)slot_map_get(&map, c) == 30, "Failed: Values after adds");
+    
+    assert(slot_map_remove(&map, a), "Failed: Remove should find a");
+    assert(!slot_map_remove(&map, a), "Failed: a was already removed");
+    assert(!slot_map_get(&map, a) && !slot_map_contains(&map, a), "Failed: a should be gone");
+    assert(map.count == 2 && *(u64*)slot_map_get_nth(&map, 0) == 30, "Failed: Last value should move into removed place");
+    assert(*(u64*)slot_map_get(&map, b) == 20 && *(u64*)slot_map_get(&map, c) == 30, "Failed: Values after remove");
+    
+    // Reuses a's slot, but a must stay invalid
+    v = 40;
+    Slot_Map_Handle d = slot_map_add(&map, &v);
+    assert(d.index == a.index && d.generation != a.generation, "Failed: Slot should be reused with a new generation");
+    assert(!slot_map_contains(&map, a) && *(u64*)slot_map_get(&map, d) == 40, "Failed: Stale handle after slot reuse");
+    
+    // Ordered remove keeps the order of the rest
+    v = 50;
+    Slot_Map_Handle e = slot_map_add(&map, &v);
+    assert(slot_map_remove_ordered(&map, b), "Failed: Ordered remove should find b");
+    u64 expected_order[] = {30, 40, 50};
+    assert(map.count == 3, "Failed: Count after ordered remove");
+    for (u64 i = 0; i < map.count; i += 1) {
+        assert(*(u64*)slot_map_get_nth(&map, i) == expected_order[i], "Failed: Order after ordered remove at %llu", i);
+        assert(slot_map_get(&map, map.handles[i]) == slot_map_get_nth(&map, i), "Failed: Handle %llu should find its own value", i);
+    }
+    assert(*(u64*)slot_map_get(&map, e) == 50, "Failed: e after ordered remove");
+    
+    slot_map_clear(&map);
+    assert(map.count == 0 && !slot_map_contains(&map, c) && !slot_map_contains(&map, d) && !slot_map_contains(&map, e), "Failed: Clear should invalidate every handle");
+    slot_map_destroy(&map);
+    
+    // Random churn against a plain array of what should be there
+    const u64 max_live = 5000;
+    Slot_Map_Handle *live = alloc(get_heap_allocator(), max_live*sizeof(Slot_Map_Handle));
+    u64 *live_values = alloc(get_heap_allocator(), max_live*sizeof(u64));
+    Slot_Map_Handle *dead = alloc(get_heap_allocator(), 1000000*sizeof(Slot_Map_Handle));
+    u64 live_count = 0;
+    u64 dead_count = 0;
+    
+    Test_Thing_Map things;
+    Test_Thing_Map_init(&things, get_heap_allocator());
+    for (u64 i = 0; i < 1000000; i += 1) {
+        u64 op = get_random() % 3;
+        if (live_count < max_live && (op == 0 || live_count == 0)) {
+            live[live_count] = Test_Thing_Map_add(&things, (Test_Thing){(int)i, (float)i});
+            live_values[live_count] = i;
+            live_count += 1;
+        } else if (op == 1) {
+            u64 n = get_random() % live_count;
+            bool ordered = get_random() % 2;
+            bool removed = ordered ? Test_Thing_Map_remove_ordered(&things, live[n]) : Test_Thing_Map_remove(&things, live[n]);
+            assert(removed, "Failed: Remove of live handle");
+            dead[dead_count] = live[n];
+            dead_count += 1;
+            live_count -= 1;
+            live[n] = live[live_count];
+            live_values[n] = live_values[live_count];
+        } else {
+            u64 n = get_random() % live_count;
+            Test_Thing *thing = Test_Thing_Map_get(&things, live[n]);
+            assert(thing && thing->foo == (int)live_values[n], "Failed: Get of live handle");
+        }
+    }
+    assert(things.count == live_count, "Failed: Count %llu, expected %llu", things.count, live_count);
+    for (u64 n = 0; n < live_count; n += 1) {
+        Test_Thing *thing = Test_Thing_Map_get(&things, live[n]);
+        assert(thing && thing->foo == (int)live_values[n], "Failed: Final check of live handle %llu", n);
+    }
+    for (u64 n = 0; n < dead_count; n += 1) {
+        assert(!Test_Thing_Map_contains(&things, dead[n]), "Failed: Removed handle %llu should be invalid", n);
+    }
+    for (u64 i = 0; i < things.count; i += 1) {
+        assert(Test_Thing_Map_get(&things, things.handles[i]) == &things.values[i], "Failed: Handle of value %llu", i);
+    }
+    
+    Test_Thing_Map_clear(&things);
+    assert(things.count == 0 && (live_count == 0 || !Test_Thing_Map_contains(&things, live[0])), "Failed: Typed clear");
+    Test_Thing_Map_destroy(&things);
+    
+    dealloc(get_heap_allocator(), live);
+    dealloc(get_heap_allocator(), live_values);
+    dealloc(get_heap_allocator(), dead);
 }
 
 
@@ -1698,11 +2892,332 @@ void test_os_binary_semaphore() {
 
 }
 
+// Scopes also write a PROFILE_EVENT_SCOPE_THREAD_CYCLES with thread cycles on
+#define TEST_PROFILER_EVENTS_PER_SCOPE (PROFILER_THREAD_CYCLES ? 2 : 1)
+
+u64 test_profiler_scope_cycles(Profiler_Thread_Buffer *buffer, u64 num_scopes) {
+    const u64 batch_size = PROFILER_EVENTS_PER_THREAD/TEST_PROFILER_EVENTS_PER_SCOPE; // Fills the buffer once
+    
+    // Warm up, first scope with stats allocates
+    _profiler_scope("Test scope") {}
+    buffer->read_count = buffer->write_count;
+    
+    u64 recorded_count = 0;
+    u64 cycles = 0;
+    for (u64 batch = 0; batch < num_scopes/batch_size; batch += 1) {
+        u64 write_count_before = buffer->write_count;
+        
+        u64 start_cycles = rdtsc();
+        for (u64 i = 0; i < batch_size; i += 1) {
+            _profiler_scope("Test scope") {}
+        }
+        cycles += rdtsc() - start_cycles;
+        
+        recorded_count += buffer->write_count - write_count_before;
+        
+        Profile_Event *last = &buffer->events[(buffer->write_count-TEST_PROFILER_EVENTS_PER_SCOPE) % PROFILER_EVENTS_PER_THREAD];
+        assert(strings_match(STR(last->name), STR("Test scope")), "Failed: wrong scope name in event");
+        assert(last->kind == PROFILE_EVENT_SCOPE, "Failed: wrong event kind");
+        assert(last->end_cycles >= last->start_cycles, "Failed: scope ends before it starts");
+        
+        buffer->read_count = buffer->write_count;
+    }
+    assert(recorded_count == num_scopes*TEST_PROFILER_EVENTS_PER_SCOPE, "Failed: expected %llu events, got %llu", num_scopes, recorded_count);
+    
+    return cycles;
+}
+void test_profiler() {
+    profiler_init();
+    
+    bool was_capturing = profiler_capturing;
+    bool was_collecting_stats = profiler_collecting_stats;
+    profiler_capture_start();
+    
+    // Record into a buffer the trace writer doesn't know about so we can inspect and discard events
+    Profiler_Thread_Buffer *thread_buffer = _profiler_thread_buffer;
+    Profiler_Thread_Buffer test_buffer = ZERO(Profiler_Thread_Buffer);
+    test_buffer.events = alloc(get_heap_allocator(), sizeof(Profile_Event)*PROFILER_EVENTS_PER_THREAD);
+    _profiler_thread_buffer = &test_buffer;
+    Profiler_Thread_Buffer *buffer = &test_buffer;
+    
+    const u64 num_scopes = 1024*1024;
+    
+    profiler_collecting_stats = false;
+    f64 ns_per_scope = profiler_cycles_to_seconds(test_profiler_scope_cycles(buffer, num_scopes)) * 1000000000.0 / (f64)num_scopes;
+    profiler_collecting_stats = true;
+    f64 ns_per_scope_with_stats = profiler_cycles_to_seconds(test_profiler_scope_cycles(buffer, num_scopes)) * 1000000000.0 / (f64)num_scopes;
+    
+    // Counters & gauges
+    u64 write_count_before = buffer->write_count;
+    _profiler_record_value("Test gauge", 123.0, rdtsc());
+    assert(buffer->write_count == write_count_before + 1, "Failed: gauge was not recorded");
+    Profile_Event *e = &buffer->events[write_count_before % PROFILER_EVENTS_PER_THREAD];
+    assert(e->kind == PROFILE_EVENT_VALUE && e->value == 123.0, "Failed: wrong gauge event");
+    
+    profiler_new_frame();
+    _profiler_counter_add("Test counter", 2);
+    _profiler_counter_add("Test counter", 3);
+    assert(buffer->write_count == write_count_before + 1, "Failed: counter was written before the frame ended");
+    profiler_new_frame();
+    _profiler_counter_add("Test counter", 1);
+    assert(buffer->write_count == write_count_before + 2, "Failed: counter total was not written in the next frame");
+    e = &buffer->events[(write_count_before+1) % PROFILER_EVENTS_PER_THREAD];
+    assert(e->kind == PROFILE_EVENT_VALUE && e->value == 5.0, "Failed: expected counter total 5, got %f", e->value);
+    assert(e->start_cycles == _profiler_frame_start_cycles, "Failed: counter total should be at the frame start");
+    buffer->read_count = buffer->write_count;
+    
+    // Capture windows
+    profiler_capture_stop();
+    write_count_before = buffer->write_count;
+    _profiler_scope("Test scope") {}
+    assert(buffer->write_count == write_count_before, "Failed: scope was recorded while not capturing");
+    
+    profiler_capture_frames(2);
+    _profiler_scope("Test scope") {}
+    profiler_new_frame();
+    _profiler_scope("Test scope") {}
+    profiler_new_frame();
+    _profiler_scope("Test scope") {}
+    assert(buffer->write_count == write_count_before + 2*TEST_PROFILER_EVENTS_PER_SCOPE, "Failed: expected 2 scopes in 2 frame capture window, got %llu events", buffer->write_count - write_count_before);
+    assert(!profiler_capturing, "Failed: capture window did not end");
+    
+    // Stats call tree
+    for (u64 frame = 0; frame < 3; frame += 1) {
+        profiler_new_frame();
+        _profiler_scope("Test outer") {
+            for (u64 i = 0; i < 3; i += 1) _profiler_scope("Test inner") {
+                volatile u64 x = 0;
+                for (u64 j = 0; j < 1000; j += 1) x += j;
+            }
+        }
+        _profiler_scope("Test scope") {}
+    }
+    profiler_new_frame();
+    
+    Profile_Scope_Stats stats[8];
+    u64 stats_count = _profiler_get_thread_stats(buffer->stats, stats, 8);
+    assert(stats_count == 3, "Failed: expected 3 scopes in call tree, got %llu", stats_count);
+    assert(strings_match(STR(stats[0].name), STR("Test scope")), "Failed: wrong scope order");
+    assert(strings_match(STR(stats[1].name), STR("Test outer")), "Failed: wrong scope order");
+    assert(strings_match(STR(stats[2].name), STR("Test inner")), "Failed: wrong scope order");
+    assert(stats[1].depth == 1 && stats[2].depth == 2, "Failed: wrong depth");
+    assert(stats[1].call_count == 1, "Failed: outer call count %llu", stats[1].call_count);
+    assert(stats[2].call_count == 3, "Failed: inner call count %llu", stats[2].call_count);
+    assert(stats[1].total_seconds >= stats[2].total_seconds, "Failed: child took longer than parent");
+    // Self cycles are exactly total minus children, so only rounding to seconds differs here
+    assert(stats[1].self_seconds > 0 && stats[1].self_seconds < stats[1].total_seconds, "Failed: self time %f out of range", stats[1].self_seconds);
+    assert(floats_relatively_match64(stats[1].self_seconds, stats[1].total_seconds-stats[2].total_seconds, 1e-6), "Failed: self time is not total minus children");
+    assert(stats[2].min_seconds <= stats[2].max_seconds && stats[2].min_seconds > 0, "Failed: min/max");
+    assert(stats[2].average_seconds > 0, "Failed: average");
+    
+    // Frame without calls
+    profiler_new_frame();
+    stats_count = _profiler_get_thread_stats(buffer->stats, stats, 8);
+    assert(stats[1].call_count == 0 && stats[1].total_seconds == 0, "Failed: scope not called last frame has stats");
+
+    // Leaving scopes early. break only leaves the scope's own for loop, so this runs 3 times.
+    profiler_new_frame();
+    u32 stack_count_before = buffer->stats->stack_count;
+    _profiler_scope("Test early exit outer") {
+        for (u64 i = 0; i < 3; i += 1) _profiler_scope("Test early exit") {
+            break;
+        }
+        assert(buffer->stats->stack_count == stack_count_before+2, "Failed: leaving the same scope early kept growing the stack, %u", buffer->stats->stack_count);
+    }
+    assert(buffer->stats->stack_count == stack_count_before, "Failed: scope left early is still on the stack, %u", buffer->stats->stack_count);
+    _profiler_scope("Test scope") {}
+    profiler_new_frame();
+    stats_count = _profiler_get_thread_stats(buffer->stats, stats, 8);
+    for (u64 i = 0; i < stats_count; i += 1) {
+        if (strings_match(STR(stats[i].name), STR("Test scope"))) assert(stats[i].depth == 1 && stats[i].call_count == 1, "Failed: scope after early exit nested under it");
+    }
+
+    // Allocation events
+    profiler_capture_start();
+    bool was_recording_allocations = profiler_recording_allocations;
+    profiler_recording_allocations = true;
+    buffer->read_count = buffer->write_count;
+    write_count_before = buffer->write_count;
+    _profiler_scope("Test alloc scope") {
+        _profiler_record_allocation(PROFILE_EVENT_ALLOCATE, PROFILE_ALLOCATOR_HEAP, 100, rdtsc(), rdtsc());
+    }
+    e = &buffer->events[(buffer->write_count-1-TEST_PROFILER_EVENTS_PER_SCOPE) % PROFILER_EVENTS_PER_THREAD]; // Scope is last
+    assert(e->kind == PROFILE_EVENT_ALLOCATE && e->allocator == PROFILE_ALLOCATOR_HEAP && e->size == 100, "Failed: wrong allocation event");
+    assert(e->name && strings_match(STR(e->name), STR("Test alloc scope")), "Failed: allocation should be tagged with the innermost scope");
+    
+#if ENABLE_PROFILING
+    write_count_before = buffer->write_count;
+    tm_allocation_tag("Test alloc tag") {
+        void *p = alloc(get_heap_allocator(), 200);
+        dealloc(get_heap_allocator(), p);
+        talloc(16);
+    }
+    u64 allocation_event_count = 0;
+    bool found_alloc = false, found_free = false, found_talloc = false;
+    for (u64 i = write_count_before; i < buffer->write_count; i += 1) {
+        e = &buffer->events[i % PROFILER_EVENTS_PER_THREAD];
+        if (e->kind != PROFILE_EVENT_ALLOCATE && e->kind != PROFILE_EVENT_DEALLOCATE) continue;
+        allocation_event_count += 1;
+        assert(e->name && strings_match(STR(e->name), STR("Test alloc tag")), "Failed: allocation tag");
+        if (e->kind == PROFILE_EVENT_ALLOCATE   && e->allocator == PROFILE_ALLOCATOR_HEAP && e->size == 200) found_alloc = true;
+        if (e->kind == PROFILE_EVENT_DEALLOCATE && e->allocator == PROFILE_ALLOCATOR_HEAP && e->size >= 200) found_free = true;
+        if (e->kind == PROFILE_EVENT_ALLOCATE   && e->allocator == PROFILE_ALLOCATOR_TEMPORARY && e->size == 16) found_talloc = true;
+    }
+    assert(allocation_event_count == 3 && found_alloc && found_free && found_talloc, "Failed: expected heap alloc, heap free and talloc events");
+    assert(_profiler_allocation_tag == 0, "Failed: allocation tag was not restored");
+#endif
+    
+    profiler_recording_allocations = was_recording_allocations;
+    buffer->read_count = buffer->write_count;
+    
+    // Thread cycles
+    u64 thread_cycles_start = os_get_thread_cycles();
+    u64 busy_start_cycles = rdtsc();
+    while (profiler_cycles_to_seconds(rdtsc()-busy_start_cycles) < 0.01) {}
+    u64 busy_thread_cycles = os_get_thread_cycles() - thread_cycles_start;
+    thread_cycles_start = os_get_thread_cycles();
+    os_sleep(20);
+    u64 sleep_thread_cycles = os_get_thread_cycles() - thread_cycles_start;
+    assert(busy_thread_cycles > 0, "Failed: thread cycles did not advance while busy");
+    assert(sleep_thread_cycles < busy_thread_cycles, "Failed: thread cycles advanced more while sleeping than while busy");
+    
+    profiler_new_frame();
+    write_count_before = buffer->write_count;
+    u64 depth = _profiler_scope_begin("Test thread cycles", &depth);
+    u64 start = rdtsc();
+    _profiler_scope_end_with_thread_cycles("Test thread cycles", start, start+100, depth, 1234);
+    assert(buffer->write_count == write_count_before+2, "Failed: scope with thread cycles should be 2 events");
+    e = &buffer->events[(write_count_before+1) % PROFILER_EVENTS_PER_THREAD];
+    assert(e->kind == PROFILE_EVENT_SCOPE_THREAD_CYCLES && e->thread_cycles == 1234, "Failed: wrong thread cycles event");
+    profiler_new_frame();
+    stats_count = _profiler_get_thread_stats(buffer->stats, stats, 8);
+    bool found_thread_cycles = false;
+    for (u64 i = 0; i < stats_count; i += 1) {
+        if (strings_match(STR(stats[i].name), STR("Test thread cycles"))) found_thread_cycles = stats[i].thread_cycles == 1234;
+    }
+    assert(found_thread_cycles, "Failed: thread cycles missing from stats");
+    buffer->read_count = buffer->write_count;
+    
+    profiler_capturing = was_capturing;
+    profiler_collecting_stats = was_collecting_stats;
+    _profiler_thread_buffer = thread_buffer;
+    dealloc(get_heap_allocator(), test_buffer.events);
+    dealloc(get_heap_allocator(), test_buffer.stats);
+    
+    // For comparison, this is what every scope used to cost: format a json line into a shared string builder under a lock.
+    const u64 num_formatted = 10000;
+    String_Builder sb;
+    string_builder_init_reserve(&sb, num_formatted*160, get_heap_allocator());
+    Spinlock lock;
+    spinlock_init(&lock);
+    u64 start_cycles = rdtsc();
+    for (u64 i = 0; i < num_formatted; i += 1) {
+        f64 start = os_get_elapsed_seconds();
+        f64 end = os_get_elapsed_seconds();
+        spinlock_acquire_or_wait(&lock);
+        string_builder_print(&sb, STR("{\"cat\":\"function\",\"dur\":%.3f,\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f},"), (end-start)*1000000.0, STR("Test scope"), context.thread_id, start*1000000.0);
+        spinlock_release(&lock);
+    }
+    u64 end_cycles = rdtsc();
+    string_builder_deinit(&sb);
+    
+    f64 ns_per_formatted_scope = profiler_cycles_to_seconds(end_cycles - start_cycles) * 1000000000.0 / (f64)num_formatted;
+    
+    print("Profiler scope overhead %.2f ns, %.2f ns with stats, formatting each scope to json was %.2f ns\n", ns_per_scope, ns_per_scope_with_stats, ns_per_formatted_scope);
+}
+
+void test_frame_timing() {
+    assert(count_trailing_zeros_32(1) == 0 && count_trailing_zeros_32(0x80000000) == 31, "Failed: count_trailing_zeros_32");
+    assert(count_trailing_zeros_64(0x100000000ULL) == 32, "Failed: count_trailing_zeros_64");
+    assert(count_leading_zeros_64(1) == 63 && count_leading_zeros_64(0xFFFFFFFFFFFFFFFFULL) == 0, "Failed: count_leading_zeros_64");
+    
+    // Every bucket bound must be above the values that land in it and not too far above
+    for (u64 us = 1; us < 1000000; us = us*5/4 + 1) {
+        u64 upper = _frame_timer_bucket_upper_bound(_frame_timer_bucket_index(us));
+        assert(upper > us, "Failed: %llu us is not below bucket upper bound %llu", us, upper);
+        assert((f64)(upper - us) <= (f64)us/32.0 + 1.0, "Failed: bucket for %llu us is too wide (%llu)", us, upper);
+    }
+    
+    Frame_Timer *timer = alloc(get_heap_allocator(), sizeof(Frame_Timer));
+    frame_timer_init(timer, "Test", 0.009);
+    
+    assert(frame_timer_get_percentile(timer, 0.99) == 0, "Failed: percentile of empty timer");
+    
+    // 1us to 10ms, evenly
+    const u64 num_samples = 10000;
+    for (u64 i = 1; i <= num_samples; i += 1) {
+        frame_timer_record(timer, (f64)i / 1000000.0);
+    }
+    
+    assert(timer->sample_count == num_samples, "Failed: sample count");
+    assert(timer->hitch_count == 1000, "Failed: expected 1000 hitches, got %llu", timer->hitch_count);
+    assert(floats_relatively_match64(timer->max_seconds, 0.01, 1e-9), "Failed: max %f", timer->max_seconds);
+    assert(fabs(frame_timer_get_average(timer) - 0.0050005) < 0.000001, "Failed: average %f", frame_timer_get_average(timer));
+    
+    f64 p50 = frame_timer_get_percentile(timer, 0.50);
+    f64 p99 = frame_timer_get_percentile(timer, 0.99);
+    f64 p100 = frame_timer_get_percentile(timer, 1.0);
+    assert(p50 >= 0.005 && p50 <= 0.005*1.04, "Failed: p50 %f", p50);
+    assert(p99 >= 0.0099 && p99 <= 0.0099*1.04, "Failed: p99 %f", p99);
+    assert(p100 == timer->max_seconds, "Failed: p100 should be max");
+    
+    // Small values are exact
+    frame_timer_reset(timer);
+    assert(timer->sample_count == 0 && timer->hitch_count == 0 && timer->max_seconds == 0, "Failed: reset");
+    for (u64 i = 0; i < 100; i += 1) frame_timer_record(timer, 0.000010);
+    frame_timer_record(timer, 0.000020);
+    assert(floats_relatively_match64(frame_timer_get_percentile(timer, 0.5), 0.000011, 1e-9), "Failed: small p50 %f", frame_timer_get_percentile(timer, 0.5));
+    
+    // Values on a bucket boundary which aren't exact in floating point land in their own bucket
+    frame_timer_reset(timer);
+    frame_timer_record(timer, 15*0.000001);
+    frame_timer_record(timer, 100*0.000001);
+    assert(_frame_timer_bucket_index(100) != _frame_timer_bucket_index(99), "Failed: 100 us should start a bucket");
+    assert(timer->buckets[15] == 1, "Failed: 15 us landed in the wrong bucket");
+    assert(timer->buckets[_frame_timer_bucket_index(100)] == 1, "Failed: 100 us landed in the wrong bucket");
+    
+    // Huge values go in the last bucket
+    frame_timer_record(timer, 60.0*60.0*24.0);
+    assert(timer->buckets[FRAME_TIMER_BUCKET_COUNT-1] == 1, "Failed: huge value not clamped to last bucket");
+    
+    profiler_init(); // For profiler_cycles_to_seconds
+    frame_timer_reset(timer);
+    const u64 num_records = 1000000;
+    u64 start_cycles = rdtsc();
+    for (u64 i = 0; i < num_records; i += 1) {
+        frame_timer_record(timer, (f64)(i & 0xFFFF) / 1000000.0);
+    }
+    u64 end_cycles = rdtsc();
+    assert(timer->sample_count == num_records, "Failed: sample count");
+    
+    f64 ns_per_record = profiler_cycles_to_seconds(end_cycles - start_cycles) * 1000000000.0 / (f64)num_records;
+    
+    dealloc(get_heap_allocator(), timer);
+    
+    print("Frame timer record %.2f ns\n", ns_per_record);
+}
+
 void oogabooga_run_tests() {
 	
 	print("Testing growing array... ");
 	test_growing_array();
 	print("OK!\n");
+	
+	print("Testing slot map... ");
+	test_slot_map();
+	print("OK!\n");
+	
+	print("Testing key-index radix sort... ");
+	test_radix_sort_keys();
+	print("OK!\n");
+	
+	print("Testing comparison sorts... ");
+	test_comparison_sorts();
+	print("OK!\n");
+	
+	print("Testing parallel radix sort... ");
+	test_radix_sort_parallel();
+	print("OK!\n");
     
 	print("Testing allocator... ");
 	test_allocator(true);
@@ -1716,6 +3231,10 @@ void oogabooga_run_tests() {
 	test_strings();
 	print("OK!\n");
 	
+	print("Testing string search... ");
+	test_string_search();
+	print("OK!\n");
+	
 	print("Testing file IO... ");
 	test_file_io();
 	print("OK!\n");
@@ -1732,10 +3251,18 @@ void oogabooga_run_tests() {
 	test_simd();
 	print("OK!\n");
 	
+	print("Testing hash... ");
+	test_hash();
+	print("OK!\n");
+	
 	print("Testing hash table... ");
 	test_hash_table();
 	print("OK!\n");
 	
+	print("Testing hash map... ");
+	test_hash_map();
+	print("OK!\n");
+	
 	print("Testing random distribution... ");
 	test_random_distribution();
 	print("OK!\n");
@@ -1744,9 +3271,29 @@ void oogabooga_run_tests() {
 	test_mutex();
 	print("OK!\n");
 	
+	print("Testing lock stats... ");
+	test_lock_stats();
+	print("OK!\n");
+	
+	print("Testing concurrent hash table... ");
+	test_concurrent_hash_table();
+	print("OK!\n");
+	
+	print("Testing string intern... ");
+	test_string_intern();
+	print("OK!\n");
+	
 	print("Testing binary semaphore... ");
 	test_os_binary_semaphore();
 	print("OK!\n");
+	
+	print("Testing profiler... ");
+	test_profiler();
+	print("OK!\n");
+	
+	print("Testing frame timing... ");
+	test_frame_timing();
+	print("OK!\n");
 
 #ifndef OOGABOOGA_HEADLESS
 	print("Testing radix sort... ");
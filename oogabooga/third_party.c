@@ -124,7 +124,10 @@ void *third_party_realloc(void *p, size_t size) {
 	assert(third_party_allocator.proc, "No third party allocator was set, but it was used!");
 	if (!size) return 0;
 	if (!p) return third_party_malloc(size);
-	return third_party_allocator.proc(size, p, ALLOCATOR_REALLOCATE, 0);
+	// We don't know the old size here, so this only works with allocators that can reallocate themselves
+	void *result = third_party_allocator.proc(size, p, ALLOCATOR_REALLOCATE, third_party_allocator.data);
+	assert(result, "The third party allocator can't reallocate, use one which can like the heap allocator");
+	return result;
 }
 void third_party_free(void *p) {
 	assert(third_party_allocator.proc, "No third party allocator was set, but it was used!");
@@ -149,7 +152,7 @@ size_t stbtt_strlen(const char* str) {
 #define STBI_NO_STDIO
 #define STBI_ASSERT(x) {if (!(x)) *(volatile char*)0 = 0;}
 #define STBI_MALLOC(sz)           third_party_malloc(sz)
-#define STBI_REALLOC(p,newsz)     third_party_allocator.proc(newsz, p, ALLOCATOR_REALLOCATE, 0)
+#define STBI_REALLOC(p,newsz)     third_party_realloc(p,newsz)
 #define STBI_FREE(p)              third_party_free(p)
 #include "third_party/stb_image.h"
 
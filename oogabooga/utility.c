@@ -65,6 +65,194 @@ void radix_sort(void *collection, void *help_buffer, u64 item_count, u64 item_si
     }
 }
 
+// Key-index radix sort.
+// radix_sort above copies whole items on every 8 bit pass, which is a lot of copying for big
+// items like Draw_Quad. These sort 8 byte keys instead, with the sort value in the high 32 bits
+// and the item's index in the low 32 bits, so items are only moved once at the end (or not at
+// all with radix_sort_indices).
+// Digits are 11 bits, or 16 bits for big sorts where that saves a pass, so sorting 21 bit z
+// values is 2 passes instead of 3. Every pass is counted in one read of the keys, and a pass is
+// skipped if all keys have the same digit, which is common when most things are on a few layers.
+// Like radix_sort, these are stable and treat the sort value as a signed number_of_bits integer.
+
+// u32 counts, enough for 2 passes of 16 bits or 3 of 11
+#define RADIX_SORT_KEYS_HISTOGRAM_COUNT (2*65536)
+#define RADIX_SORT_KEYS_PREFETCH_DISTANCE 16
+
+inline u64 get_radix_sort_keys_help_buffer_size(u64 item_count) {
+    return item_count*sizeof(u64) + RADIX_SORT_KEYS_HISTOGRAM_COUNT*sizeof(u32);
+}
+inline u64 get_radix_sort_indices_help_buffer_size(u64 item_count) {
+    return item_count*sizeof(u64) + get_radix_sort_keys_help_buffer_size(item_count);
+}
+inline u64 get_radix_sort_by_key_help_buffer_size(u64 item_count, u64 item_size) {
+    return align_next(item_count*item_size, 8) + get_radix_sort_indices_help_buffer_size(item_count);
+}
+
+// Sorts keys by bits 32..32+number_of_bits-1 (the low number_of_bits bits of the high half),
+// number_of_bits is at most 32. Bits above those don't affect the order.
+// help_buffer needs get_radix_sort_keys_help_buffer_size(item_count) bytes.
+// Returns keys or help_buffer, whichever the sorted keys ended up in.
+u64 *radix_sort_keys(u64 *keys, void *help_buffer, u64 item_count, u64 number_of_bits) {
+    assert(number_of_bits >= 1 && number_of_bits <= 32, "radix_sort_keys sorts 1 to 32 bit values, got %llu bits", number_of_bits);
+
+    if (item_count < 2) return keys;
+
+    u64 pass_count = (number_of_bits + 10) / 11;
+    if (pass_count == 3 && item_count >= 65536) pass_count = 2;
+    const u64 DIGIT_BITS = (number_of_bits + pass_count - 1) / pass_count;
+    const u64 RADIX = 1ULL << DIGIT_BITS;
+    const u64 DIGIT_MASK = RADIX - 1;
+    // The last pass can have less than DIGIT_BITS bits left to sort by
+    const u64 LAST_DIGIT_MASK = (1ULL << (number_of_bits - (pass_count - 1) * DIGIT_BITS)) - 1;
+    const u64 VALUE_MASK = (1ULL << number_of_bits) - 1;
+
+    u64 *other = (u64*)help_buffer;
+    u32 *counts = (u32*)(other + item_count);
+    memset(counts, 0, pass_count * RADIX * sizeof(u32));
+
+    for (u64 i = 0; i < item_count; ++i) {
+        u64 value = (keys[i] >> 32) & VALUE_MASK;
+        for (u64 pass = 0; pass < pass_count; ++pass) {
+            ++counts[pass * RADIX + ((value >> (pass * DIGIT_BITS)) & DIGIT_MASK)];
+        }
+    }
+
+    u64 *src = keys;
+    u64 *dst = other;
+    for (u64 pass = 0; pass < pass_count; ++pass) {
+        u32 *offsets = counts + pass * RADIX;
+        u64 shift = 32 + pass * DIGIT_BITS;
+        u64 digit_mask = pass == pass_count - 1 ? LAST_DIGIT_MASK : DIGIT_MASK;
+
+        if (offsets[(src[0] >> shift) & digit_mask] == item_count) continue;
+
+        u32 sum = 0;
+        for (u64 digit = 0; digit < RADIX; ++digit) {
+            u32 count = offsets[digit];
+            offsets[digit] = sum;
+            sum += count;
+        }
+
+        u64 i = 0;
+#if SIMD_ENABLE_SSE2
+        // Writes are scattered, so fetch where a key a bit ahead is going to go
+        for (; i + RADIX_SORT_KEYS_PREFETCH_DISTANCE < item_count; ++i) {
+            u64 ahead = (src[i + RADIX_SORT_KEYS_PREFETCH_DISTANCE] >> shift) & digit_mask;
+            _mm_prefetch((const char*)(dst + offsets[ahead]), _MM_HINT_T0);
+
+            u64 digit = (src[i] >> shift) & digit_mask;
+            dst[offsets[digit]++] = src[i];
+        }
+#endif
+        for (; i < item_count; ++i) {
+            u64 digit = (src[i] >> shift) & digit_mask;
+            dst[offsets[digit]++] = src[i];
+        }
+
+        u64 *temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    return src;
+}
+
+// Maps the bits of a float to a u32 that sorts in the same order as the float: the sign bit is
+// flipped for positive floats so they come after negative ones, and all bits are flipped for
+// negative floats so bigger magnitudes come first.
+// -0 sorts before +0, and NaNs sort before -inf or after +inf depending on their sign bit.
+inline u32 radix_sort_key_from_f32(f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(u32));
+    u32 mask = (u32)(-(s32)(bits >> 31)) | 0x80000000;
+    return bits ^ mask;
+}
+inline f32 radix_sort_key_to_f32(u32 key) {
+    u32 mask = ((key >> 31) - 1) | 0x80000000;
+    u32 bits = key ^ mask;
+    f32 value;
+    memcpy(&value, &bits, sizeof(f32));
+    return value;
+}
+
+// Returns the keys, sorted, in help_buffer or after the keys in help_buffer.
+// If values_are_f32, the value at sort_value_offset_in_item is an f32 and number_of_bits is 32.
+u64 *_radix_sort_make_and_sort_keys(void *collection, void *help_buffer, u64 item_count, u64 item_size, u64 sort_value_offset_in_item, u64 number_of_bits, bool values_are_f32) {
+    assert(item_count <= UINT32_MAX, "Key-index radix sort can sort at most %u items", UINT32_MAX);
+    assert(number_of_bits >= 1 && number_of_bits <= 32, "Key-index radix sort sorts 1 to 32 bit values, got %llu bits", number_of_bits);
+
+    u64 *keys = (u64*)help_buffer;
+
+    if (values_are_f32) {
+        for (u64 i = 0; i < item_count; ++i) {
+            f32 value = *(f32*)((u8*)collection + i * item_size + sort_value_offset_in_item);
+            keys[i] = ((u64)radix_sort_key_from_f32(value) << 32) | i;
+        }
+        return radix_sort_keys(keys, keys + item_count, item_count, 32);
+    }
+
+    const u64 HALF_RANGE_OF_VALUE_BITS = 1ULL << (number_of_bits - 1);
+    const u64 VALUE_MASK = (1ULL << number_of_bits) - 1;
+
+    for (u64 i = 0; i < item_count; ++i) {
+        u8 *item = (u8*)collection + i * item_size;
+
+        u64 sort_value = *(u32*)(item + sort_value_offset_in_item);
+        sort_value = (sort_value + HALF_RANGE_OF_VALUE_BITS) & VALUE_MASK; // We treat the value as a signed integer
+
+        keys[i] = (sort_value << 32) | i;
+    }
+
+    return radix_sort_keys(keys, keys + item_count, item_count, number_of_bits);
+}
+
+// Writes the indices of the items in sorted order to sorted_indices, without moving the items.
+// help_buffer needs get_radix_sort_indices_help_buffer_size(item_count) bytes.
+void _radix_sort_indices(void *collection, u32 *sorted_indices, void *help_buffer, u64 item_count, u64 item_size, u64 sort_value_offset_in_item, u64 number_of_bits, bool values_are_f32) {
+    u64 *sorted = _radix_sort_make_and_sort_keys(collection, help_buffer, item_count, item_size, sort_value_offset_in_item, number_of_bits, values_are_f32);
+    for (u64 i = 0; i < item_count; ++i) {
+        sorted_indices[i] = (u32)sorted[i];
+    }
+}
+void radix_sort_indices(void *collection, u32 *sorted_indices, void *help_buffer, u64 item_count, u64 item_size, u64 sort_value_offset_in_item, u64 number_of_bits) {
+    _radix_sort_indices(collection, sorted_indices, help_buffer, item_count, item_size, sort_value_offset_in_item, number_of_bits, false);
+}
+// Same as radix_sort_indices, but the sort value is an f32
+void radix_sort_indices_f32(void *collection, u32 *sorted_indices, void *help_buffer, u64 item_count, u64 item_size, u64 sort_value_offset_in_item) {
+    _radix_sort_indices(collection, sorted_indices, help_buffer, item_count, item_size, sort_value_offset_in_item, 32, true);
+}
+
+// Same result as radix_sort, but each item is copied twice in total: into help_buffer in
+// sorted order and then back.
+// help_buffer needs get_radix_sort_by_key_help_buffer_size(item_count, item_size) bytes.
+void _radix_sort_by_key(void *collection, void *help_buffer, u64 item_count, u64 item_size, u64 sort_value_offset_in_item, u64 number_of_bits, bool values_are_f32) {
+    u8 *sorted_items = (u8*)help_buffer;
+    void *key_buffer = sorted_items + align_next(item_count * item_size, 8);
+
+    u64 *sorted = _radix_sort_make_and_sort_keys(collection, key_buffer, item_count, item_size, sort_value_offset_in_item, number_of_bits, values_are_f32);
+
+    for (u64 i = 0; i < item_count; ++i) {
+#if SIMD_ENABLE_SSE2
+        if (i + RADIX_SORT_KEYS_PREFETCH_DISTANCE < item_count) {
+            u32 ahead = (u32)sorted[i + RADIX_SORT_KEYS_PREFETCH_DISTANCE];
+            _mm_prefetch((const char*)collection + ahead * item_size, _MM_HINT_T0);
+        }
+#endif
+        u32 index = (u32)sorted[i];
+        memcpy(sorted_items + i * item_size, (u8*)collection + index * item_size, item_size);
+    }
+
+    memcpy(collection, sorted_items, item_count * item_size);
+}
+void radix_sort_by_key(void *collection, void *help_buffer, u64 item_count, u64 item_size, u64 sort_value_offset_in_item, u64 number_of_bits) {
+    _radix_sort_by_key(collection, help_buffer, item_count, item_size, sort_value_offset_in_item, number_of_bits, false);
+}
+// Same as radix_sort_by_key, but the sort value is an f32
+void radix_sort_by_key_f32(void *collection, void *help_buffer, u64 item_count, u64 item_size, u64 sort_value_offset_in_item) {
+    _radix_sort_by_key(collection, help_buffer, item_count, item_size, sort_value_offset_in_item, 32, true);
+}
+
 void merge_sort(void *collection, void *help_buffer, u64 item_count, u64 item_size, int (*compare)(const void *, const void *)) {
     u8 *items = (u8 *)collection;
     u8 *buffer = (u8 *)help_buffer;
@@ -109,6 +297,283 @@ void merge_sort(void *collection, void *help_buffer, u64 item_count, u64 item_si
     }
 }
 
+// Pattern-defeating quicksort (pdqsort), in place and not stable.
+// Small ranges are insertion sorted. Pivots are the median of 3, or the median of 3 medians
+// (ninther) for big ranges. Partitions that come out already partitioned are finished with an
+// insertion sort that gives up after a few moves, so sorted and nearly sorted input is linear.
+// Many equal items are put left of the pivot and skipped. Badly unbalanced partitions shuffle
+// a few items around to break the pattern, and after log2(count) of those we fall back to heap
+// sort, so the worst case is O(n log n).
+//
+// quick_sort sorts anything with a compare proc like merge_sort. For hot sorts, make a typed
+// sort where the comparison inlines:
+//
+//     bool entity_less(const Entity *a, const Entity *b) { return a->y < b->y; }
+//     DEFINE_QUICK_SORT(sort_entities, Entity, entity_less);
+//     ...
+//     sort_entities(entities, entity_count);
+//
+#define QUICK_SORT_INSERTION_SORT_THRESHOLD 24
+#define QUICK_SORT_NINTHER_THRESHOLD 128
+#define QUICK_SORT_PARTIAL_INSERTION_SORT_LIMIT 8
+
+// The algorithm, on indices into whatever Context points at. less(c, i, j) compares item i
+// to item j and swap(c, i, j) swaps them. The pivot stays at begin while partitioning.
+#define _DEFINE_QUICK_SORT_PROCS(Name, Context, less, swap) \
+    void Name##_insertion_sort(Context *c, u64 begin, u64 end) { \
+        for (u64 i = begin + 1; i < end; ++i) { \
+            for (u64 j = i; j > begin && less(c, j, j - 1); --j) swap(c, j, j - 1); \
+        } \
+    } \
+    /* Gives up and returns false after QUICK_SORT_PARTIAL_INSERTION_SORT_LIMIT moves */ \
+    bool Name##_partial_insertion_sort(Context *c, u64 begin, u64 end) { \
+        u64 moves = 0; \
+        for (u64 i = begin + 1; i < end; ++i) { \
+            u64 j = i; \
+            for (; j > begin && less(c, j, j - 1); --j) swap(c, j, j - 1); \
+            moves += i - j; \
+            if (moves > QUICK_SORT_PARTIAL_INSERTION_SORT_LIMIT) return false; \
+        } \
+        return true; \
+    } \
+    void Name##_sort3(Context *c, u64 a, u64 b, u64 d) { \
+        if (less(c, b, a)) swap(c, a, b); \
+        if (less(c, d, b)) swap(c, b, d); \
+        if (less(c, b, a)) swap(c, a, b); \
+    } \
+    void Name##_sift_down(Context *c, u64 begin, u64 root, u64 count) { \
+        while (true) { \
+            u64 child = root * 2 + 1; \
+            if (child >= count) break; \
+            if (child + 1 < count && less(c, begin + child, begin + child + 1)) child += 1; \
+            if (!less(c, begin + root, begin + child)) break; \
+            swap(c, begin + root, begin + child); \
+            root = child; \
+        } \
+    } \
+    void Name##_heap_sort(Context *c, u64 begin, u64 end) { \
+        u64 count = end - begin; \
+        for (u64 i = count / 2; i > 0; --i) Name##_sift_down(c, begin, i - 1, count); \
+        for (u64 i = count - 1; i > 0; --i) { \
+            swap(c, begin, begin + i); \
+            Name##_sift_down(c, begin, 0, i); \
+        } \
+    } \
+    /* Items less than the pivot go left of it, the rest right. Returns where the pivot ends up. */ \
+    u64 Name##_partition_right(Context *c, u64 begin, u64 end, bool *already_partitioned) { \
+        u64 first = begin + 1; \
+        u64 last = end; \
+        while (first < end && less(c, first, begin)) ++first; \
+        if (first - 1 == begin) { \
+            while (first < last && !less(c, --last, begin)); \
+        } else { \
+            while (!less(c, --last, begin)); /* Stops at first - 1 at the latest */ \
+        } \
+        *already_partitioned = first >= last; \
+        while (first < last) { \
+            swap(c, first, last); \
+            while (less(c, ++first, begin)); \
+            while (!less(c, --last, begin)); \
+        } \
+        u64 pivot = first - 1; \
+        swap(c, begin, pivot); \
+        return pivot; \
+    } \
+    /* Items equal to the pivot go left of it. Used when the pivot equals the item before the */ \
+    /* range, so nothing in the range is less than it and the left side is all equal items. */ \
+    u64 Name##_partition_left(Context *c, u64 begin, u64 end) { \
+        u64 first = begin; \
+        u64 last = end; \
+        while (less(c, begin, --last)); \
+        if (last + 1 == end) { \
+            while (first < last && !less(c, begin, ++first)); \
+        } else { \
+            while (!less(c, begin, ++first)); \
+        } \
+        while (first < last) { \
+            swap(c, first, last); \
+            while (less(c, begin, --last)); \
+            while (!less(c, begin, ++first)); \
+        } \
+        swap(c, begin, last); \
+        return last; \
+    } \
+    void Name##_loop(Context *c, u64 begin, u64 end, u64 bad_partitions_allowed, bool leftmost) { \
+        while (true) { \
+            u64 count = end - begin; \
+            if (count < QUICK_SORT_INSERTION_SORT_THRESHOLD) { \
+                Name##_insertion_sort(c, begin, end); \
+                return; \
+            } \
+            \
+            /* Median to begin, as the pivot */ \
+            u64 half = count / 2; \
+            if (count > QUICK_SORT_NINTHER_THRESHOLD) { \
+                Name##_sort3(c, begin, begin + half, end - 1); \
+                Name##_sort3(c, begin + 1, begin + half - 1, end - 2); \
+                Name##_sort3(c, begin + 2, begin + half + 1, end - 3); \
+                Name##_sort3(c, begin + half - 1, begin + half, begin + half + 1); \
+                swap(c, begin, begin + half); \
+            } else { \
+                Name##_sort3(c, begin + half, begin, end - 1); \
+            } \
+            \
+            /* The item before the range is <= everything in it, so if the pivot equals it */ \
+            /* there's nothing less than the pivot and we can skip past all the equal items */ \
+            if (!leftmost && !less(c, begin - 1, begin)) { \
+                begin = Name##_partition_left(c, begin, end) + 1; \
+                continue; \
+            } \
+            \
+            bool already_partitioned; \
+            u64 pivot = Name##_partition_right(c, begin, end, &already_partitioned); \
+            u64 left_count = pivot - begin; \
+            u64 right_count = end - (pivot + 1); \
+            \
+            if (left_count < count / 8 || right_count < count / 8) { \
+                if (--bad_partitions_allowed == 0) { \
+                    Name##_heap_sort(c, begin, end); \
+                    return; \
+                } \
+                /* Break up whatever pattern gave us a bad pivot */ \
+                if (left_count >= QUICK_SORT_INSERTION_SORT_THRESHOLD) { \
+                    swap(c, begin, begin + left_count / 4); \
+                    swap(c, pivot - 1, pivot - left_count / 4); \
+                    if (left_count > QUICK_SORT_NINTHER_THRESHOLD) { \
+                        swap(c, begin + 1, begin + left_count / 4 + 1); \
+                        swap(c, begin + 2, begin + left_count / 4 + 2); \
+                        swap(c, pivot - 2, pivot - left_count / 4 - 1); \
+                        swap(c, pivot - 3, pivot - left_count / 4 - 2); \
+                    } \
+                } \
+                if (right_count >= QUICK_SORT_INSERTION_SORT_THRESHOLD) { \
+                    swap(c, pivot + 1, pivot + 1 + right_count / 4); \
+                    swap(c, end - 1, end - right_count / 4); \
+                    if (right_count > QUICK_SORT_NINTHER_THRESHOLD) { \
+                        swap(c, pivot + 2, pivot + 2 + right_count / 4); \
+                        swap(c, pivot + 3, pivot + 3 + right_count / 4); \
+                        swap(c, end - 2, end - 1 - right_count / 4); \
+                        swap(c, end - 3, end - 2 - right_count / 4); \
+                    } \
+                } \
+            } else if (already_partitioned \
+                    && Name##_partial_insertion_sort(c, begin, pivot) \
+                    && Name##_partial_insertion_sort(c, pivot + 1, end)) { \
+                return; \
+            } \
+            \
+            Name##_loop(c, begin, pivot, bad_partitions_allowed, leftmost); \
+            begin = pivot + 1; \
+            leftmost = false; \
+        } \
+    } \
+    void Name##_run(Context *c, u64 count) { \
+        if (count < 2) return; \
+        u64 log2_count = 0; \
+        for (u64 n = count; n > 1; n >>= 1) log2_count += 1; \
+        Name##_loop(c, 0, count, log2_count, true); \
+    }
+
+typedef struct Quick_Sort_Context {
+    u8 *items;
+    u64 item_size;
+    int (*compare)(const void *, const void *);
+} Quick_Sort_Context;
+
+inline void _sort_swap_bytes(u8 *a, u8 *b, u64 size) {
+    while (size >= 8) {
+        u64 t;
+        memcpy(&t, a, 8);
+        memcpy(a, b, 8);
+        memcpy(b, &t, 8);
+        a += 8; b += 8; size -= 8;
+    }
+    while (size > 0) {
+        u8 t = *a; *a = *b; *b = t;
+        a += 1; b += 1; size -= 1;
+    }
+}
+inline bool _quick_sort_less(Quick_Sort_Context *c, u64 i, u64 j) {
+    return c->compare(c->items + i * c->item_size, c->items + j * c->item_size) < 0;
+}
+inline void _quick_sort_swap(Quick_Sort_Context *c, u64 i, u64 j) {
+    _sort_swap_bytes(c->items + i * c->item_size, c->items + j * c->item_size, c->item_size);
+}
+_DEFINE_QUICK_SORT_PROCS(_quick_sort, Quick_Sort_Context, _quick_sort_less, _quick_sort_swap)
+
+// compare works like for qsort and merge_sort
+void quick_sort(void *collection, u64 item_count, u64 item_size, int (*compare)(const void *, const void *)) {
+    Quick_Sort_Context c = { (u8*)collection, item_size, compare };
+    _quick_sort_run(&c, item_count);
+}
+
+// Defines void Name(Type *items, u64 count), sorting with less_proc(const Type *a, const Type *b)
+// which returns true if a goes before b. less_proc can be a function or a macro.
+#define DEFINE_QUICK_SORT(Name, Type, less_proc) \
+    typedef struct Name##_Context { Type *items; } Name##_Context; \
+    inline bool Name##_less(Name##_Context *c, u64 i, u64 j) { return less_proc(&c->items[i], &c->items[j]); } \
+    inline void Name##_swap(Name##_Context *c, u64 i, u64 j) { Type t = c->items[i]; c->items[i] = c->items[j]; c->items[j] = t; } \
+    _DEFINE_QUICK_SORT_PROCS(Name, Name##_Context, Name##_less, Name##_swap) \
+    void Name(Type *items, u64 count) { \
+        Name##_Context c = { items }; \
+        Name##_run(&c, count); \
+    }
+
+// Stable merge sort that merges back and forth between collection and help_buffer instead of
+// copying back after every pass like merge_sort. Runs of MERGE_SORT_RUN_LENGTH items are
+// insertion sorted in place first, which saves the first few passes. Merges where the two
+// runs are already in order are just copied.
+// help_buffer should be same size as collection.
+#define MERGE_SORT_RUN_LENGTH 16
+void merge_sort_ping_pong(void *collection, void *help_buffer, u64 item_count, u64 item_size, int (*compare)(const void *, const void *)) {
+    u8 *src = (u8 *)collection;
+    u8 *dst = (u8 *)help_buffer;
+
+    for (u64 run = 0; run < item_count; run += MERGE_SORT_RUN_LENGTH) {
+        u64 run_end = (run + MERGE_SORT_RUN_LENGTH < item_count) ? (run + MERGE_SORT_RUN_LENGTH) : item_count;
+        for (u64 i = run + 1; i < run_end; ++i) {
+            for (u64 j = i; j > run && compare(src + (j - 1) * item_size, src + j * item_size) > 0; --j) {
+                _sort_swap_bytes(src + (j - 1) * item_size, src + j * item_size, item_size);
+            }
+        }
+    }
+
+    for (u64 width = MERGE_SORT_RUN_LENGTH; width < item_count; width *= 2) {
+        for (u64 left = 0; left < item_count; left += 2 * width) {
+            u64 right = (left + width < item_count) ? (left + width) : item_count;
+            u64 end = (left + 2 * width < item_count) ? (left + 2 * width) : item_count;
+
+            if (right == end || compare(src + (right - 1) * item_size, src + right * item_size) <= 0) {
+                memcpy(dst + left * item_size, src + left * item_size, (end - left) * item_size);
+                continue;
+            }
+
+            u64 left_index = left;
+            u64 right_index = right;
+            u64 k = left;
+            while (left_index < right && right_index < end) {
+                if (compare(src + left_index * item_size, src + right_index * item_size) <= 0) {
+                    memcpy(dst + k * item_size, src + left_index * item_size, item_size);
+                    left_index++;
+                } else {
+                    memcpy(dst + k * item_size, src + right_index * item_size, item_size);
+                    right_index++;
+                }
+                k++;
+            }
+            memcpy(dst + k * item_size, src + left_index * item_size, (right - left_index) * item_size);
+            k += right - left_index;
+            memcpy(dst + k * item_size, src + right_index * item_size, (end - right_index) * item_size);
+        }
+
+        u8 *temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    if (src != collection) memcpy(collection, src, item_count * item_size);
+}
+
 inline bool bytes_match(void *a, void *b, u64 count) { return memcmp(a, b, count) == 0; }
 
 #define swap(a, b, type) { type t = a; a = b; b = t;  }